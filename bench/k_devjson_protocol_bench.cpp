@@ -0,0 +1,434 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cJSON.h"
+#include "k_devjson_protocol.h"
+#include "k_devjson_protocol_executor.h"
+
+static size_t k_devjson_protocol_bench_alloc_count = 0;	//!< cJSON allocations since the start of the run
+static char	  k_devjson_protocol_bench_output[1 << 20];	//!< Response buffer, large enough for every shape
+
+static void *k_devjson_protocol_bench_malloc(size_t size)
+{
+	k_devjson_protocol_bench_alloc_count++;
+	return malloc(size);
+}
+
+static void k_devjson_protocol_bench_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	switch (cb_arg->group_type)
+	{
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_ID:
+			if (13 == cb_arg->id)
+			{
+				cb_arg->id = -1;  //!< Rejected: only ID 13 is wrong
+			}
+			break;
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_GET:
+			if (cb_arg->key && (0 == strcmp(cb_arg->key, "all")))
+			{
+				for (int i = 0; i < 100; i++)
+				{
+					std::string key = "property" + std::to_string(i);
+					k_devjson_protocol_add_response(cb_arg->output_json, key.c_str(), (k_devjson_protocol_value_t){.int_value = i},
+													K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+				}
+			}
+			else if (cb_arg->user_data)
+			{
+				/* The key points into the request, which is released after the response */
+				k_devjson_protocol_add_const_response(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.int_value = 42},
+													  K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+			}
+			else
+			{
+				k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.int_value = 42},
+												K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+			}
+			break;
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_SET:
+			k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, cb_arg->input_value, cb_arg->input_value_type);
+			break;
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD:
+		{
+			/* Most commands only check one flag of their configuration */
+			k_devjson_protocol_value_t value = {.bool_value = 0};
+			if (K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON == cb_arg->input_value_type)
+			{
+				k_devjson_protocol_lazy_t member;
+				if (k_devjson_protocol_lazy_member(cb_arg->input_value.lazy_value, "enabled", &member))
+				{
+					(void)k_devjson_protocol_lazy_value(&member, &value);
+				}
+			}
+			else if (K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON == cb_arg->input_value_type)
+			{
+				value.bool_value = cJSON_IsTrue(cJSON_GetObjectItemCaseSensitive(cb_arg->input_value.json_value, "enabled"));
+			}
+			k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, value, K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+static std::string k_devjson_protocol_bench_get_request(int keys)
+{
+	std::string request = R"({"id": 123, "req":{"get": [)";
+	for (int i = 0; i < keys; i++)
+	{
+		request += (i ? R"(, "key)" : R"("key)") + std::to_string(i) + "\"";
+	}
+	return request + "]}}";
+}
+
+static std::string k_devjson_protocol_bench_set_request(int keys)
+{
+	std::string request = R"({"id": 123, "req":{"set": {)";
+	for (int i = 0; i < keys; i++)
+	{
+		request += (i ? R"(, "key)" : R"("key)") + std::to_string(i) + (i % 2 ? R"(": "value)" + std::to_string(i) + "\"" : "\": " + std::to_string(i) + ".5");
+	}
+	return request + "}}}";
+}
+
+static std::string k_devjson_protocol_bench_number_request(int keys)
+{
+	std::string request = R"({"id": 123, "req":{"set": {)";
+	for (int i = 0; i < keys; i++)
+	{
+		request += (i ? R"(, "key)" : R"("key)") + std::to_string(i) + "\": " + std::to_string(i * 37) + (i % 2 ? ".25" : "");
+	}
+	return request + "}}}";
+}
+
+static std::string k_devjson_protocol_bench_string_request(int keys)
+{
+	/* Serial numbers, SSIDs and log lines: long values, an escape now and then */
+	std::string request = R"({"id": 123, "req":{"set": {)";
+	for (int i = 0; i < keys; i++)
+	{
+		request += (i ? R"(, "log)" : R"("log)") + std::to_string(i) + R"(": ")" + std::string(120, (char)('a' + i % 26)) + R"(\"sensor\" )" +
+				   std::string(60, (char)('A' + i % 26)) + "\"";
+	}
+	return request + "}}}";
+}
+
+static std::string k_devjson_protocol_bench_cmd_request(int commands)
+{
+	std::string request = R"({"id": 123, "req":{"cmd": {)";
+	for (int i = 0; i < commands; i++)
+	{
+		request += (i ? R"(, "c)" : R"("c)") + std::to_string(i) +
+				   R"(": {"ssid": "network", "password": "secret", "channel": 6, "ip": {"address": [192, 168, 1, 10], "dhcp": false}, "enabled": true})";
+	}
+	return request + "}}}";
+}
+
+static std::string k_devjson_protocol_bench_indent(const std::string &request)
+{
+	/* Pretty-print a request the way a host tool would, four spaces per level. Its strings hold no escape */
+	std::string indented;
+	size_t		depth	  = 0;
+	int			in_string = 0;
+	for (size_t i = 0; i < request.size(); i++)
+	{
+		const char character = request[i];
+		if (in_string || ('"' == character))
+		{
+			in_string = !in_string || ('"' != character);
+			indented += character;
+		}
+		else if (('}' == character) || (']' == character))
+		{
+			indented += "\n" + std::string(4 * --depth, ' ') + character;
+		}
+		else if (('{' == character) || ('[' == character) || (',' == character))
+		{
+			depth += ',' != character;
+			indented += character + ("\n" + std::string(4 * depth, ' '));
+		}
+		else if (' ' != character)
+		{
+			indented += (':' == character) ? ": " : std::string(1, character);
+		}
+	}
+	return indented;
+}
+
+/**
+ * @brief Parse the same request in a loop and report the request throughput and the cJSON allocations per request
+ */
+static void k_devjson_protocol_bench_parse(benchmark::State &state, const std::string &request, k_devjson_protocol_parse_status_t expected_status,
+										   int lazy_json = 0, k_devjson_protocol_engine_t engine = K_DEVJSON_PROTOCOL_ENGINE_STREAMING, void *user_data = NULL)
+{
+	cJSON_Hooks					hooks  = {.malloc_fn = k_devjson_protocol_bench_malloc, .free_fn = free};
+	k_devjson_protocol_output_t output = {k_devjson_protocol_bench_output, sizeof(k_devjson_protocol_bench_output), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	cJSON_InitHooks(&hooks);
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_bench_callback, user_data);
+	ctx.config.engine	 = engine;
+	ctx.config.lazy_json = lazy_json;
+	if (k_devjson_protocol_ctx_parse(&ctx, request.c_str(), request.size(), &output) != expected_status)
+	{
+		state.SkipWithError("unexpected parse status");
+	}
+	k_devjson_protocol_bench_alloc_count = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(k_devjson_protocol_ctx_parse(&ctx, request.c_str(), request.size(), &output));
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed((int64_t)(state.iterations() * request.size()));
+	state.counters["allocs/request"] = benchmark::Counter((double)k_devjson_protocol_bench_alloc_count, benchmark::Counter::kAvgIterations);
+	state.counters["response_bytes"] = (double)strlen(k_devjson_protocol_bench_output);
+	cJSON_InitHooks(NULL);
+}
+
+/**
+ * @brief Parse a batch of copies of the same request in a loop and report the request throughput
+ */
+static void k_devjson_protocol_bench_parse_batch(benchmark::State &state, const std::string &request, size_t count)
+{
+	std::vector<std::string>					 outputs(count, std::string(4096, '\0'));
+	std::vector<k_devjson_protocol_batch_item_t> items(count);
+	k_devjson_protocol_ctx_t					 ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_bench_callback, NULL);
+	for (size_t i = 0; i < count; i++)
+	{
+		items[i] = {request.c_str(), request.size(), {&outputs[i][0], outputs[i].size(), NULL, NULL, 0}, K_DEVJSON_PROTOCOL_PARSE_ERROR};
+	}
+	if (k_devjson_protocol_ctx_parse_batch(&ctx, items.data(), count) != count)
+	{
+		state.SkipWithError("unexpected parse status");
+	}
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(k_devjson_protocol_ctx_parse_batch(&ctx, items.data(), count));
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed((int64_t)(state.iterations() * count));
+	state.SetBytesProcessed((int64_t)(state.iterations() * count * request.size()));
+}
+
+static int k_devjson_protocol_bench_sink(void *sink_arg, const char *data, size_t length)
+{
+	*static_cast<size_t *>(sink_arg) += length;
+	benchmark::DoNotOptimize(data);
+	return 0;
+}
+
+/**
+ * @brief Feed a stream of newline-delimited copies of the same request in a loop and report the request throughput
+ */
+static void k_devjson_protocol_bench_parse_stream(benchmark::State &state, const std::string &request, size_t count)
+{
+	std::string					json_stream;
+	size_t						sent   = 0;
+	k_devjson_protocol_output_t output = {k_devjson_protocol_bench_output, 4096, k_devjson_protocol_bench_sink, &sent, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_stream_t stream;
+	for (size_t i = 0; i < count; i++)
+	{
+		json_stream += request + "\n";
+	}
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_bench_callback, NULL);
+	k_devjson_protocol_stream_init(&stream, &ctx, &output);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(k_devjson_protocol_stream_feed(&stream, json_stream.c_str(), json_stream.size()));
+	}
+	if (stream.failures)
+	{
+		state.SkipWithError("unexpected parse status");
+	}
+	state.SetItemsProcessed((int64_t)(state.iterations() * count));
+	state.SetBytesProcessed((int64_t)(state.iterations() * json_stream.size()));
+}
+
+static void k_devjson_protocol_bench_completion(k_devjson_protocol_job_t *job)
+{
+	static_cast<std::atomic<size_t> *>(job->user_data)->fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Submit copies of the same request to an executor in a loop and report the request throughput
+ */
+static void k_devjson_protocol_bench_parse_executor(benchmark::State &state, const std::string &request, size_t count, size_t workers)
+{
+	std::atomic<size_t>						 completed(0);
+	std::vector<std::string>				 outputs(count, std::string(4096, '\0'));
+	std::vector<k_devjson_protocol_job_t>	 jobs(count);
+	std::vector<k_devjson_protocol_worker_t> pool(workers);
+	k_devjson_protocol_executor_t			 executor;
+	k_devjson_protocol_ctx_t				 ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_bench_callback, NULL);
+	if ((k_devjson_protocol_executor_init(&executor, &ctx, pool.data(), NULL, workers) != 0) || (k_devjson_protocol_executor_start(&executor) != 0))
+	{
+		state.SkipWithError("executor not available");
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		jobs[i] = {request.c_str(), request.size(), {&outputs[i][0], outputs[i].size(), NULL, NULL, 0}, K_DEVJSON_PROTOCOL_PARSE_ERROR,
+				   k_devjson_protocol_bench_completion, &completed, NULL, NULL, 0};
+	}
+	for (auto _ : state)
+	{
+		completed.store(0, std::memory_order_relaxed);
+		for (size_t i = 0; i < count; i++)
+		{
+			k_devjson_protocol_executor_submit(&executor, &jobs[i]);
+		}
+		while (completed.load(std::memory_order_acquire) < count)
+		{
+			std::this_thread::yield();
+		}
+	}
+	k_devjson_protocol_executor_stop(&executor);
+	state.SetItemsProcessed((int64_t)(state.iterations() * count));
+	state.SetBytesProcessed((int64_t)(state.iterations() * count * request.size()));
+}
+
+static void BM_GetSingleKey(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_get_request(1), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_GetSingleKey);
+
+static void BM_GetSingleKeyBatch(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse_batch(state, k_devjson_protocol_bench_get_request(1), (size_t)state.range(0));
+}
+BENCHMARK(BM_GetSingleKeyBatch)->Arg(64)->Arg(1024);
+
+static void BM_GetSingleKeyStream(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse_stream(state, k_devjson_protocol_bench_get_request(1), (size_t)state.range(0));
+}
+BENCHMARK(BM_GetSingleKeyStream)->Arg(64)->Arg(1024);
+
+static void BM_GetSingleKeyExecutor(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse_executor(state, k_devjson_protocol_bench_get_request(1), 1024, (size_t)state.range(0));
+}
+BENCHMARK(BM_GetSingleKeyExecutor)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+static void BM_GetArray(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_get_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_GetArray)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_GetArrayDom(benchmark::State &state)
+{
+	int const_keys = (int)state.range(1);  //!< Any non-NULL user data answers with k_devjson_protocol_add_const_response
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_get_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS, 0,
+								   K_DEVJSON_PROTOCOL_ENGINE_DOM, const_keys ? &const_keys : NULL);
+}
+BENCHMARK(BM_GetArrayDom)->Args({100, 0})->Args({100, 1});
+
+static void BM_SetWideObject(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_set_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_SetWideObject)->Arg(10)->Arg(100);
+
+static void BM_SetNumbers(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_number_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_SetNumbers)->Arg(100);
+
+static void BM_SetLongStrings(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_string_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_SetLongStrings)->Arg(20);
+
+static void BM_CmdNestedJson(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_cmd_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_CmdNestedJson)->Arg(1)->Arg(10);
+
+static void BM_CmdNestedJsonLazy(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_cmd_request((int)state.range(0)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS, 1);
+}
+BENCHMARK(BM_CmdNestedJsonLazy)->Arg(1)->Arg(10);
+
+static void BM_CmdIdLast(benchmark::State &state)
+{
+	std::string request = k_devjson_protocol_bench_cmd_request((int)state.range(0));
+	request.replace(1, sizeof("\"id\": 123, ") - 1, "");
+	request.insert(request.size() - 1, R"(, "id": 123)");
+	k_devjson_protocol_bench_parse(state, request, K_DEVJSON_PROTOCOL_PARSE_SUCCESS, 1);
+}
+BENCHMARK(BM_CmdIdLast)->Arg(10)->Arg(100);
+
+static void BM_CmdIndented(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, k_devjson_protocol_bench_indent(k_devjson_protocol_bench_cmd_request((int)state.range(0))),
+								   K_DEVJSON_PROTOCOL_PARSE_SUCCESS, 1);
+}
+BENCHMARK(BM_CmdIndented)->Arg(10)->Arg(100);
+
+static void BM_WrongId(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, R"({"id": 13, "req":{"get": ["key1", "key2"], "set": {"key1": "value1"}}})", K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+}
+BENCHMARK(BM_WrongId);
+
+static void BM_GetAll(benchmark::State &state)
+{
+	k_devjson_protocol_bench_parse(state, R"({"id": 123, "req":{"get": "all"}})", K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+}
+BENCHMARK(BM_GetAll);
+
+static void BM_GetAllStore(benchmark::State &state)
+{
+	const std::string			request = R"({"id": 123, "req":{"get": "all"}})";
+	k_devjson_protocol_output_t output	= {k_devjson_protocol_bench_output, sizeof(k_devjson_protocol_bench_output), NULL, NULL, 0};
+	std::vector<std::string>					 keys(100);
+	std::vector<k_devjson_protocol_value_t>		 values(100);
+	std::vector<k_devjson_protocol_property_t>	 properties(100);
+	std::vector<k_devjson_protocol_fragment_t>	 fragments(100);
+	std::vector<char>							 buffer(4096);
+	k_devjson_protocol_store_t		 store;
+	k_devjson_protocol_store_cache_t cache;
+	k_devjson_protocol_ctx_t		 ctx;
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		keys[i] = "property" + std::to_string(i);
+		if (state.range(1))
+		{
+			values[i].float_value = (float)i + 0.1f;  //!< Widened to a double, 0.1f reads 0.10000000149011612
+			properties[i]		  = {K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT, 0, keys[i].c_str(), &values[i].float_value, 0, {}, {}, 0, 0};
+		}
+		else
+		{
+			values[i].int_value = (int)i;
+			properties[i]		= {K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER, 0, keys[i].c_str(), &values[i].int_value, 0, {}, {}, 0, 0};
+		}
+	}
+	k_devjson_protocol_store_init(&store, properties.data(), properties.size());
+	k_devjson_protocol_store_cache_init(&cache, fragments.data(), fragments.size(), buffer.data(), buffer.size());
+	k_devjson_protocol_ctx_init(&ctx, [](k_devjson_protocol_cb_arg_t *) {}, NULL);	//!< Every key is a property
+	k_devjson_protocol_ctx_set_store(&ctx, &store);
+	k_devjson_protocol_ctx_set_store_cache(&ctx, state.range(0) ? &cache : NULL);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(k_devjson_protocol_ctx_parse(&ctx, request.c_str(), request.size(), &output));
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed((int64_t)(state.iterations() * request.size()));
+	state.counters["response_bytes"] = (double)strlen(k_devjson_protocol_bench_output);
+}
+BENCHMARK(BM_GetAllStore)->Args({0, 0})->Args({1, 0})->Args({0, 1});
@@ -11,21 +11,93 @@ extern "C"
 #endif
 
 /* Include -------------------------------------------------------------------*/
+#include <stdint.h>
+
 #include "cJSON.h"
 
 /* Macro ---------------------------------------------------------------------*/
+#ifndef K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH
+#define K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH 1000  //!< Maximum nesting depth accepted by the streaming parser, same limit as cJSON
+#endif
+
+#define K_DEVJSON_PROTOCOL_PARSER_STACK_SIZE ((K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH + 7) / 8)  //!< Bytes of the stack of open containers, one bit per level
+
+#ifndef K_DEVJSON_PROTOCOL_PARSER_KEY_SIZE
+#define K_DEVJSON_PROTOCOL_PARSER_KEY_SIZE 64  //!< Size of the buffer holding a decoded key, including the terminator. Longer keys go to the heap
+#endif
+
+#ifndef K_DEVJSON_PROTOCOL_PARSER_VALUE_SIZE
+#define K_DEVJSON_PROTOCOL_PARSER_VALUE_SIZE 256  //!< Size of the buffer holding a decoded string value, including the terminator. Longer values go to the heap
+#endif
+
+#ifndef K_DEVJSON_PROTOCOL_PARSER_CAPTURE_SIZE
+#define K_DEVJSON_PROTOCOL_PARSER_CAPTURE_SIZE 512	//!< Size of the buffer holding a cmd JSON value split across chunks. Longer values go to the heap
+#endif
+
+#define K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE 64  //!< Size of the buffer holding a number literal, same limit as cJSON
+
+#ifndef K_DEVJSON_PROTOCOL_INDEX_THRESHOLD
+#define K_DEVJSON_PROTOCOL_INDEX_THRESHOLD 1024	 //!< Bytes left in a request from which a container is skipped with the structural index
+#endif
+
+#ifndef K_DEVJSON_PROTOCOL_PENDING_VALUE_SIZE
+#define K_DEVJSON_PROTOCOL_PENDING_VALUE_SIZE 64  //!< Size of the buffer holding the serialized value of a deferred key
+#endif
+
+#ifndef K_DEVJSON_PROTOCOL_ARENA_ALIGNMENT
+#define K_DEVJSON_PROTOCOL_ARENA_ALIGNMENT 8  //!< Alignment of the blocks handed out by an arena, must be a power of two
+#endif
+
+/* K_DEVJSON_PROTOCOL_STATIC_POOL takes every cJSON allocation from static pools shared by all threads and not locked:
+ * a static-pool build must be used from one thread, contexts included */
+#ifndef K_DEVJSON_PROTOCOL_POOL_NODES
+#define K_DEVJSON_PROTOCOL_POOL_NODES 64  //!< Blocks of the node pool (cJSON items and short strings) with K_DEVJSON_PROTOCOL_STATIC_POOL
+#endif
+
+#ifndef K_DEVJSON_PROTOCOL_POOL_STRINGS
+#define K_DEVJSON_PROTOCOL_POOL_STRINGS 16	//!< Blocks of the string pool with K_DEVJSON_PROTOCOL_STATIC_POOL
+#endif
+
+#ifndef K_DEVJSON_PROTOCOL_POOL_STRING_SIZE
+#define K_DEVJSON_PROTOCOL_POOL_STRING_SIZE 128	 //!< Size of a block of the string pool, longest string that can be allocated
+#endif
+
+#define K_DEVJSON_PROTOCOL_PROPERTY_READ_ONLY 0x01	//!< Property flag: a SET answers the current value without changing it
+#define K_DEVJSON_PROTOCOL_PROPERTY_RANGE	  0x02	//!< Property flag: a SET outside [min, max] answers the current value without changing it
+#define K_DEVJSON_PROTOCOL_PROPERTY_FIXED	  0x04	//!< Property flag: a FLOAT property is answered with size decimals
+#define K_DEVJSON_PROTOCOL_FLOAT_DECIMALS_MAX 9		//!< Most decimals of a fixed precision float, see k_devjson_protocol_add_fixed_response
+
+#ifndef K_DEVJSON_PROTOCOL_THREAD_LOCAL
+#define K_DEVJSON_PROTOCOL_THREAD_LOCAL _Thread_local  //!< Storage class of the per-thread arena binding, define empty on single-threaded targets
+#endif
+
+#if !defined(K_DEVJSON_PROTOCOL_C11_ATOMICS) && !defined(__GNUC__) && defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+	!defined(__STDC_NO_ATOMICS__)
+#define K_DEVJSON_PROTOCOL_C11_ATOMICS	//!< No GNU atomic builtins: objects shared between threads use <stdatomic.h>
+#endif
+
+#if defined(K_DEVJSON_PROTOCOL_C11_ATOMICS) && !defined(__cplusplus)
+#include <stdatomic.h>
+#define K_DEVJSON_PROTOCOL_ATOMIC(type) _Atomic(type)  //!< Type of an object shared between threads
+#else
+#define K_DEVJSON_PROTOCOL_ATOMIC(type) type  //!< Type of an object shared between threads: GNU builtins, or plain accesses on single-threaded targets
+#endif
+
 /* Typedef -------------------------------------------------------------------*/
+typedef struct k_devjson_protocol_deferred k_devjson_protocol_deferred_t;
+
 /**
  * @brief DevJSON protocol key value types
  */
 typedef enum
 {
-	K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER,	//!< Integer value
-	K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT,	//!< Float value
-	K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING,	//!< String value
-	K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL,		//!< Bool value
-	K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON,		//!< JSON value (cJSON object)
-	K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN	//!< Unknown value
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER,	  //!< Integer value, also an integral number input in the range of int
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT,	  //!< Float value, also any other number input
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING,	  //!< String value
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL,		  //!< Bool value
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON,		  //!< JSON value (cJSON object)
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN,	  //!< Unknown value
+	K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON	  //!< JSON object not parsed yet (k_devjson_protocol_lazy_t), see k_devjson_protocol_config_t::lazy_json
 } k_devjson_protocol_value_type_t;
 
 /**
@@ -39,15 +111,79 @@ typedef enum
 	K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD,	//!< Group for CMD requests
 } k_devjson_protocol_group_type_t;
 
+/**
+ * @brief JSON value handed to the callback as it appears in the request
+ *
+ * Nothing is parsed until an accessor needs it: \ref k_devjson_protocol_lazy_member finds a member by skipping over
+ * the others and \ref k_devjson_protocol_lazy_json builds the cJSON tree of the value.
+ * Fields are private: use the k_devjson_protocol_lazy_* functions.
+ */
+typedef struct
+{
+	const char *json;	 //!< First byte of the value in the request, NULL when the value is only known as a cJSON item
+	size_t		length;	 //!< Length of the value
+	cJSON	   *item;	 //!< cJSON item of the value, NULL until it is built
+	int			owned;	 //!< item was parsed from json and is freed by k_devjson_protocol_lazy_release
+} k_devjson_protocol_lazy_t;
+
 typedef union
 {
-	char  *string_value;  //!< String value
-	cJSON *json_value;	  //!< Bool value
-	int	   int_value;	  //!< Integer value
-	int	   bool_value;	  //!< Bool value
-	float  float_value;	  //!< Float value
+	char					  *string_value;  //!< String value
+	cJSON					  *json_value;	  //!< Bool value
+	k_devjson_protocol_lazy_t *lazy_value;	  //!< JSON value not parsed yet
+	int						   int_value;	  //!< Integer value
+	int						   bool_value;	  //!< Bool value
+	float					   float_value;	  //!< Float value
 } k_devjson_protocol_value_t;
 
+/**
+ * @brief Sink receiving the response chunk by chunk
+ *
+ * @param sink_arg Argument given with the sink.
+ * @param data Pointer to the next bytes of the response, not NUL-terminated.
+ * @param length Number of bytes.
+ * @return 0 on success, any other value aborts the response (e.g. the transport failed).
+ */
+typedef int (*k_devjson_protocol_sink_t)(void *sink_arg, const char *data, size_t length);
+
+/**
+ * @brief Response writer serializing the response straight into the output buffer
+ *
+ * Members are appended as the callback adds them, so no cJSON tree is built for the response.
+ * Fields are private: use the k_devjson_protocol_writer_* functions or \ref k_devjson_protocol_add_response.
+ */
+typedef struct
+{
+	cJSON					  items;	   //!< Object handed to the callback as output_json, cJSON items added to it are appended after the callback
+	char					 *buffer;	   //!< Output buffer
+	size_t					  size;		   //!< Size of the output buffer
+	size_t					  length;	   //!< Bytes written, keeps counting past the end of the buffer
+	size_t					  flushed;	   //!< Bytes already handed to the sink
+	size_t					  depth;	   //!< Number of open objects
+	int						  empty;	   //!< Current object has no member yet
+	int						  overflow;	   //!< Output did not fit in the buffer
+	int						  sink_error;  //!< The sink failed, the rest of the response is dropped
+	k_devjson_protocol_sink_t sink;		   //!< Sink the buffer is flushed to when full, NULL to keep the whole response in the buffer
+	void					 *sink_arg;	   //!< Argument given to the sink
+} k_devjson_protocol_writer_t;
+
+/**
+ * @brief Destination of a response
+ *
+ * Without a sink the whole response is written to the buffer, NUL-terminated.
+ * With a sink the buffer is only a staging area: it is handed to the sink each time it fills
+ * and once more when the response is complete, so a response of any size goes through a small buffer.
+ */
+typedef struct
+{
+	char						  *buffer;	  //!< Output buffer
+	size_t						   size;	  //!< Size of the output buffer
+	k_devjson_protocol_sink_t	   sink;	  //!< Optional sink receiving the response in chunks
+	void						  *sink_arg;  //!< Argument given to the sink
+	size_t						   length;	  //!< Set on return: length of the response, the buffer needs one more byte for the terminator
+	k_devjson_protocol_deferred_t *deferred;  //!< Lets the handlers defer keys of the request, NULL to answer every key before returning
+} k_devjson_protocol_output_t;
+
 /**
  * @brief DevJSON protocol callback argument structure
  */
@@ -61,6 +197,11 @@ typedef struct
 	k_devjson_protocol_group_type_t group_type;			//!< Type of the group (GET, SET, CMD, ID)
 	k_devjson_protocol_value_type_t input_value_type;	//!< Type of the input value
 	k_devjson_protocol_value_type_t output_value_type;	//!< Type of the output value
+	k_devjson_protocol_writer_t	   *writer;				//!< Writer of the current group response. NULL with the DOM engine
+	void						   *user_data;			//!< User data of the context the request is parsed with
+	const char					   *raw;				//!< Input value as received, not NUL-terminated. NULL with the DOM engine or if split across chunks
+	size_t							raw_length;			//!< Length of raw
+	k_devjson_protocol_deferred_t  *deferred;			//!< Request the key can be deferred in with k_devjson_protocol_defer, NULL if it must be answered now
 } k_devjson_protocol_cb_arg_t;
 
 /**
@@ -71,9 +212,66 @@ typedef enum
 	K_DEVJSON_PROTOCOL_PARSE_SUCCESS,	   //!< Parsing was successful
 	K_DEVJSON_PROTOCOL_PARSE_WRONG_ID,	   //!< Wrong ID in devJSON protocol
 	K_DEVJSON_PROTOCOL_PARSE_ERROR,		   //!< Error occurred during parsing
-	K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON  //!< Invalid JSON format
+	K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON,	//!< Invalid JSON format
+	K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE,	//!< Request not complete yet, feed more data
+	K_DEVJSON_PROTOCOL_PARSE_OUT_OF_MEMORY,	 //!< An allocation failed (static pool exhausted)
+	K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW,  //!< Response larger than the output buffer, see k_devjson_protocol_output_t::length
+	K_DEVJSON_PROTOCOL_PARSE_PENDING,		   //!< A handler deferred a key: the status is set in k_devjson_protocol_deferred_t once the response is complete
+	K_DEVJSON_PROTOCOL_PARSE_TOO_LARGE		   //!< A string does not fit in the buffers of the streaming parser (K_DEVJSON_PROTOCOL_STATIC_POOL)
 } k_devjson_protocol_parse_status_t;
 
+/**
+ * @brief Request of a batch and its output slot
+ */
+typedef struct
+{
+	const char						 *json;	   //!< Buffer holding the request, not necessarily NUL-terminated
+	size_t							  length;  //!< Number of bytes of the request in the buffer
+	k_devjson_protocol_output_t		  output;  //!< Destination of the response. Its length is set when the request is parsed
+	k_devjson_protocol_parse_status_t status;  //!< Set when the request is parsed: status of the parsing operation
+} k_devjson_protocol_batch_item_t;
+
+/**
+ * @brief Key whose value is given after its handler returned
+ *
+ * Provided by the handler, for instance next to the state of the slow operation, and kept until the key is completed.
+ * Fields are private: use \ref k_devjson_protocol_defer and \ref k_devjson_protocol_pending_complete.
+ */
+typedef struct k_devjson_protocol_pending k_devjson_protocol_pending_t;
+struct k_devjson_protocol_pending
+{
+	k_devjson_protocol_deferred_t *deferred;									 //!< Request the key belongs to
+	k_devjson_protocol_pending_t  *next;										 //!< Key deferred before this one in the same request
+	size_t						   offset;										 //!< Position of the value in the response
+	size_t						   length;										 //!< Length of the serialized value
+	char						   json[K_DEVJSON_PROTOCOL_PENDING_VALUE_SIZE];	 //!< Serialized value
+};
+
+/**
+ * @brief Completion callback of a request whose keys were deferred
+ *
+ * Fired once, on the thread that completed the last key, or on the parsing thread if every key was completed before the parse ended.
+ *
+ * @param deferred Pointer to the request, with its status and the length of its output set.
+ */
+typedef void (*k_devjson_protocol_deferred_callback_t)(k_devjson_protocol_deferred_t *deferred);
+
+/**
+ * @brief Request whose handlers can defer keys
+ *
+ * Set in k_devjson_protocol_output_t::deferred. When a handler defers a key, the parse returns K_DEVJSON_PROTOCOL_PARSE_PENDING
+ * and the output buffer must be left alone: the values are inserted once every deferred key is completed, then the completion is fired.
+ */
+struct k_devjson_protocol_deferred
+{
+	k_devjson_protocol_deferred_callback_t completion;	//!< Callback fired when the response is complete, may be NULL
+	void								  *user_data;	//!< User data of the request, not used by the library
+	k_devjson_protocol_parse_status_t	   status;		//!< Set on completion: status of the request
+	k_devjson_protocol_output_t			  *output;		//!< Destination of the response, private
+	k_devjson_protocol_pending_t		  *pending;		//!< Deferred keys, the last one first, private
+	K_DEVJSON_PROTOCOL_ATOMIC(size_t)	   remaining;	//!< Keys not completed yet, plus one until the parse ends, private
+};
+
 /**
  * @brief Callback function type for DevJSON protocol
  *
@@ -85,6 +283,262 @@ typedef enum
  */
 typedef void (*k_devjson_protocol_callback_t)(k_devjson_protocol_cb_arg_t *cb_arg);
 
+/**
+ * @brief Handler bound to a key of a group
+ */
+typedef struct
+{
+	const char					   *key;		 //!< Key, NULL for a free slot. The string must outlive the registry
+	k_devjson_protocol_group_type_t group_type;	 //!< Group the key belongs to
+	k_devjson_protocol_callback_t	handler;	 //!< Handler fired instead of the context callback
+	void						   *user_data;	 //!< Handed to the handler in k_devjson_protocol_cb_arg_t::user_data
+	uint32_t						hash;		 //!< Hash of the key and of the group type
+} k_devjson_protocol_handler_t;
+
+/**
+ * @brief Open-addressing hash table of handlers
+ *
+ * The slots are provided by the caller, so registering a handler never allocates.
+ * A lookup hashes the key once and usually compares a single string, whatever the number of handlers.
+ */
+typedef struct
+{
+	k_devjson_protocol_handler_t *slots;	 //!< Slots of the table
+	size_t						  capacity;	 //!< Number of slots, a power of two
+	size_t						  count;	 //!< Number of handlers registered
+} k_devjson_protocol_registry_t;
+
+/**
+ * @brief Key bound to a typed storage slot
+ *
+ * GET and SET of the key are served from the slot without firing a callback.
+ */
+typedef struct
+{
+	k_devjson_protocol_value_type_t type;	  //!< INTEGER or BOOL (int slot), FLOAT (float slot) or STRING (char array slot)
+	unsigned int					flags;	  //!< K_DEVJSON_PROTOCOL_PROPERTY_READ_ONLY, K_DEVJSON_PROTOCOL_PROPERTY_RANGE, K_DEVJSON_PROTOCOL_PROPERTY_FIXED
+	const char					   *key;	  //!< Key. The string must outlive the store
+	void						   *storage;  //!< Slot holding the value
+	size_t							size;	  //!< Size of the char array of a STRING slot with its terminator, decimals of a FIXED FLOAT property
+	k_devjson_protocol_value_t		min;	  //!< Smallest value a SET of an INTEGER or FLOAT property can store, with K_DEVJSON_PROTOCOL_PROPERTY_RANGE
+	k_devjson_protocol_value_t		max;	  //!< Largest value a SET of an INTEGER or FLOAT property can store, with K_DEVJSON_PROTOCOL_PROPERTY_RANGE
+	uint32_t						hash;	  //!< Hash of the key, private: set by k_devjson_protocol_store_init
+	uint32_t						version;  //!< Bumped on every change of the value, see k_devjson_protocol_property_changed
+} k_devjson_protocol_property_t;
+
+/**
+ * @brief Store of properties served without callbacks
+ *
+ * The properties are kept in one caller-provided array: a lookup walks it comparing the hashes computed once
+ * at initialization, and compares a single string. "get all" answers the properties in the order of the array.
+ */
+typedef struct
+{
+	k_devjson_protocol_property_t *properties;	//!< Properties
+	size_t						   count;		//!< Number of properties
+} k_devjson_protocol_store_t;
+
+/**
+ * @brief Serialized member of a property held in a store cache
+ */
+typedef struct
+{
+	size_t	 offset;   //!< Position of the member in the cache buffer
+	size_t	 length;   //!< Length of the member, with its leading comma
+	uint32_t version;  //!< Version of the property the member was serialized from
+} k_devjson_protocol_fragment_t;
+
+/**
+ * @brief Cache of the "get all" answer of a property store
+ *
+ * Holds the members of every property serialized one after the other, so an unchanged "get all" is copied in one go.
+ * Only the members of the properties whose version changed are serialized again. Fields are private: use
+ * \ref k_devjson_protocol_store_cache_init.
+ */
+typedef struct
+{
+	k_devjson_protocol_fragment_t *fragments;  //!< One fragment per property of the store
+	size_t						   count;	   //!< Number of fragments
+	char						  *buffer;	   //!< Serialized members
+	size_t						   size;	   //!< Size of the buffer
+	size_t						   length;	   //!< Length of the serialized members
+	int							   valid;	   //!< The fragments match the properties, apart from the changed ones
+} k_devjson_protocol_store_cache_t;
+
+/**
+ * @brief Tokenizer states of the streaming parser
+ */
+typedef enum
+{
+	K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE,				   //!< Expecting a value
+	K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY_OR_END,	   //!< After '{', expecting a key or '}'
+	K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY,			   //!< After ',' in an object, expecting a key
+	K_DEVJSON_PROTOCOL_PARSER_STATE_COLON,				   //!< After a key, expecting ':'
+	K_DEVJSON_PROTOCOL_PARSER_STATE_ARRAY_VALUE_OR_END,	   //!< After '[', expecting a value or ']'
+	K_DEVJSON_PROTOCOL_PARSER_STATE_AFTER_VALUE,		   //!< After a value, expecting ',' or the end of the container
+	K_DEVJSON_PROTOCOL_PARSER_STATE_STRING,				   //!< Inside a string
+	K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_ESCAPE,		   //!< After a backslash inside a string
+	K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_UNICODE,		   //!< Inside the four hex digits of a \u escape
+	K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_BACKSLASH,  //!< After a high surrogate, expecting a backslash
+	K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_U,		   //!< After a high surrogate, expecting 'u'
+	K_DEVJSON_PROTOCOL_PARSER_STATE_NUMBER,				   //!< Inside a number literal
+	K_DEVJSON_PROTOCOL_PARSER_STATE_LITERAL,			   //!< Inside true, false or null
+	K_DEVJSON_PROTOCOL_PARSER_STATE_DONE				   //!< Top-level value completed or parsing aborted
+} k_devjson_protocol_parser_state_t;
+
+/**
+ * @brief Classification of the envelope keys seen by the streaming parser
+ */
+typedef enum
+{
+	K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER,  //!< Key not relevant for the protocol
+	K_DEVJSON_PROTOCOL_PARSER_KEY_ID,	  //!< "id" key
+	K_DEVJSON_PROTOCOL_PARSER_KEY_REQ,	  //!< "req" key
+	K_DEVJSON_PROTOCOL_PARSER_KEY_GET,	  //!< "get" key
+	K_DEVJSON_PROTOCOL_PARSER_KEY_SET,	  //!< "set" key
+	K_DEVJSON_PROTOCOL_PARSER_KEY_CMD	  //!< "cmd" key
+} k_devjson_protocol_parser_key_t;
+
+/**
+ * @brief Streaming parser state
+ *
+ * The tokenizer walks the request once and the dispatcher fires the registered callback as soon as
+ * an entry of the get, set or cmd group is complete, without building a cJSON tree for the request.
+ * The state is kept between calls, so a request can be fed in chunks as it is received.
+ * Fields are private: use \ref k_devjson_protocol_parser_init and \ref k_devjson_protocol_parser_feed.
+ */
+typedef struct
+{
+	k_devjson_protocol_callback_t		 callback;										   //!< Callback fired for every entry
+	void								*user_data;										   //!< User data handed to the callback
+	const k_devjson_protocol_registry_t *registry;										   //!< Handlers of the registered keys, may be NULL
+	const k_devjson_protocol_store_t	*store;											   //!< Properties served without callbacks, may be NULL
+	k_devjson_protocol_store_cache_t	*store_cache;									   //!< Cache of the "get all" answer of the store, may be NULL
+	k_devjson_protocol_writer_t			 writer;										   //!< Writer of the response
+	k_devjson_protocol_output_t			*output;										   //!< Destination whose length is set on completion, NULL if none
+	const char							*raw_start;										   //!< Start of the container value of the entry being scanned
+	const char							*value_start;									   //!< Start of the scalar value being scanned, NULL if split
+	const char							*req_start;										   //!< Start of a request to replay, in the input or in capture
+	const char							*req_end;										   //!< End of a request to replay
+	const char							*input_end;										   //!< End of the buffer holding the whole request, NULL if chunked
+	const char							*group_start[2];								   //!< Start of the first set and cmd group values
+	const char							*group_end[2];									   //!< End of the first set and cmd group values
+	const char							*literal;										   //!< Literal being matched
+	k_devjson_protocol_parse_status_t	 status;										   //!< Parse status
+	k_devjson_protocol_parser_state_t	 state;											   //!< Tokenizer state
+	k_devjson_protocol_parser_key_t		 member;										   //!< Key of the current envelope member
+	k_devjson_protocol_parser_key_t		 group;											   //!< Key of the current request member
+	int									 id;											   //!< Request ID, -1 if not present
+	int									 active;										   //!< Request being parsed, response not written yet
+	int									 id_resolved;									   //!< Request ID validated or known to be absent
+	int									 lazy_json;										   //!< cmd JSON objects are handed unparsed
+	k_devjson_protocol_deferred_t		*deferred;										   //!< Request the handlers can defer keys in, NULL if they cannot
+	int									 contiguous;									   //!< Whole request in one buffer: replayed if read before its ID
+	int									 req_held;										   //!< Request read in chunks before its ID: kept in the capture buffer
+	int									 groups_walked;									   //!< Order of the groups of the request already checked
+	unsigned int						 held_groups;									   //!< Groups replayed at the end of the request, one bit per key
+	unsigned int						 seen_keys;										   //!< Envelope members and groups read, one bit per key
+	int									 raw_pending;									   //!< cmd JSON value continues in the next chunk
+	int									 in_req;										   //!< Inside the request object
+	int									 in_group;										   //!< Inside the get array or the set/cmd object
+	int									 res_written;									   //!< "res" member already written
+	int									 group_open;									   //!< Response object of the current group is open
+	int									 is_key;										   //!< String being scanned is a key
+	char								*string;										   //!< Destination of the string being scanned, NULL to skip it
+	size_t								 string_size;									   //!< Size of the destination buffer
+	size_t								 string_length;									   //!< Length of the decoded string
+	unsigned long						 unicode;										   //!< Code point of the \u escape being decoded
+	unsigned long						 surrogate;										   //!< Pending high surrogate
+	size_t								 unicode_digits;								   //!< Hex digits read of the \u escape
+	size_t								 literal_length;								   //!< Characters of the literal matched so far
+	size_t								 number_length;									   //!< Length of the number literal
+	k_devjson_protocol_value_t			 number_value;									   //!< Value of the number literal, set when it ends
+	k_devjson_protocol_value_type_t		 number_type;									   //!< Type of the number literal: INTEGER or FLOAT
+	size_t								 capture_length;								   //!< Bytes of the cmd JSON value held in the capture buffer
+	size_t								 depth;											   //!< Number of open containers
+	size_t								 alloc_failures;								   //!< Failed allocations counted when the parser was set up
+	char								*key_string;									   //!< Decoded key, in key or on the heap
+	char								*value_string;									   //!< Decoded string value, in value or on the heap
+	size_t								 key_size;										   //!< Size of the buffer key_string points to
+	size_t								 value_size;									   //!< Size of the buffer value_string points to
+	char								*capture_json;									   //!< cmd JSON value split across chunks, in capture or on the heap
+	size_t								 capture_size;									   //!< Size of the buffer capture_json points to
+	unsigned char						 nesting[K_DEVJSON_PROTOCOL_PARSER_STACK_SIZE];	   //!< Stack of open containers, one bit each: 1 for '[', 0 for '{'
+	char								 key[K_DEVJSON_PROTOCOL_PARSER_KEY_SIZE];		   //!< Key of the current entry, unless it is longer
+	char								 value[K_DEVJSON_PROTOCOL_PARSER_VALUE_SIZE];	   //!< String value of the current entry, unless it is longer
+	char								 number[K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE];	   //!< Number literal of the current entry
+	char								 capture[K_DEVJSON_PROTOCOL_PARSER_CAPTURE_SIZE];  //!< cmd JSON value split across chunks, unless it is longer
+} k_devjson_protocol_parser_t;
+
+/**
+ * @brief Bump-pointer arena serving the cJSON allocations of a request
+ *
+ * Blocks are carved from a caller-provided region and never freed one by one: the region is
+ * rewound in O(1) when the parse returns. Allocations that do not fit fall back to the heap.
+ */
+typedef struct
+{
+	unsigned char *buffer;	   //!< Start of the region
+	size_t		   size;	   //!< Size of the region
+	size_t		   used;	   //!< Bytes currently handed out
+	size_t		   peak;	   //!< Highest value reached by used, to size the region
+	size_t		   fallbacks;  //!< Allocations served by the heap because the region was full
+} k_devjson_protocol_arena_t;
+
+/**
+ * @brief Parse engines
+ */
+typedef enum
+{
+	K_DEVJSON_PROTOCOL_ENGINE_STREAMING,  //!< The request is scanned once and dispatched as it is read
+	K_DEVJSON_PROTOCOL_ENGINE_DOM		  //!< The whole request is parsed into a cJSON tree first
+} k_devjson_protocol_engine_t;
+
+/**
+ * @brief Configuration of a protocol context
+ */
+typedef struct
+{
+	k_devjson_protocol_engine_t engine;		//!< Engine used by \ref k_devjson_protocol_ctx_parse
+	int							lazy_json;	//!< cmd JSON objects are handed as K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON instead of cJSON trees
+} k_devjson_protocol_config_t;
+
+/**
+ * @brief Protocol context
+ *
+ * Holds everything a parse depends on, so several device personalities can be served by one process
+ * and each worker thread can parse with its own context without sharing mutable state.
+ * Initialize it with \ref k_devjson_protocol_ctx_init; the fields can then be changed between parses.
+ */
+typedef struct
+{
+	k_devjson_protocol_callback_t		 callback;	   //!< Callback fired for the ID and for every entry
+	void								*user_data;	   //!< Handed to the callback in k_devjson_protocol_cb_arg_t::user_data
+	k_devjson_protocol_arena_t			*arena;		   //!< Arena serving the allocations of the requests, NULL for the arena bound to the calling thread
+	k_devjson_protocol_config_t			 config;	   //!< Configuration
+	const k_devjson_protocol_registry_t *registry;	   //!< Handlers of the registered keys, NULL to fire the callback for every entry
+	const k_devjson_protocol_store_t	*store;		   //!< Properties served without callbacks, NULL if none
+	k_devjson_protocol_store_cache_t	*store_cache;  //!< Cache of the "get all" answer of the store, NULL if none
+} k_devjson_protocol_ctx_t;
+
+/**
+ * @brief Processor of a stream of newline-delimited requests (NDJSON)
+ *
+ * Every line holds one request and gets one response line, in the same order.
+ * Fields are private: use \ref k_devjson_protocol_stream_init and \ref k_devjson_protocol_stream_feed.
+ */
+typedef struct
+{
+	const k_devjson_protocol_ctx_t	 *ctx;		   //!< Context the requests are parsed with
+	k_devjson_protocol_output_t		  output;	   //!< Destination of the responses
+	k_devjson_protocol_parser_t		  parser;	   //!< Parser of the request of the current line
+	int								  in_request;  //!< Request of the current line being parsed
+	int								  skip_line;   //!< Request of the current line complete, the rest of the line is ignored
+	k_devjson_protocol_parse_status_t status;	   //!< Status of the last request
+	size_t							  responses;   //!< Responses written since the stream was initialized
+	size_t							  failures;	   //!< Requests whose status was not K_DEVJSON_PROTOCOL_PARSE_SUCCESS
+} k_devjson_protocol_stream_t;
+
 /* Constant ------------------------------------------------------------------*/
 /* Variable ------------------------------------------------------------------*/
 /* Function Declaration ------------------------------------------------------*/
@@ -93,11 +547,207 @@ typedef void (*k_devjson_protocol_callback_t)(k_devjson_protocol_cb_arg_t *cb_ar
  *
  * This function registers a callback that will be called when a JSON object
  * is parsed. The callback can process the key-value pairs in the JSON object.
+ * The callback belongs to the default context used by the functions that take no context.
  *
  * @param callback Pointer to the callback function to be registered.
  */
 void k_devjson_protocol_register_callback(k_devjson_protocol_callback_t callback);
 
+/**
+ * @brief Initialize a protocol context
+ *
+ * The context uses the engine selected at build time and the arena bound to the calling thread.
+ *
+ * @param ctx Pointer to the context to initialize.
+ * @param callback Callback fired for the ID and for every entry.
+ * @param user_data Pointer handed to the callback, may be NULL.
+ */
+void k_devjson_protocol_ctx_init(k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_callback_t callback, void *user_data);
+
+/**
+ * @brief Serve the allocations of the requests parsed with a context from an arena
+ *
+ * Installs the arena allocator like \ref k_devjson_protocol_set_arena: call it before the worker threads start.
+ * The arena is only used by one parse at a time, so a context with an arena must not be shared between threads.
+ * Has no effect when the library is built with K_DEVJSON_PROTOCOL_STATIC_POOL.
+ *
+ * @param ctx Pointer to the context.
+ * @param arena Pointer to the arena, NULL to use the arena bound to the calling thread.
+ */
+void k_devjson_protocol_ctx_set_arena(k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_arena_t *arena);
+
+/**
+ * @brief Initialize a handler registry over caller-provided slots
+ *
+ * @param registry Pointer to the registry to initialize.
+ * @param slots Pointer to the slots. They are cleared.
+ * @param capacity Number of slots. Rounded down to a power of two; a quarter of the slots is kept free to bound the probes.
+ */
+void k_devjson_protocol_registry_init(k_devjson_protocol_registry_t *registry, k_devjson_protocol_handler_t *slots, size_t capacity);
+
+/**
+ * @brief Bind a key of a group to a handler
+ *
+ * Entries of that key are dispatched to the handler with its own user data instead of the context callback,
+ * which still receives the ID and the keys that are not registered. Registering a key again replaces its handler.
+ * The registry must not be changed while a request is parsed with it.
+ *
+ * @param registry Pointer to the registry.
+ * @param group_type Group of the key: K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, SET or CMD.
+ * @param key Key to bind. The string is not copied.
+ * @param handler Handler fired for the key.
+ * @param user_data Pointer handed to the handler, may be NULL.
+ * @return 0 on success, -1 if the registry is full or the arguments are invalid.
+ */
+int k_devjson_protocol_registry_add(k_devjson_protocol_registry_t *registry, k_devjson_protocol_group_type_t group_type, const char *key,
+									k_devjson_protocol_callback_t handler, void *user_data);
+
+/**
+ * @brief Dispatch the registered keys of the requests parsed with a context through a registry
+ *
+ * @param ctx Pointer to the context.
+ * @param registry Pointer to the registry, NULL to fire the callback for every entry.
+ */
+void k_devjson_protocol_ctx_set_registry(k_devjson_protocol_ctx_t *ctx, const k_devjson_protocol_registry_t *registry);
+
+/**
+ * @brief Initialize a property store over caller-provided properties
+ *
+ * Computes the hash of every key. The keys, types, storage slots, flags and ranges must be set before.
+ *
+ * @param store Pointer to the store to initialize.
+ * @param properties Pointer to the properties. They must outlive the store.
+ * @param count Number of properties.
+ */
+void k_devjson_protocol_store_init(k_devjson_protocol_store_t *store, k_devjson_protocol_property_t *properties, size_t count);
+
+/**
+ * @brief Serve the properties of a store for the requests parsed with a context
+ *
+ * A GET of a property answers the value of its slot. A SET stores the value if it has the type of the property, fits
+ * its range and the property is not read-only, then answers the value of the slot: the current one when the SET is refused.
+ * Neither the handlers nor the callback are fired for these keys. A GET of "all" answers every property, then fires
+ * the callback as before so that it can add the other keys. The slots are read and written without locking.
+ *
+ * @param ctx Pointer to the context.
+ * @param store Pointer to the store, NULL to serve no property.
+ */
+void k_devjson_protocol_ctx_set_store(k_devjson_protocol_ctx_t *ctx, const k_devjson_protocol_store_t *store);
+
+/**
+ * @brief Tell a store that the value of a property was changed by the application
+ *
+ * Values stored by a SET are accounted for already. Without this call, a cached "get all" keeps answering the previous value.
+ *
+ * @param property Pointer to the property whose slot was written.
+ */
+void k_devjson_protocol_property_changed(k_devjson_protocol_property_t *property);
+
+/**
+ * @brief Initialize a cache of the "get all" answer of a store
+ *
+ * @param cache Pointer to the cache to initialize.
+ * @param fragments Pointer to one fragment per property of the store.
+ * @param count Number of fragments. A cache with fewer fragments than properties is not used.
+ * @param buffer Buffer holding the serialized members. When they do not fit, "get all" is answered without the cache.
+ * @param size Size of the buffer.
+ */
+void k_devjson_protocol_store_cache_init(k_devjson_protocol_store_cache_t *cache, k_devjson_protocol_fragment_t *fragments, size_t count, char *buffer,
+										 size_t size);
+
+/**
+ * @brief Answer the "get all" of the store of a context from a cache
+ *
+ * The cache is used by the streaming engine, the DOM engine answers every property as before. It is updated while
+ * requests are parsed: every context parsing concurrently, such as the workers of an executor, needs a cache of its own.
+ *
+ * @param ctx Pointer to the context.
+ * @param cache Pointer to the cache, NULL to serialize every property on each "get all".
+ */
+void k_devjson_protocol_ctx_set_store_cache(k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_store_cache_t *cache);
+
+/**
+ * @brief Find a member of a JSON object without parsing the other members
+ *
+ * The members before the one looked for are skipped by matching quotes and brackets. Keys are compared
+ * as written in the request: escape sequences are not decoded.
+ *
+ * @param lazy Pointer to the object.
+ * @param key Key of the member.
+ * @param member Set to the member when it is found. Release it with \ref k_devjson_protocol_lazy_release once it is no longer used.
+ * @return 1 if the member was found, 0 otherwise.
+ */
+int k_devjson_protocol_lazy_member(const k_devjson_protocol_lazy_t *lazy, const char *key, k_devjson_protocol_lazy_t *member);
+
+/**
+ * @brief Read a lazy value
+ *
+ * Numbers and booleans are converted in place; a string is decoded by cJSON, so it stays valid until the value is released.
+ * An object is not parsed: it is returned as K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON pointing to the value itself.
+ *
+ * @param lazy Pointer to the value.
+ * @param value Set to the value, with the same conversions as the callback receives.
+ * @return Type of the value, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN for an array or null.
+ */
+k_devjson_protocol_value_type_t k_devjson_protocol_lazy_value(k_devjson_protocol_lazy_t *lazy, k_devjson_protocol_value_t *value);
+
+/**
+ * @brief Build the cJSON tree of a lazy value
+ *
+ * The tree is built on the first call and kept until the value is released.
+ *
+ * @param lazy Pointer to the value.
+ * @return cJSON item of the value, NULL if it could not be parsed or allocated.
+ */
+const cJSON *k_devjson_protocol_lazy_json(k_devjson_protocol_lazy_t *lazy);
+
+/**
+ * @brief Free the cJSON tree built for a lazy value
+ *
+ * The value handed to the callback is released by the engine when the callback returns.
+ *
+ * @param lazy Pointer to the value.
+ */
+void k_devjson_protocol_lazy_release(k_devjson_protocol_lazy_t *lazy);
+
+/**
+ * @brief Parse a length-delimited JSON buffer with a context
+ *
+ * Same as \ref k_devjson_protocol_parse_output with the callback, allocator and configuration of the context.
+ *
+ * @param ctx Pointer to the context.
+ * @param json_buffer Pointer to the buffer holding the request.
+ * @param json_length Number of bytes of the request in the buffer.
+ * @param output Pointer to the output destination. Its length is set on return.
+ * @return k_devjson_protocol_parse_status_t Status of the parsing operation.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_ctx_parse(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, size_t json_length,
+															   k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Parse a batch of requests with a context
+ *
+ * Same as calling \ref k_devjson_protocol_ctx_parse for each request in order, but the allocator and the arena
+ * are set up once for the batch, and every request reuses the arena memory of the previous one.
+ *
+ * @param ctx Pointer to the context.
+ * @param items Pointer to the requests. The status and the output length of each one are set on return.
+ * @param count Number of requests.
+ * @return Number of requests parsed with K_DEVJSON_PROTOCOL_PARSE_SUCCESS.
+ */
+size_t k_devjson_protocol_ctx_parse_batch(const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_batch_item_t *items, size_t count);
+
+/**
+ * @brief Initialize a parser for a request received in chunks, using the callback of a context
+ *
+ * The parser keeps a copy of the callback and of the user data: the context can be changed while it runs.
+ *
+ * @param ctx Pointer to the context.
+ * @param parser Pointer to the parser to initialize.
+ * @param output Pointer to the output destination. It must stay valid until the request is complete; its length is set then.
+ */
+void k_devjson_protocol_ctx_parser_init(const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_parser_t *parser, k_devjson_protocol_output_t *output);
+
 /**
  * @brief Parse a JSON string and process it using the registered callback
  *
@@ -111,10 +761,256 @@ void k_devjson_protocol_register_callback(k_devjson_protocol_callback_t callback
  */
 k_devjson_protocol_parse_status_t k_devjson_protocol_parse(const char *json_string, char *output_string, size_t output_string_size);
 
+/**
+ * @brief Parse a length-delimited JSON buffer and process it using the registered callback
+ *
+ * Same as \ref k_devjson_protocol_parse, but the request is read straight from a receive buffer
+ * that does not need to be NUL-terminated. Bytes after the request are ignored.
+ *
+ * @param json_buffer Pointer to the buffer holding the request.
+ * @param json_length Number of bytes of the request in the buffer.
+ * @param output_string Pointer to a buffer where the output JSON string will be stored.
+ * @param output_string_size Size of the output string buffer.
+ * @return k_devjson_protocol_parse_status_t Status of the parsing operation.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_n(const char *json_buffer, size_t json_length, char *output_string, size_t output_string_size);
+
+/**
+ * @brief Parse a length-delimited JSON buffer and write the response to an output destination
+ *
+ * Same as \ref k_devjson_protocol_parse_n. When the response does not fit in the buffer and no sink is given,
+ * K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW is returned, the buffer holds an empty string and output->length
+ * tells the size needed. With a sink the response is streamed through the buffer and never overflows.
+ *
+ * @param json_buffer Pointer to the buffer holding the request.
+ * @param json_length Number of bytes of the request in the buffer.
+ * @param output Pointer to the output destination. Its length is set on return.
+ * @return k_devjson_protocol_parse_status_t Status of the parsing operation.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_output(const char *json_buffer, size_t json_length, k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Parse a batch of requests
+ *
+ * Same as \ref k_devjson_protocol_ctx_parse_batch with the default context.
+ *
+ * @param items Pointer to the requests. The status and the output length of each one are set on return.
+ * @param count Number of requests.
+ * @return Number of requests parsed with K_DEVJSON_PROTOCOL_PARSE_SUCCESS.
+ */
+size_t k_devjson_protocol_parse_batch(k_devjson_protocol_batch_item_t *items, size_t count);
+
+/**
+ * @brief Initialize a parser for a request received in chunks
+ *
+ * The parser uses the registered callback and keeps its state between calls to
+ * \ref k_devjson_protocol_parser_feed, so no reassembly buffer is needed.
+ *
+ * @param parser Pointer to the parser to initialize.
+ * @param output_string Pointer to a buffer where the output JSON string will be stored.
+ * @param output_string_size Size of the output string buffer.
+ */
+void k_devjson_protocol_parser_init(k_devjson_protocol_parser_t *parser, char *output_string, size_t output_string_size);
+
+/**
+ * @brief Initialize a parser for a request received in chunks, writing the response to an output destination
+ *
+ * @param parser Pointer to the parser to initialize.
+ * @param output Pointer to the output destination. It must stay valid until the request is complete; its length is set then.
+ */
+void k_devjson_protocol_parser_init_output(k_devjson_protocol_parser_t *parser, k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Feed a chunk of a request to a parser
+ *
+ * Entries of the get, set and cmd groups are dispatched to the callback as soon as they are complete.
+ * When the request is complete the response is written to the output buffer and the final status is returned.
+ * Bytes after the end of the request are not consumed.
+ *
+ * @param parser Pointer to the parser.
+ * @param chunk Pointer to the received bytes.
+ * @param chunk_length Number of received bytes.
+ * @param consumed Optional pointer where the number of bytes consumed is stored.
+ * @return K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE if more data is needed, the status of the request otherwise.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parser_feed(k_devjson_protocol_parser_t *parser, const char *chunk, size_t chunk_length, size_t *consumed);
+
+/**
+ * @brief Signal the end of the input to a parser
+ *
+ * Must be called when the input ends before the request is complete (e.g. the connection is closed)
+ * to release the resources of the parser.
+ *
+ * @param parser Pointer to the parser.
+ * @return Status of the request: K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON if it was truncated.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parser_finish(k_devjson_protocol_parser_t *parser);
+
+/**
+ * @brief Initialize a processor of newline-delimited requests
+ *
+ * Requests are parsed with the streaming engine whatever the engine of the context, and are not served by its arena.
+ *
+ * @param stream Pointer to the processor to initialize.
+ * @param ctx Pointer to the context. It must stay valid while the processor is used.
+ * @param output Destination of the responses, copied. It must have a sink, which receives each response followed by a newline.
+ */
+void k_devjson_protocol_stream_init(k_devjson_protocol_stream_t *stream, const k_devjson_protocol_ctx_t *ctx, const k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Feed bytes of a stream of newline-delimited requests
+ *
+ * The bytes are parsed in place, without being copied, and may cut the requests anywhere: a line split across calls
+ * is resumed on the next call. A request is answered as soon as it is complete and the rest of its line is ignored.
+ * Blank lines are skipped; a line that does not hold a valid request still gets a response line.
+ *
+ * @param stream Pointer to the processor.
+ * @param data Pointer to the received bytes.
+ * @param length Number of received bytes.
+ * @return Number of responses written during the call.
+ */
+size_t k_devjson_protocol_stream_feed(k_devjson_protocol_stream_t *stream, const char *data, size_t length);
+
+/**
+ * @brief Signal the end of a stream of newline-delimited requests
+ *
+ * Completes the request of a last line that is not terminated by a newline.
+ *
+ * @param stream Pointer to the processor.
+ * @return Number of responses written during the call.
+ */
+size_t k_devjson_protocol_stream_finish(k_devjson_protocol_stream_t *stream);
+
+/**
+ * @brief Initialize an arena over a caller-provided region
+ *
+ * @param arena Pointer to the arena to initialize.
+ * @param buffer Pointer to the region. It does not need to be aligned.
+ * @param size Size of the region in bytes.
+ */
+void k_devjson_protocol_arena_init(k_devjson_protocol_arena_t *arena, void *buffer, size_t size);
+
+/**
+ * @brief Serve the allocations of the requests parsed by the calling thread from an arena
+ *
+ * The first call installs the arena allocator through cJSON_InitHooks, replacing any hooks set before.
+ * While \ref k_devjson_protocol_parse or \ref k_devjson_protocol_parse_n runs, cJSON allocations are taken
+ * from the arena, which is rewound when the call returns: cJSON items handed to the callback must not be kept.
+ * Requests fed to a \ref k_devjson_protocol_parser_t are not served by the arena.
+ * Has no effect when the library is built with K_DEVJSON_PROTOCOL_STATIC_POOL.
+ *
+ * @param arena Pointer to the arena, NULL to go back to the heap for the calling thread.
+ */
+void k_devjson_protocol_set_arena(k_devjson_protocol_arena_t *arena);
+
+/**
+ * @brief Initialize a response writer over an output buffer
+ *
+ * @param writer Pointer to the writer to initialize.
+ * @param buffer Pointer to the output buffer.
+ * @param size Size of the output buffer.
+ */
+void k_devjson_protocol_writer_init(k_devjson_protocol_writer_t *writer, char *buffer, size_t size);
+
+/**
+ * @brief Flush the buffer of a writer to a sink each time it fills
+ *
+ * Must be called before anything is written. The buffer is then not NUL-terminated by \ref k_devjson_protocol_writer_finish.
+ *
+ * @param writer Pointer to the writer.
+ * @param sink Sink receiving the response in chunks, NULL to keep the whole response in the buffer.
+ * @param sink_arg Argument given to the sink.
+ */
+void k_devjson_protocol_writer_set_sink(k_devjson_protocol_writer_t *writer, k_devjson_protocol_sink_t sink, void *sink_arg);
+
+/**
+ * @brief Open a nested object in the response
+ *
+ * @param writer Pointer to the writer.
+ * @param key Key of the object, NULL for the root object.
+ */
+void k_devjson_protocol_writer_begin_object(k_devjson_protocol_writer_t *writer, const char *key);
+
+/**
+ * @brief Close the object opened last
+ *
+ * @param writer Pointer to the writer.
+ */
+void k_devjson_protocol_writer_end_object(k_devjson_protocol_writer_t *writer);
+
+/**
+ * @brief Append a member to the current object of the response
+ *
+ * Same result as \ref k_devjson_protocol_add_response on a cJSON object, without allocating.
+ *
+ * @param writer Pointer to the writer.
+ * @param key Key of the member.
+ * @param value The value to be added.
+ * @param value_type The type of the value being added.
+ */
+void k_devjson_protocol_writer_add(k_devjson_protocol_writer_t *writer, const char *key, k_devjson_protocol_value_t value,
+								   k_devjson_protocol_value_type_t value_type);
+
+/**
+ * @brief Append a cJSON item as a member of the current object of the response
+ *
+ * @param writer Pointer to the writer.
+ * @param key Key of the member.
+ * @param item Item to print.
+ */
+void k_devjson_protocol_writer_add_json(k_devjson_protocol_writer_t *writer, const char *key, const cJSON *item);
+
+/**
+ * @brief Append already serialized JSON as a member of the current object of the response
+ *
+ * The bytes are copied as they are, without being parsed or checked: they must hold a single valid JSON value.
+ *
+ * @param writer Pointer to the writer.
+ * @param key Key of the member.
+ * @param json Serialized value, not NUL-terminated.
+ * @param length Length of the value.
+ */
+void k_devjson_protocol_writer_add_raw(k_devjson_protocol_writer_t *writer, const char *key, const char *json, size_t length);
+
+/**
+ * @brief Close the open objects and terminate the output string, or flush the rest of the response to the sink
+ *
+ * @param writer Pointer to the writer.
+ * @return Length of the response, larger than the buffer if it did not fit (the buffer then holds an empty string).
+ */
+size_t k_devjson_protocol_writer_finish(k_devjson_protocol_writer_t *writer);
+
+/**
+ * @brief Defer the value of the key handed to a handler
+ *
+ * The member is kept at its place in the response, and the parse goes on with the next keys. Only possible with the streaming
+ * engine, when the output has a deferred request and no sink: otherwise the handler must answer before returning.
+ *
+ * @param cb_arg Pointer to the argument of the handler.
+ * @param pending Pointer to the pending key. It must stay valid until it is completed.
+ * @return 0 if the key is deferred, -1 if it must be answered now.
+ */
+int k_devjson_protocol_defer(k_devjson_protocol_cb_arg_t *cb_arg, k_devjson_protocol_pending_t *pending);
+
+/**
+ * @brief Give the value of a deferred key
+ *
+ * Can be called from any thread, once per deferred key. The value is serialized right away, so a string can be freed on return.
+ * Completing the last key of the request inserts the values in the response and fires the completion of the request.
+ *
+ * @param pending Pointer to the pending key.
+ * @param value The value of the key.
+ * @param value_type The type of the value, as for \ref k_devjson_protocol_add_response.
+ * @return 0 on success, -1 if the serialized value is larger than K_DEVJSON_PROTOCOL_PENDING_VALUE_SIZE - 1: null is answered instead.
+ */
+int k_devjson_protocol_pending_complete(k_devjson_protocol_pending_t *pending, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type);
+
 /**
  * @brief Add a response to the output JSON object
  *
  * This function adds a key-value pair to the output JSON object based on the provided value type.
+ * When output_json is the one handed to the callback by the streaming engine, the pair is
+ * written straight into the output buffer.
  *
  * @param output_json Pointer to the output JSON object where the response will be added.
  * @param key Pointer to the key string for the JSON object.
@@ -123,6 +1019,49 @@ k_devjson_protocol_parse_status_t k_devjson_protocol_parse(const char *json_stri
  */
 void k_devjson_protocol_add_response(cJSON *output_json, const char *key, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type);
 
+/**
+ * @brief Add a response under a key that outlives the output JSON object
+ *
+ * Same result as \ref k_devjson_protocol_add_response. With the DOM engine the item references the key instead of
+ * copying it, which saves an allocation and a copy per response: use it with string literals, the keys of a device
+ * model, or k_devjson_protocol_cb_arg_t::key, which is released after the response.
+ *
+ * @param output_json Pointer to the output JSON object where the response will be added.
+ * @param key Pointer to the key string, not copied: it must stay valid and unchanged until the response is sent.
+ * @param value The value to be added, which can be of different types.
+ * @param value_type The type of the value being added.
+ */
+void k_devjson_protocol_add_const_response(cJSON *output_json, const char *key, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type);
+
+/**
+ * @brief Add already serialized JSON to the output JSON object
+ *
+ * With the streaming engine the bytes are copied straight into the output buffer, so a value received in
+ * k_devjson_protocol_cb_arg_t::raw is forwarded without being parsed or printed again.
+ * The bytes are not checked: they must hold a single valid JSON value.
+ *
+ * @param output_json Pointer to the output JSON object where the response will be added.
+ * @param key Pointer to the key string for the JSON object.
+ * @param json Serialized value, not NUL-terminated.
+ * @param length Length of the value.
+ */
+void k_devjson_protocol_add_raw_response(cJSON *output_json, const char *key, const char *json, size_t length);
+
+/**
+ * @brief Add a float with a fixed number of decimals to the output JSON object
+ *
+ * FLOAT values given to \ref k_devjson_protocol_add_response are written with the fewest digits that read back as
+ * the same float, so 2.1f is answered as 2.1. This function answers a key with a fixed precision instead, such
+ * as 21.50 for a temperature with 2 decimals. Halves are rounded away from zero.
+ *
+ * @param output_json Pointer to the output JSON object where the response will be added.
+ * @param key Pointer to the key string for the JSON object.
+ * @param value Value of the key.
+ * @param decimals Digits after the decimal point, at most K_DEVJSON_PROTOCOL_FLOAT_DECIMALS_MAX. Values whose
+ *                 scaled digits do not fit are written with the fewest digits instead.
+ */
+void k_devjson_protocol_add_fixed_response(cJSON *output_json, const char *key, float value, unsigned int decimals);
+
 #ifdef __cplusplus
 }
 #endif
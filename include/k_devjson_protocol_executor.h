@@ -0,0 +1,160 @@
+/**
+ * @brief DevJSON protocol parallel executor header file
+ * @addtogroup k_devjson_protocol
+ * @{
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Include -------------------------------------------------------------------*/
+#include <pthread.h>
+
+#include "k_devjson_protocol.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+typedef struct k_devjson_protocol_job	   k_devjson_protocol_job_t;
+typedef struct k_devjson_protocol_executor k_devjson_protocol_executor_t;
+
+/**
+ * @brief Completion callback of a job
+ *
+ * Fired on the worker that parsed the job, or on the worker delivering the jobs of an ordered channel.
+ * The job belongs to the caller again once the callback is fired: it can be freed or submitted again.
+ *
+ * @param job Pointer to the completed job, with its status and output length set.
+ */
+typedef void (*k_devjson_protocol_completion_t)(k_devjson_protocol_job_t *job);
+
+/**
+ * @brief Channel delivering the completions of its jobs in the order they were submitted
+ *
+ * Jobs of a channel, such as the requests of one connection, are still parsed in parallel; only their
+ * completions wait for the jobs submitted before them. Fields are private: use \ref k_devjson_protocol_channel_init.
+ */
+typedef struct
+{
+	k_devjson_protocol_job_t *parked;	   //!< Completed jobs waiting for the jobs submitted before them
+	size_t					  submitted;   //!< Sequence number of the next job submitted
+	size_t					  delivered;   //!< Sequence number of the next job to complete
+	int						  delivering;  //!< A worker is firing the completions of the channel
+} k_devjson_protocol_channel_t;
+
+/**
+ * @brief Request handed to an executor
+ *
+ * The job is owned by the executor from the time it is submitted until its completion callback is fired.
+ */
+struct k_devjson_protocol_job
+{
+	const char						 *json;		   //!< Buffer holding the request, valid until completion
+	size_t							  length;	   //!< Number of bytes of the request in the buffer
+	k_devjson_protocol_output_t		  output;	   //!< Destination of the response. Its length is set on completion
+	k_devjson_protocol_parse_status_t status;	   //!< Set on completion: status of the parsing operation
+	k_devjson_protocol_completion_t	  completion;  //!< Callback fired when the job is complete
+	void							 *user_data;   //!< User data of the job, not used by the executor
+	k_devjson_protocol_channel_t	 *channel;	   //!< Channel delivering the completions in order, NULL for none
+	k_devjson_protocol_job_t		 *next;		   //!< Next job in the queue or the channel, private
+	size_t							  sequence;	   //!< Position of the job in its channel, private
+};
+
+/**
+ * @brief Worker of an executor
+ *
+ * Each worker parses with its own copy of the context: the arena and the store cache of a context are
+ * never shared between workers, each worker is given its own arena by \ref k_devjson_protocol_executor_init.
+ */
+typedef struct
+{
+	k_devjson_protocol_ctx_t	   ctx;		   //!< Context the worker parses with
+	k_devjson_protocol_executor_t *executor;   //!< Executor the worker belongs to
+	pthread_t					   thread;	   //!< Thread of the worker
+	size_t						   processed;  //!< Jobs parsed by the worker
+} k_devjson_protocol_worker_t;
+
+/**
+ * @brief Pool of worker threads parsing the jobs of a queue
+ *
+ * Fields are private: use \ref k_devjson_protocol_executor_init.
+ */
+struct k_devjson_protocol_executor
+{
+	pthread_mutex_t				 lock;	   //!< Protects the queue and the channels
+	pthread_cond_t				 ready;	   //!< Signaled when a job is queued or the executor stops
+	k_devjson_protocol_job_t	*head;	   //!< First queued job
+	k_devjson_protocol_job_t	*tail;	   //!< Last queued job
+	k_devjson_protocol_worker_t *workers;  //!< Workers of the executor
+	size_t						 count;	   //!< Number of workers
+	size_t						 started;  //!< Number of worker threads running
+	int							 running;  //!< Jobs are accepted
+};
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Initialize an executor over caller-provided workers
+ *
+ * Every worker gets a copy of the context, without its arena and its store cache: they hold the state of a single
+ * parse at a time. The workers parse with the arenas given here instead, and answer "get all" without the cache.
+ *
+ * @param executor Pointer to the executor to initialize.
+ * @param ctx Pointer to the context copied to every worker.
+ * @param workers Pointer to the workers. They must stay valid until the executor is stopped.
+ * @param arenas Pointer to one initialized arena per worker, NULL to allocate from the heap. They must stay valid until the executor is stopped.
+ * @param count Number of workers.
+ * @return 0 on success, -1 if the arguments are invalid or the synchronization objects could not be created.
+ */
+int k_devjson_protocol_executor_init(k_devjson_protocol_executor_t *executor, const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_worker_t *workers,
+									 k_devjson_protocol_arena_t *arenas, size_t count);
+
+/**
+ * @brief Start the worker threads of an executor
+ *
+ * Not available when the library is built with K_DEVJSON_PROTOCOL_STATIC_POOL: the pools are not shared between threads.
+ * Whatever the result, \ref k_devjson_protocol_executor_stop releases the executor.
+ *
+ * @param executor Pointer to the executor.
+ * @return 0 on success, -1 if a thread could not be created. The threads already started are stopped then.
+ */
+int k_devjson_protocol_executor_start(k_devjson_protocol_executor_t *executor);
+
+/**
+ * @brief Queue a job
+ *
+ * The job is parsed by the first idle worker, and its completion callback is fired on that worker
+ * unless the job belongs to a channel whose previous jobs are not complete yet.
+ *
+ * @param executor Pointer to the executor.
+ * @param job Pointer to the job. Its request buffer, output and completion callback must be set.
+ * @return 0 on success, -1 if the executor is not running or the job has no completion callback.
+ */
+int k_devjson_protocol_executor_submit(k_devjson_protocol_executor_t *executor, k_devjson_protocol_job_t *job);
+
+/**
+ * @brief Stop an executor
+ *
+ * The jobs already queued are parsed and completed before the worker threads exit, and the jobs submitted meanwhile
+ * are refused. The executor must not be used afterwards until it is initialized again.
+ *
+ * @param executor Pointer to the executor.
+ */
+void k_devjson_protocol_executor_stop(k_devjson_protocol_executor_t *executor);
+
+/**
+ * @brief Initialize a channel delivering completions in submission order
+ *
+ * A channel is used with a single executor, and must not be changed while its jobs are pending.
+ *
+ * @param channel Pointer to the channel to initialize.
+ */
+void k_devjson_protocol_channel_init(k_devjson_protocol_channel_t *channel);
+
+#ifdef __cplusplus
+}
+#endif
+/* @} */
\ No newline at end of file
@@ -2,6 +2,19 @@ cmake_minimum_required(VERSION 3.10)
 
 set(sources
     ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_parser.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_arena.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_writer.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_float.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_number.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_scan.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_index.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_registry.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_store.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_lazy.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_stream.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_deferred.c
+    ${CMAKE_CURRENT_LIST_DIR}/src/k_devjson_protocol_executor.c
     )
 
 set(public_includes
@@ -15,8 +28,11 @@ set(private_includes
 set(public_linked_libs
 )
 
+find_package(Threads REQUIRED)
+
 set(private_linked_libs
     k_cjson
+    Threads::Threads
     )
 
 function(k_devjson_protocol_get_sources OUT_VAR)
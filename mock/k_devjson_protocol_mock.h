@@ -21,7 +21,49 @@ extern "C"
 /* Function Declaration ------------------------------------------------------*/
 DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_register_callback, k_devjson_protocol_callback_t)
 DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_parse_status_t, k_devjson_protocol_parse, const char *, char *, size_t)
+DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_parse_status_t, k_devjson_protocol_parse_n, const char *, size_t, char *, size_t)
+DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_parse_status_t, k_devjson_protocol_parse_output, const char *, size_t, k_devjson_protocol_output_t *)
+DECLARE_FAKE_VALUE_FUNC(size_t, k_devjson_protocol_parse_batch, k_devjson_protocol_batch_item_t *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_parser_init, k_devjson_protocol_parser_t *, char *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_parser_init_output, k_devjson_protocol_parser_t *, k_devjson_protocol_output_t *)
+DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_parse_status_t, k_devjson_protocol_parser_feed, k_devjson_protocol_parser_t *, const char *, size_t, size_t *)
+DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_parse_status_t, k_devjson_protocol_parser_finish, k_devjson_protocol_parser_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_stream_init, k_devjson_protocol_stream_t *, const k_devjson_protocol_ctx_t *, const k_devjson_protocol_output_t *)
+DECLARE_FAKE_VALUE_FUNC(size_t, k_devjson_protocol_stream_feed, k_devjson_protocol_stream_t *, const char *, size_t)
+DECLARE_FAKE_VALUE_FUNC(size_t, k_devjson_protocol_stream_finish, k_devjson_protocol_stream_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_arena_init, k_devjson_protocol_arena_t *, void *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_set_arena, k_devjson_protocol_arena_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_ctx_init, k_devjson_protocol_ctx_t *, k_devjson_protocol_callback_t, void *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_ctx_set_arena, k_devjson_protocol_ctx_t *, k_devjson_protocol_arena_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_registry_init, k_devjson_protocol_registry_t *, k_devjson_protocol_handler_t *, size_t)
+DECLARE_FAKE_VALUE_FUNC(int, k_devjson_protocol_registry_add, k_devjson_protocol_registry_t *, k_devjson_protocol_group_type_t, const char *, k_devjson_protocol_callback_t, void *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_ctx_set_registry, k_devjson_protocol_ctx_t *, const k_devjson_protocol_registry_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_store_init, k_devjson_protocol_store_t *, k_devjson_protocol_property_t *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_ctx_set_store, k_devjson_protocol_ctx_t *, const k_devjson_protocol_store_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_property_changed, k_devjson_protocol_property_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_store_cache_init, k_devjson_protocol_store_cache_t *, k_devjson_protocol_fragment_t *, size_t, char *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_ctx_set_store_cache, k_devjson_protocol_ctx_t *, k_devjson_protocol_store_cache_t *)
+DECLARE_FAKE_VALUE_FUNC(int, k_devjson_protocol_lazy_member, const k_devjson_protocol_lazy_t *, const char *, k_devjson_protocol_lazy_t *)
+DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_value_type_t, k_devjson_protocol_lazy_value, k_devjson_protocol_lazy_t *, k_devjson_protocol_value_t *)
+DECLARE_FAKE_VALUE_FUNC(const cJSON *, k_devjson_protocol_lazy_json, k_devjson_protocol_lazy_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_lazy_release, k_devjson_protocol_lazy_t *)
+DECLARE_FAKE_VALUE_FUNC(k_devjson_protocol_parse_status_t, k_devjson_protocol_ctx_parse, const k_devjson_protocol_ctx_t *, const char *, size_t, k_devjson_protocol_output_t *)
+DECLARE_FAKE_VALUE_FUNC(size_t, k_devjson_protocol_ctx_parse_batch, const k_devjson_protocol_ctx_t *, k_devjson_protocol_batch_item_t *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_ctx_parser_init, const k_devjson_protocol_ctx_t *, k_devjson_protocol_parser_t *, k_devjson_protocol_output_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_init, k_devjson_protocol_writer_t *, char *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_set_sink, k_devjson_protocol_writer_t *, k_devjson_protocol_sink_t, void *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_begin_object, k_devjson_protocol_writer_t *, const char *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_end_object, k_devjson_protocol_writer_t *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_add, k_devjson_protocol_writer_t *, const char *, k_devjson_protocol_value_t, k_devjson_protocol_value_type_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_add_json, k_devjson_protocol_writer_t *, const char *, const cJSON *)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_writer_add_raw, k_devjson_protocol_writer_t *, const char *, const char *, size_t)
+DECLARE_FAKE_VALUE_FUNC(size_t, k_devjson_protocol_writer_finish, k_devjson_protocol_writer_t *)
 DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_add_response, cJSON *, const char *, k_devjson_protocol_value_t, k_devjson_protocol_value_type_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_add_raw_response, cJSON *, const char *, const char *, size_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_add_const_response, cJSON *, const char *, k_devjson_protocol_value_t, k_devjson_protocol_value_type_t)
+DECLARE_FAKE_VOID_FUNC(k_devjson_protocol_add_fixed_response, cJSON *, const char *, float, unsigned int)
+DECLARE_FAKE_VALUE_FUNC(int, k_devjson_protocol_defer, k_devjson_protocol_cb_arg_t *, k_devjson_protocol_pending_t *)
+DECLARE_FAKE_VALUE_FUNC(int, k_devjson_protocol_pending_complete, k_devjson_protocol_pending_t *, k_devjson_protocol_value_t, k_devjson_protocol_value_type_t)
 
 #ifdef __cplusplus
 }
@@ -12,6 +12,45 @@
 /* Macro ---------------------------------------------------------------------*/
 /* Typedef -------------------------------------------------------------------*/
 /* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Parse one request with the engine of a context, once the allocator and the arena are set up
+ * @param ctx Pointer to the context
+ * @param json_buffer Pointer to the buffer holding the request
+ * @param json_length Number of bytes of the request in the buffer
+ * @param output Pointer to the output destination
+ * @return Status of the parsing operation
+ */
+static k_devjson_protocol_parse_status_t k_devjson_protocol_ctx_run(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, size_t json_length,
+																	k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Add a value to a cJSON object, or write it with the writer embedding the object
+ * @param output_json Pointer to the object
+ * @param key Key of the value
+ * @param value Value to add
+ * @param value_type Type of the value
+ * @param const_key 1 to reference the key instead of copying it, the key must then outlive the object
+ */
+static void k_devjson_protocol_add_value_item(cJSON *output_json, const char *key, k_devjson_protocol_value_t value,
+											  k_devjson_protocol_value_type_t value_type, int const_key);
+
+/**
+ * @brief Add an item to a cJSON object, or release it if it cannot be added
+ * @param output_json Pointer to the object
+ * @param key Key of the item
+ * @param item Item to add, NULL after an allocation failure
+ * @param const_key 1 to reference the key instead of copying it, the key must then outlive the object
+ */
+static void k_devjson_protocol_add_item(cJSON *output_json, const char *key, cJSON *item, int const_key);
+
+/**
+ * @brief Add an empty object under a constant key
+ * @param output_json Pointer to the enclosing object
+ * @param key Key of the object, referenced: it must outlive the enclosing object
+ * @return Pointer to the new object, NULL if it could not be added
+ */
+static cJSON *k_devjson_protocol_add_const_object(cJSON *output_json, const char *key);
+
 /* Constant ------------------------------------------------------------------*/
 const char *k_devjson_protocol_id_key = "id";  //!< Key for the ID in DevJSON protocol
 
@@ -23,70 +62,188 @@ const char *k_devjson_protocol_set_key = "set";	 //!< Key for the SET group in D
 const char *k_devjson_protocol_cmd_key = "cmd";	 //!< Key for the CMD group in DevJSON protocol
 
 /* Variable ------------------------------------------------------------------*/
-k_devjson_protocol_callback_t k_devjson_protocol_callback = NULL;  //!< Global callback function for DevJSON protocol
+k_devjson_protocol_ctx_t k_devjson_protocol_default_ctx = {.callback = NULL, .config = {.engine = K_DEVJSON_PROTOCOL_ENGINE_DEFAULT}};	 //!< Default context
 
 /* Function Definition -------------------------------------------------------*/
 void k_devjson_protocol_register_callback(k_devjson_protocol_callback_t callback)
 {
-	k_devjson_protocol_callback = callback;	 //!< Register the callback function
+	k_devjson_protocol_default_ctx.callback = callback;	 //!< Register the callback function
+}
+
+void k_devjson_protocol_ctx_init(k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_callback_t callback, void *user_data)
+{
+	ctx->callback		  = callback;
+	ctx->user_data		  = user_data;
+	ctx->arena			  = NULL;
+	ctx->config.engine	  = K_DEVJSON_PROTOCOL_ENGINE_DEFAULT;
+	ctx->config.lazy_json = 0;
+	ctx->registry		  = NULL;
+	ctx->store			  = NULL;
+	ctx->store_cache	  = NULL;
+}
+
+void k_devjson_protocol_ctx_set_arena(k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_arena_t *arena)
+{
+	if (arena)
+	{
+		k_devjson_protocol_arena_install();
+	}
+	ctx->arena = arena;
 }
 
 k_devjson_protocol_parse_status_t k_devjson_protocol_parse(const char *json_string, char *output_string, const size_t output_string_size)
+{
+	return k_devjson_protocol_parse_n(json_string, json_string ? strlen(json_string) : 0, output_string, output_string_size);
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_n(const char *json_buffer, const size_t json_length, char *output_string,
+															 const size_t output_string_size)
+{
+	k_devjson_protocol_output_t output = {.buffer = output_string, .size = output_string_size};
+	return k_devjson_protocol_parse_output(json_buffer, json_length, &output);
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_output(const char *json_buffer, const size_t json_length, k_devjson_protocol_output_t *output)
+{
+	return k_devjson_protocol_ctx_parse(&k_devjson_protocol_default_ctx, json_buffer, json_length, output);
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_ctx_parse(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, const size_t json_length,
+															   k_devjson_protocol_output_t *output)
+{
+	k_devjson_protocol_parse_status_t parse_status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+	k_devjson_protocol_arena_t		 *thread_arena = NULL;
+	k_devjson_protocol_alloc_init();
+	if (ctx->arena)
+	{
+		thread_arena = k_devjson_protocol_arena_bind(ctx->arena);  //!< Restored when the parse returns
+	}
+	parse_status = k_devjson_protocol_ctx_run(ctx, json_buffer, json_length, output);
+	if (ctx->arena)
+	{
+		k_devjson_protocol_arena_bind(thread_arena);
+	}
+	return parse_status;
+}
+
+size_t k_devjson_protocol_parse_batch(k_devjson_protocol_batch_item_t *items, const size_t count)
+{
+	return k_devjson_protocol_ctx_parse_batch(&k_devjson_protocol_default_ctx, items, count);
+}
+
+size_t k_devjson_protocol_ctx_parse_batch(const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_batch_item_t *items, const size_t count)
+{
+	size_t						succeeded	 = 0;
+	k_devjson_protocol_arena_t *thread_arena = NULL;
+	if (items)
+	{
+		k_devjson_protocol_alloc_init();
+		if (ctx->arena)
+		{
+			thread_arena = k_devjson_protocol_arena_bind(ctx->arena);  //!< Bound once for the whole batch
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			/* Each request rewinds the arena to the same mark, so the batch runs in the scratch memory of one request */
+			items[i].status = k_devjson_protocol_ctx_run(ctx, items[i].json, items[i].length, &items[i].output);
+			succeeded += K_DEVJSON_PROTOCOL_PARSE_SUCCESS == items[i].status ? 1 : 0;
+		}
+		if (ctx->arena)
+		{
+			k_devjson_protocol_arena_bind(thread_arena);
+		}
+	}
+	return succeeded;
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_dom(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, const size_t json_length,
+															   k_devjson_protocol_output_t *output)
 {
 	k_devjson_protocol_parse_status_t parse_status	= K_DEVJSON_PROTOCOL_PARSE_ERROR;
-	cJSON							 *output_json	= cJSON_CreateObject();
 	int								  is_id_correct = 1;
-	if (k_devjson_protocol_callback)
+	int								  is_id_peeked	= 0;
+	int								  id			= -1;
+	if (ctx->callback)
 	{
 		parse_status = K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON;
-		if (json_string)
+		if (json_buffer)
 		{
-			cJSON *json = cJSON_Parse(json_string);
+			const size_t alloc_failures = k_devjson_protocol_alloc_failures();
+			cJSON		*output_json	= cJSON_CreateObject();
+			cJSON		*json			= NULL;
+			if (K_DEVJSON_PROTOCOL_PEEK_UNKNOWN != k_devjson_protocol_peek_id(json_buffer, json_length, &id))
+			{
+				is_id_peeked  = 1;
+				is_id_correct = (-1 == id) || k_devjson_protocol_check_id(ctx->callback, ctx->user_data, id);
+			}
+			if (is_id_correct)
+			{
+				json = cJSON_ParseWithLength(json_buffer, json_length);
+			}
+			else
+			{
+				parse_status = K_DEVJSON_PROTOCOL_PARSE_WRONG_ID;  //!< Request for another device: no tree is built
+			}
 			if (json)
 			{
-				int id = k_devjson_protocol_get_id(json);
-				if (-1 != id)
+				k_devjson_protocol_envelope_t envelope;
+				k_devjson_protocol_scan_envelope(json, &envelope);	//!< One walk over the members instead of a lookup per key
+				if (!is_id_peeked)
 				{
-					k_devjson_protocol_cb_arg_t id_cb_arg = {.group_type = K_DEVJSON_PROTOCOL_GROUP_TYPE_ID, .id = id};
-					k_devjson_protocol_callback(&id_cb_arg);
-					if (id == id_cb_arg.id)
-					{
-						cJSON_AddNumberToObject(output_json, k_devjson_protocol_id_key, id);  //!< Add the ID to the output JSON
-					}
-					else
-					{
-						parse_status  = K_DEVJSON_PROTOCOL_PARSE_WRONG_ID;
-						is_id_correct = 0;	//!< ID is not correct, set flag to false
-					}
+					id			  = cJSON_IsNumber(envelope.id) ? envelope.id->valueint : -1;
+					is_id_correct = (-1 == id) || k_devjson_protocol_check_id(ctx->callback, ctx->user_data, id);
+				}
+				if (!is_id_correct)
+				{
+					parse_status = K_DEVJSON_PROTOCOL_PARSE_WRONG_ID;
+				}
+				else if (-1 != id)
+				{
+					k_devjson_protocol_add_item(output_json, k_devjson_protocol_id_key, cJSON_CreateNumber(id), 1);  //!< Add the ID to the output JSON
 				}
 				if (is_id_correct)
 				{
-					cJSON *request_json = k_devjson_protocol_extract_request(json);
-					if (request_json)
+					if (envelope.req)
 					{
-						cJSON *res_output_json = cJSON_AddObjectToObject(output_json, k_devjson_protocol_res_key);
+						cJSON *res_output_json = k_devjson_protocol_add_const_object(output_json, k_devjson_protocol_res_key);
+						if (envelope.get)
+						{
+							k_devjson_protocol_ctx_process_group_entries(ctx, id, res_output_json, envelope.get, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET);
+						}
+						if (envelope.set)
+						{
+							k_devjson_protocol_ctx_process_group_entries(ctx, id, res_output_json, envelope.set, K_DEVJSON_PROTOCOL_GROUP_TYPE_SET);
+						}
+						if (envelope.cmd)
 						{
-							cJSON *get_group = k_devjson_protocol_get_group(request_json, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET);
-							cJSON *set_group = k_devjson_protocol_get_group(request_json, K_DEVJSON_PROTOCOL_GROUP_TYPE_SET);
-							cJSON *cmd_group = k_devjson_protocol_get_group(request_json, K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD);
-							if (get_group)
-							{
-								k_devjson_protocol_process_group_entries(id, res_output_json, get_group, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET);
-							}
-							if (set_group)
-							{
-								k_devjson_protocol_process_group_entries(id, res_output_json, set_group, K_DEVJSON_PROTOCOL_GROUP_TYPE_SET);
-							}
-							if (cmd_group)
-							{
-								k_devjson_protocol_process_group_entries(id, res_output_json, cmd_group, K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD);
-							}
+							k_devjson_protocol_ctx_process_group_entries(ctx, id, res_output_json, envelope.cmd, K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD);
 						}
 					}
 					parse_status = K_DEVJSON_PROTOCOL_PARSE_SUCCESS;
 				}
 			}
-			cJSON_PrintPreallocated(output_json, output_string, output_string_size, 0);
+			if (alloc_failures != k_devjson_protocol_alloc_failures())
+			{
+				/* Part of the request or of the response was dropped */
+				parse_status = K_DEVJSON_PROTOCOL_PARSE_OUT_OF_MEMORY;
+				cJSON_Delete(output_json);
+				cJSON_Delete(json);
+				json		= NULL;
+				output_json = cJSON_CreateObject();	 //!< Empty response, the pools have just been released
+			}
+			k_devjson_protocol_writer_t writer;
+			k_devjson_protocol_writer_init(&writer, output->buffer, output->size);
+			k_devjson_protocol_writer_set_sink(&writer, output->sink, output->sink_arg);
+			k_devjson_protocol_writer_json(&writer, output_json);  //!< Same output as cJSON_PrintPreallocated, with the size needed on overflow
+			output->length = k_devjson_protocol_writer_finish(&writer);
+			if (writer.sink_error && (K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parse_status))
+			{
+				parse_status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+			}
+			else if (writer.overflow && (K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parse_status))
+			{
+				parse_status = K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW;
+			}
 			cJSON_Delete(output_json);	//!< Clean up the output JSON object
 			cJSON_Delete(json);
 		}
@@ -94,24 +251,120 @@ k_devjson_protocol_parse_status_t k_devjson_protocol_parse(const char *json_stri
 	return parse_status;
 }
 
+static k_devjson_protocol_parse_status_t k_devjson_protocol_ctx_run(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, const size_t json_length,
+																	k_devjson_protocol_output_t *output)
+{
+	k_devjson_protocol_parse_status_t parse_status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+	const size_t					  arena_mark   = k_devjson_protocol_arena_enter();
+	if (K_DEVJSON_PROTOCOL_ENGINE_DOM == ctx->config.engine)
+	{
+		parse_status = k_devjson_protocol_parse_dom(ctx, json_buffer, json_length, output);
+	}
+	else
+	{
+		parse_status = k_devjson_protocol_parse_sax(ctx, json_buffer, json_length, output);
+	}
+	k_devjson_protocol_arena_leave(arena_mark);
+	return parse_status;
+}
+
+void k_devjson_protocol_parser_init(k_devjson_protocol_parser_t *parser, char *output_string, const size_t output_string_size)
+{
+	k_devjson_protocol_output_t output = {.buffer = output_string, .size = output_string_size};
+	k_devjson_protocol_parser_init_output(parser, &output);
+	parser->output = NULL;	//!< Local destination: nobody reads its length
+}
+
+void k_devjson_protocol_parser_init_output(k_devjson_protocol_parser_t *parser, k_devjson_protocol_output_t *output)
+{
+	k_devjson_protocol_ctx_parser_init(&k_devjson_protocol_default_ctx, parser, output);
+}
+
+void k_devjson_protocol_ctx_parser_init(const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_parser_t *parser, k_devjson_protocol_output_t *output)
+{
+	k_devjson_protocol_alloc_init();
+	k_devjson_protocol_parser_setup(parser, ctx, output);
+	if (!ctx->callback)
+	{
+		parser->status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+		parser->state  = K_DEVJSON_PROTOCOL_PARSER_STATE_DONE;
+		parser->active = 0;	 //!< Output left untouched, as k_devjson_protocol_parse does
+	}
+}
+
+void k_devjson_protocol_scan_envelope(const cJSON *json, k_devjson_protocol_envelope_t *envelope)
+{
+	const cJSON *item = json ? json->child : NULL;
+	envelope->id	  = NULL;
+	envelope->req	  = NULL;
+	envelope->get	  = NULL;
+	envelope->set	  = NULL;
+	envelope->cmd	  = NULL;
+	while (item)
+	{
+		if (item->string)
+		{
+			switch (k_devjson_protocol_parser_classify_key(item->string, 1))
+			{
+				case K_DEVJSON_PROTOCOL_PARSER_KEY_ID:
+					envelope->id = envelope->id ? envelope->id : item;
+					break;
+				case K_DEVJSON_PROTOCOL_PARSER_KEY_REQ:
+					envelope->req = envelope->req ? envelope->req : item;
+					break;
+				default:
+					break;
+			}
+		}
+		item = item->next;
+	}
+	item = envelope->req ? envelope->req->child : NULL;
+	while (item)
+	{
+		if (item->string)
+		{
+			switch (k_devjson_protocol_parser_classify_key(item->string, 2))
+			{
+				case K_DEVJSON_PROTOCOL_PARSER_KEY_GET:
+					envelope->get = envelope->get ? envelope->get : item;
+					break;
+				case K_DEVJSON_PROTOCOL_PARSER_KEY_SET:
+					envelope->set = envelope->set ? envelope->set : item;
+					break;
+				case K_DEVJSON_PROTOCOL_PARSER_KEY_CMD:
+					envelope->cmd = envelope->cmd ? envelope->cmd : item;
+					break;
+				default:
+					break;
+			}
+		}
+		item = item->next;
+	}
+}
+
+int k_devjson_protocol_check_id(const k_devjson_protocol_callback_t callback, void *user_data, const int id)
+{
+	k_devjson_protocol_cb_arg_t id_cb_arg	= {.id = id, .group_type = K_DEVJSON_PROTOCOL_GROUP_TYPE_ID, .user_data = user_data};
+	const size_t				arena_level = k_devjson_protocol_arena_suspend();
+	callback(&id_cb_arg);
+	k_devjson_protocol_arena_resume(arena_level);
+	return id == id_cb_arg.id;
+}
+
 int k_devjson_protocol_get_id(const cJSON *json)
 {
-	int id = -1;
-	if (cJSON_HasObjectItem(json, k_devjson_protocol_id_key) && cJSON_IsNumber(cJSON_GetObjectItem(json, k_devjson_protocol_id_key)))
+	int			 id		 = -1;
+	const cJSON *id_json = cJSON_GetObjectItemCaseSensitive(json, k_devjson_protocol_id_key);
+	if (cJSON_IsNumber(id_json))
 	{
-		id = cJSON_GetObjectItem(json, k_devjson_protocol_id_key)->valueint;  //!< Get the ID value from the JSON object
+		id = id_json->valueint;	 //!< Get the ID value from the JSON object
 	}
 	return id;
 }
 
 cJSON *k_devjson_protocol_extract_request(const cJSON *json)
 {
-	cJSON *request_json = NULL;
-	if (cJSON_HasObjectItem(json, k_devjson_protocol_req_key))
-	{
-		request_json = cJSON_GetObjectItem(json, k_devjson_protocol_req_key);
-	}
-	return request_json;
+	return cJSON_GetObjectItemCaseSensitive(json, k_devjson_protocol_req_key);
 }
 
 cJSON *k_devjson_protocol_get_group(const cJSON *json, k_devjson_protocol_group_type_t group_type)
@@ -134,22 +387,26 @@ cJSON *k_devjson_protocol_get_group(const cJSON *json, k_devjson_protocol_group_
 	}
 	if (group_type_key)
 	{
-		if (cJSON_HasObjectItem(json, group_type_key))
-		{
-			group_type_json = cJSON_GetObjectItem(json, group_type_key);
-		}
+		group_type_json = cJSON_GetObjectItemCaseSensitive(json, group_type_key);
 	}
 	return group_type_json;
 }
 
 void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const cJSON *group, k_devjson_protocol_group_type_t group_type)
+{
+	k_devjson_protocol_ctx_process_group_entries(&k_devjson_protocol_default_ctx, id, output_json, group, group_type);
+}
+
+void k_devjson_protocol_ctx_process_group_entries(const k_devjson_protocol_ctx_t *ctx, int id, cJSON *output_json, const cJSON *group,
+												  k_devjson_protocol_group_type_t group_type)
 {
 	(void)output_json;
 	k_devjson_protocol_cb_arg_t cb_arg = {0};
-	cJSON *group_type_response_json	   = K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == group_type ? cJSON_AddObjectToObject(output_json, k_devjson_protocol_get_key) :
-										 K_DEVJSON_PROTOCOL_GROUP_TYPE_SET == group_type ? cJSON_AddObjectToObject(output_json, k_devjson_protocol_set_key) :
-										 K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD == group_type ? cJSON_AddObjectToObject(output_json, k_devjson_protocol_cmd_key) :
+	const char *group_type_key		   = K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == group_type ? k_devjson_protocol_get_key :
+										 K_DEVJSON_PROTOCOL_GROUP_TYPE_SET == group_type ? k_devjson_protocol_set_key :
+										 K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD == group_type ? k_devjson_protocol_cmd_key :
 																						   NULL;
+	cJSON *group_type_response_json	   = group_type_key ? k_devjson_protocol_add_const_object(output_json, group_type_key) : NULL;
 	if (group_type_response_json)
 	{
 		cb_arg.group_type  = group_type;
@@ -164,7 +421,7 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 					cb_arg.key						= group->valuestring;
 					cb_arg.input_value.string_value = group->valuestring;
 					cb_arg.input_value_type			= K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING;
-					k_devjson_protocol_callback(&cb_arg);
+					k_devjson_protocol_registry_dispatch(ctx->store, ctx->store_cache, ctx->registry, ctx->callback, ctx->user_data, &cb_arg);
 				}
 				else if (cJSON_IsArray(group))
 				{
@@ -179,14 +436,13 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 						}
 						else if (cJSON_IsNumber(current_item))
 						{
-							cb_arg.input_value.float_value = (float)current_item->valuedouble;
-							cb_arg.input_value_type		   = K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT;
+							cb_arg.input_value_type = k_devjson_protocol_number_value(current_item->valuedouble, &cb_arg.input_value);
 						}
 						else
 						{
 							cb_arg.input_value_type = K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN;
 						}
-						k_devjson_protocol_callback(&cb_arg);
+						k_devjson_protocol_registry_dispatch(ctx->store, ctx->store_cache, ctx->registry, ctx->callback, ctx->user_data, &cb_arg);
 						current_item = current_item->next;	//!< Move to the next item in the group
 					}
 				}
@@ -205,14 +461,18 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 						}
 						else if (cJSON_IsNumber(current_item))
 						{
-							cb_arg.input_value.float_value = (float)current_item->valuedouble;
-							cb_arg.input_value_type		   = K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT;
+							cb_arg.input_value_type = k_devjson_protocol_number_value(current_item->valuedouble, &cb_arg.input_value);
+						}
+						else if (cJSON_IsBool(current_item))
+						{
+							cb_arg.input_value.bool_value = cJSON_IsTrue(current_item) ? 1 : 0;
+							cb_arg.input_value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL;
 						}
 						else
 						{
 							cb_arg.input_value_type = K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN;
 						}
-						k_devjson_protocol_callback(&cb_arg);
+						k_devjson_protocol_registry_dispatch(ctx->store, ctx->store_cache, ctx->registry, ctx->callback, ctx->user_data, &cb_arg);
 						current_item = current_item->next;	//!< Move to the next item in the group
 					}
 				}
@@ -223,7 +483,8 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 					cJSON *current_item = group->child;
 					while (current_item)
 					{
-						cb_arg.key = current_item->string;
+						k_devjson_protocol_lazy_t lazy = {NULL, 0, NULL, 0};
+						cb_arg.key					   = current_item->string;
 						if (cJSON_IsString(current_item))
 						{
 							cb_arg.input_value.string_value = current_item->valuestring;
@@ -231,14 +492,19 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 						}
 						else if (cJSON_IsNumber(current_item))
 						{
-							cb_arg.input_value.float_value = (float)current_item->valuedouble;
-							cb_arg.input_value_type		   = K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT;
+							cb_arg.input_value_type = k_devjson_protocol_number_value(current_item->valuedouble, &cb_arg.input_value);
 						}
 						else if (cJSON_IsBool(current_item))
 						{
 							cb_arg.input_value.bool_value = cJSON_IsTrue(current_item) ? 1 : 0;	 //!< Convert cJSON boolean to integer
 							cb_arg.input_value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL;
 						}
+						else if (cJSON_IsObject(current_item) && ctx->config.lazy_json)
+						{
+							lazy.item					  = current_item;  //!< Already parsed with the request: the accessors read the tree
+							cb_arg.input_value.lazy_value = &lazy;
+							cb_arg.input_value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON;
+						}
 						else if (cJSON_IsObject(current_item))
 						{
 							cb_arg.input_value.json_value = current_item;  //!< Convert cJSON boolean to integer
@@ -248,7 +514,7 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 						{
 							cb_arg.input_value_type = K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN;
 						}
-						k_devjson_protocol_callback(&cb_arg);
+						k_devjson_protocol_registry_dispatch(ctx->store, ctx->store_cache, ctx->registry, ctx->callback, ctx->user_data, &cb_arg);
 						current_item = current_item->next;	//!< Move to the next item in the group
 					}
 				}
@@ -261,25 +527,106 @@ void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const
 
 void k_devjson_protocol_add_response(cJSON *output_json, const char *key, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type)
 {
-	if (output_json && key)
+	k_devjson_protocol_add_value_item(output_json, key, value, value_type, 0);
+}
+
+void k_devjson_protocol_add_const_response(cJSON *output_json, const char *key, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type)
+{
+	k_devjson_protocol_add_value_item(output_json, key, value, value_type, 1);
+}
+
+void k_devjson_protocol_add_raw_response(cJSON *output_json, const char *key, const char *json, const size_t length)
+{
+	k_devjson_protocol_add_raw_item(output_json, key, json, length, 0);
+}
+
+void k_devjson_protocol_add_fixed_response(cJSON *output_json, const char *key, const float value, const unsigned int decimals)
+{
+	char number[K_DEVJSON_PROTOCOL_FLOAT_SIZE];
+	k_devjson_protocol_add_raw_item(output_json, key, number, k_devjson_protocol_float_fixed(value, decimals, number), 0);
+}
+
+void k_devjson_protocol_add_raw_item(cJSON *output_json, const char *key, const char *json, const size_t length, const int const_key)
+{
+	if (output_json && key && (output_json->type & K_DEVJSON_PROTOCOL_WRITER_ITEMS))
+	{
+		k_devjson_protocol_writer_add_raw((k_devjson_protocol_writer_t *)output_json, key, json, length);
+	}
+	else if (output_json && key && json && length)
+	{
+		/* cJSON keeps raw items NUL-terminated */
+		char *raw = (char *)cJSON_malloc(length + 1);
+		if (raw)
+		{
+			memcpy(raw, json, length);
+			raw[length] = '\0';
+			k_devjson_protocol_add_item(output_json, key, cJSON_CreateRaw(raw), const_key);
+			cJSON_free(raw);
+		}
+	}
+}
+
+static void k_devjson_protocol_add_value_item(cJSON *output_json, const char *key, k_devjson_protocol_value_t value,
+											  const k_devjson_protocol_value_type_t value_type, const int const_key)
+{
+	if (output_json && key && (output_json->type & K_DEVJSON_PROTOCOL_WRITER_ITEMS))
 	{
+		/* Object handed to the callback by a writer: the writer is its enclosing struct */
+		k_devjson_protocol_writer_add((k_devjson_protocol_writer_t *)output_json, key, value, value_type);
+	}
+	else if (output_json && key && (K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON == value_type) && value.lazy_value && !value.lazy_value->item &&
+			 value.lazy_value->json)
+	{
+		k_devjson_protocol_add_raw_item(output_json, key, value.lazy_value->json, value.lazy_value->length, const_key);
+	}
+	else if (output_json && key)
+	{
+		char   number[K_DEVJSON_PROTOCOL_FLOAT_SIZE];
+		cJSON *item = NULL;
 		switch (value_type)
 		{
 			case K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER:
-				cJSON_AddNumberToObject(output_json, key, value.int_value);
+				item = cJSON_CreateNumber(value.int_value);
 				break;
 			case K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT:
-				cJSON_AddNumberToObject(output_json, key, value.float_value);
+				/* Raw item: cJSON would print the float widened to a double, 2.1f as 2.0999999046325684 */
+				k_devjson_protocol_float_format(value.float_value, number);
+				item = cJSON_CreateRaw(number);
 				break;
 			case K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING:
-				cJSON_AddStringToObject(output_json, key, value.string_value);
+				item = cJSON_CreateString(value.string_value);
 				break;
 			case K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL:
-				cJSON_AddBoolToObject(output_json, key, value.bool_value);
+				item = cJSON_CreateBool(value.bool_value);
+				break;
+			case K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON:
+				item = value.lazy_value && value.lazy_value->item ? cJSON_Duplicate(value.lazy_value->item, 1) : cJSON_CreateNull();
 				break;
 			default:
-				cJSON_AddNullToObject(output_json, key);  //!< Add null if the output value type is unknown
+				item = cJSON_CreateNull();	//!< Add null if the output value type is unknown
 				break;
 		}
+		k_devjson_protocol_add_item(output_json, key, item, const_key);
+	}
+}
+
+static void k_devjson_protocol_add_item(cJSON *output_json, const char *key, cJSON *item, const int const_key)
+{
+	/* A constant key is referenced by the item instead of copied: cJSON_Delete does not free it either */
+	const cJSON_bool added = const_key ? cJSON_AddItemToObjectCS(output_json, key, item) : cJSON_AddItemToObject(output_json, key, item);
+	if (!added)
+	{
+		cJSON_Delete(item);	 //!< The copy of the key failed: the item is not owned by the object
+	}
+}
+
+static cJSON *k_devjson_protocol_add_const_object(cJSON *output_json, const char *key)
+{
+	cJSON *object = cJSON_CreateObject();
+	if (!cJSON_AddItemToObjectCS(output_json, key, object))
+	{
+		cJSON_Delete(object);
+		object = NULL;
 	}
+	return object;
 }
\ No newline at end of file
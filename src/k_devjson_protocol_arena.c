@@ -0,0 +1,309 @@
+/**
+ * @file k_devjson_protocol_arena.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_ARENA_ALIGN(size) (((size) + (K_DEVJSON_PROTOCOL_ARENA_ALIGNMENT - 1)) & ~(size_t)(K_DEVJSON_PROTOCOL_ARENA_ALIGNMENT - 1))
+
+/* Typedef -------------------------------------------------------------------*/
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+/**
+ * @brief Block of the node pool: a cJSON item or a short string
+ */
+typedef union k_devjson_protocol_pool_node
+{
+	union k_devjson_protocol_pool_node *next;  //!< Next free block
+	cJSON								item;  //!< Item handed to cJSON
+} k_devjson_protocol_pool_node_t;
+
+/**
+ * @brief Block of the string pool
+ */
+typedef union k_devjson_protocol_pool_string
+{
+	union k_devjson_protocol_pool_string *next;											//!< Next free block
+	char								  string[K_DEVJSON_PROTOCOL_POOL_STRING_SIZE];	//!< String handed to cJSON
+} k_devjson_protocol_pool_string_t;
+#endif
+
+/* Function Declaration ------------------------------------------------------*/
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+/**
+ * @brief cJSON malloc hook: block from the node pool, or from the string pool for longer strings
+ * @param size Number of bytes requested
+ * @return Pointer to the block, NULL if the pools are exhausted
+ */
+static void *k_devjson_protocol_pool_malloc(size_t size);
+
+/**
+ * @brief cJSON free hook: give the block back to its pool
+ * @param pointer Pointer to the block
+ */
+static void k_devjson_protocol_pool_free(void *pointer);
+#else
+/**
+ * @brief cJSON malloc hook: bump allocation from the arena of the calling thread
+ * @param size Number of bytes requested
+ * @return Pointer to the block, NULL if the heap fallback fails
+ */
+static void *k_devjson_protocol_arena_malloc(size_t size);
+
+/**
+ * @brief cJSON free hook: blocks of the arena are released when the parse returns
+ * @param pointer Pointer to the block
+ */
+static void k_devjson_protocol_arena_free(void *pointer);
+#endif
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+static K_DEVJSON_PROTOCOL_THREAD_LOCAL size_t k_devjson_protocol_alloc_failure_count = 0;	//!< Allocations that returned NULL on the calling thread
+static int									  k_devjson_protocol_alloc_hooks_installed = 0;	//!< cJSON hooks already redirected to the library allocator
+
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+static k_devjson_protocol_pool_node_t	k_devjson_protocol_pool_nodes[K_DEVJSON_PROTOCOL_POOL_NODES];	  //!< Node pool
+static k_devjson_protocol_pool_string_t k_devjson_protocol_pool_strings[K_DEVJSON_PROTOCOL_POOL_STRINGS];  //!< String pool
+static k_devjson_protocol_pool_node_t  *k_devjson_protocol_pool_free_nodes	   = NULL;  //!< Released node blocks
+static k_devjson_protocol_pool_string_t *k_devjson_protocol_pool_free_strings  = NULL;  //!< Released string blocks
+static size_t							 k_devjson_protocol_pool_nodes_used	   = 0;		//!< Node blocks never handed out start here
+static size_t							 k_devjson_protocol_pool_strings_used  = 0;		//!< String blocks never handed out start here
+#else
+static K_DEVJSON_PROTOCOL_THREAD_LOCAL k_devjson_protocol_arena_t *k_devjson_protocol_arena_current = NULL;  //!< Arena bound to the calling thread
+static K_DEVJSON_PROTOCOL_THREAD_LOCAL size_t k_devjson_protocol_arena_active = 0;  //!< Nesting level of the parses using the arena
+#endif
+
+/* Function Definition -------------------------------------------------------*/
+void k_devjson_protocol_arena_init(k_devjson_protocol_arena_t *arena, void *buffer, const size_t size)
+{
+	if (arena)
+	{
+		size_t padding = 0;
+		if (buffer)
+		{
+			padding = K_DEVJSON_PROTOCOL_ARENA_ALIGN((uintptr_t)buffer) - (uintptr_t)buffer;
+		}
+		arena->buffer	 = (unsigned char *)buffer + padding;
+		arena->size		 = size > padding ? size - padding : 0;
+		arena->used		 = 0;
+		arena->peak		 = 0;
+		arena->fallbacks = 0;
+	}
+}
+
+void k_devjson_protocol_alloc_init(void)
+{
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+	if (!k_devjson_protocol_alloc_hooks_installed)
+	{
+		cJSON_Hooks hooks = {.malloc_fn = k_devjson_protocol_pool_malloc, .free_fn = k_devjson_protocol_pool_free};
+		cJSON_InitHooks(&hooks);
+		k_devjson_protocol_alloc_hooks_installed = 1;
+	}
+#endif
+}
+
+size_t k_devjson_protocol_alloc_failures(void)
+{
+	return k_devjson_protocol_alloc_failure_count;
+}
+
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+void k_devjson_protocol_set_arena(k_devjson_protocol_arena_t *arena)
+{
+	(void)arena;  //!< Every allocation already comes from the static pools
+}
+
+void k_devjson_protocol_arena_install(void)
+{
+}
+
+k_devjson_protocol_arena_t *k_devjson_protocol_arena_bind(k_devjson_protocol_arena_t *arena)
+{
+	(void)arena;
+	return NULL;
+}
+
+size_t k_devjson_protocol_arena_enter(void)
+{
+	return 0;
+}
+
+void k_devjson_protocol_arena_leave(const size_t mark)
+{
+	(void)mark;
+}
+
+size_t k_devjson_protocol_arena_suspend(void)
+{
+	return 0;
+}
+
+void k_devjson_protocol_arena_resume(const size_t level)
+{
+	(void)level;
+}
+
+static void *k_devjson_protocol_pool_malloc(const size_t size)
+{
+	void *pointer = NULL;
+	if (size <= sizeof(k_devjson_protocol_pool_node_t))
+	{
+		if (k_devjson_protocol_pool_free_nodes)
+		{
+			pointer							   = k_devjson_protocol_pool_free_nodes;
+			k_devjson_protocol_pool_free_nodes = k_devjson_protocol_pool_free_nodes->next;
+		}
+		else if (k_devjson_protocol_pool_nodes_used < K_DEVJSON_PROTOCOL_POOL_NODES)
+		{
+			pointer = &k_devjson_protocol_pool_nodes[k_devjson_protocol_pool_nodes_used++];
+		}
+	}
+	if (!pointer && size <= sizeof(k_devjson_protocol_pool_string_t))
+	{
+		if (k_devjson_protocol_pool_free_strings)
+		{
+			pointer								 = k_devjson_protocol_pool_free_strings;
+			k_devjson_protocol_pool_free_strings = k_devjson_protocol_pool_free_strings->next;
+		}
+		else if (k_devjson_protocol_pool_strings_used < K_DEVJSON_PROTOCOL_POOL_STRINGS)
+		{
+			pointer = &k_devjson_protocol_pool_strings[k_devjson_protocol_pool_strings_used++];
+		}
+	}
+	if (!pointer)
+	{
+		k_devjson_protocol_alloc_failure_count++;
+	}
+	return pointer;
+}
+
+static void k_devjson_protocol_pool_free(void *pointer)
+{
+	const uintptr_t address = (uintptr_t)pointer;
+	if (address >= (uintptr_t)k_devjson_protocol_pool_nodes && address < (uintptr_t)(k_devjson_protocol_pool_nodes + K_DEVJSON_PROTOCOL_POOL_NODES))
+	{
+		k_devjson_protocol_pool_node_t *node = pointer;
+		node->next							 = k_devjson_protocol_pool_free_nodes;
+		k_devjson_protocol_pool_free_nodes	 = node;
+	}
+	else if (address >= (uintptr_t)k_devjson_protocol_pool_strings &&
+			 address < (uintptr_t)(k_devjson_protocol_pool_strings + K_DEVJSON_PROTOCOL_POOL_STRINGS))
+	{
+		k_devjson_protocol_pool_string_t *string = pointer;
+		string->next							 = k_devjson_protocol_pool_free_strings;
+		k_devjson_protocol_pool_free_strings	 = string;
+	}
+	else
+	{
+		free(pointer);	//!< Allocated by cJSON before the hooks were installed
+	}
+}
+#else
+void k_devjson_protocol_set_arena(k_devjson_protocol_arena_t *arena)
+{
+	if (arena)
+	{
+		k_devjson_protocol_arena_install();
+	}
+	k_devjson_protocol_arena_bind(arena);
+}
+
+void k_devjson_protocol_arena_install(void)
+{
+	if (!k_devjson_protocol_alloc_hooks_installed)
+	{
+		cJSON_Hooks hooks = {.malloc_fn = k_devjson_protocol_arena_malloc, .free_fn = k_devjson_protocol_arena_free};
+		cJSON_InitHooks(&hooks);
+		k_devjson_protocol_alloc_hooks_installed = 1;
+	}
+}
+
+k_devjson_protocol_arena_t *k_devjson_protocol_arena_bind(k_devjson_protocol_arena_t *arena)
+{
+	k_devjson_protocol_arena_t *previous = k_devjson_protocol_arena_current;
+	k_devjson_protocol_arena_current	 = arena;
+	return previous;
+}
+
+size_t k_devjson_protocol_arena_enter(void)
+{
+	size_t mark = 0;
+	if (k_devjson_protocol_arena_current)
+	{
+		mark = k_devjson_protocol_arena_current->used;
+		k_devjson_protocol_arena_active++;
+	}
+	return mark;
+}
+
+void k_devjson_protocol_arena_leave(const size_t mark)
+{
+	if (k_devjson_protocol_arena_current && k_devjson_protocol_arena_active)
+	{
+		k_devjson_protocol_arena_current->used = mark;
+		k_devjson_protocol_arena_active--;
+	}
+}
+
+size_t k_devjson_protocol_arena_suspend(void)
+{
+	const size_t level = k_devjson_protocol_arena_active;
+	k_devjson_protocol_arena_active = 0;
+	return level;
+}
+
+void k_devjson_protocol_arena_resume(const size_t level)
+{
+	k_devjson_protocol_arena_active = level;
+}
+
+static void *k_devjson_protocol_arena_malloc(const size_t size)
+{
+	void					   *pointer = NULL;
+	k_devjson_protocol_arena_t *arena	= k_devjson_protocol_arena_current;
+	if (arena && k_devjson_protocol_arena_active)
+	{
+		const size_t block_size = K_DEVJSON_PROTOCOL_ARENA_ALIGN(size);
+		if (block_size >= size && block_size <= arena->size - arena->used)
+		{
+			pointer = arena->buffer + arena->used;
+			arena->used += block_size;
+			if (arena->used > arena->peak)
+			{
+				arena->peak = arena->used;
+			}
+		}
+		else
+		{
+			arena->fallbacks++;
+		}
+	}
+	if (!pointer)
+	{
+		pointer = malloc(size);
+		if (!pointer)
+		{
+			k_devjson_protocol_alloc_failure_count++;
+		}
+	}
+	return pointer;
+}
+
+static void k_devjson_protocol_arena_free(void *pointer)
+{
+	const k_devjson_protocol_arena_t *arena	  = k_devjson_protocol_arena_current;
+	const uintptr_t					  address = (uintptr_t)pointer;
+	if (!arena || address < (uintptr_t)arena->buffer || address >= (uintptr_t)arena->buffer + arena->size)
+	{
+		free(pointer);
+	}
+}
+#endif
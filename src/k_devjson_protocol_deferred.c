@@ -0,0 +1,114 @@
+/**
+ * @file k_devjson_protocol_deferred.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Insert the values of the deferred keys in the response and fire the completion of the request
+ * @param deferred Pointer to the request
+ */
+static void k_devjson_protocol_deferred_resolve(k_devjson_protocol_deferred_t *deferred);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+int k_devjson_protocol_defer(k_devjson_protocol_cb_arg_t *cb_arg, k_devjson_protocol_pending_t *pending)
+{
+	int result = -1;
+	if (cb_arg && cb_arg->deferred && cb_arg->writer && cb_arg->key && pending)
+	{
+		k_devjson_protocol_deferred_t *deferred = cb_arg->deferred;
+		pending->deferred						= deferred;
+		pending->offset							= k_devjson_protocol_writer_placeholder(cb_arg->writer, cb_arg->key);
+		pending->length							= 0;
+		pending->next							= deferred->pending;
+		deferred->pending						= pending;
+		(void)K_DEVJSON_PROTOCOL_ATOMIC_INCREMENT(&deferred->remaining);  //!< The parse holds a reference: it cannot drop to zero here
+		result = 0;
+	}
+	return result;
+}
+
+int k_devjson_protocol_pending_complete(k_devjson_protocol_pending_t *pending, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type)
+{
+	int							result = -1;
+	k_devjson_protocol_writer_t writer;
+	k_devjson_protocol_writer_init(&writer, pending->json, sizeof(pending->json));
+	k_devjson_protocol_writer_value(&writer, value, value_type);
+	if (writer.overflow)
+	{
+		memcpy(pending->json, "null", 4);
+		pending->length = 4;
+	}
+	else
+	{
+		pending->length = writer.length;
+		result			= 0;
+	}
+	k_devjson_protocol_deferred_release(pending->deferred);
+	return result;
+}
+
+void k_devjson_protocol_deferred_begin(k_devjson_protocol_deferred_t *deferred, k_devjson_protocol_output_t *output)
+{
+	deferred->status	= K_DEVJSON_PROTOCOL_PARSE_PENDING;
+	deferred->output	= output;
+	deferred->pending	= NULL;
+	K_DEVJSON_PROTOCOL_ATOMIC_STORE(&deferred->remaining, 1);	//!< Held by the parse until it ends
+}
+
+void k_devjson_protocol_deferred_release(k_devjson_protocol_deferred_t *deferred)
+{
+	/* Acquire and release: the thread that drops the last reference sees the values written by the others */
+	if (0 == K_DEVJSON_PROTOCOL_ATOMIC_DECREMENT(&deferred->remaining))
+	{
+		k_devjson_protocol_deferred_resolve(deferred);
+	}
+}
+
+static void k_devjson_protocol_deferred_resolve(k_devjson_protocol_deferred_t *deferred)
+{
+	k_devjson_protocol_output_t *output = deferred->output;
+	size_t						 length = output->length;
+	for (const k_devjson_protocol_pending_t *pending = deferred->pending; pending; pending = pending->next)
+	{
+		length += pending->length;
+	}
+	if ((K_DEVJSON_PROTOCOL_PARSE_SUCCESS == deferred->status) && (length < output->size))
+	{
+		/* Keys are listed the last one first: inserting from the end leaves the positions of the others valid */
+		size_t end = output->length;
+		for (const k_devjson_protocol_pending_t *pending = deferred->pending; pending; pending = pending->next)
+		{
+			memmove(output->buffer + pending->offset + pending->length, output->buffer + pending->offset, end - pending->offset);
+			memcpy(output->buffer + pending->offset, pending->json, pending->length);
+			end += pending->length;
+		}
+		output->buffer[length] = '\0';
+		output->length		   = length;
+	}
+	else if ((K_DEVJSON_PROTOCOL_PARSE_SUCCESS == deferred->status) || (K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW == deferred->status))
+	{
+		/* Same output as an overflow of the parse: an empty string, and the size needed */
+		if (output->size)
+		{
+			output->buffer[0] = '\0';
+		}
+		output->length	 = length;
+		deferred->status = K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW;
+	}
+	deferred->pending = NULL;
+	if (deferred->completion)
+	{
+		deferred->completion(deferred);
+	}
+}
@@ -0,0 +1,224 @@
+/**
+ * @file k_devjson_protocol_executor.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_devjson_protocol_executor.h"
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+#define K_DEVJSON_PROTOCOL_EXECUTOR_AVAILABLE 0	 //!< The pools are not shared between threads
+#else
+#define K_DEVJSON_PROTOCOL_EXECUTOR_AVAILABLE 1	 //!< Workers can allocate concurrently
+#endif
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Thread of a worker: parse the queued jobs until the executor stops and the queue is empty
+ * @param arg Pointer to the worker
+ * @return NULL
+ */
+static void *k_devjson_protocol_executor_work(void *arg);
+
+/**
+ * @brief Refuse new jobs and wait for the worker threads to drain the queue and exit
+ * @param executor Pointer to the executor
+ */
+static void k_devjson_protocol_executor_join(k_devjson_protocol_executor_t *executor);
+
+/**
+ * @brief Fire the completion callback of a parsed job, after the completions of the jobs submitted before it on its channel
+ * @param executor Pointer to the executor
+ * @param job Pointer to the parsed job
+ */
+static void k_devjson_protocol_executor_complete(k_devjson_protocol_executor_t *executor, k_devjson_protocol_job_t *job);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+int k_devjson_protocol_executor_init(k_devjson_protocol_executor_t *executor, const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_worker_t *workers,
+									 k_devjson_protocol_arena_t *arenas, const size_t count)
+{
+	int result = -1;
+	if (executor && ctx && workers && count)
+	{
+		memset(executor, 0, sizeof(*executor));
+		executor->workers = workers;
+		executor->count	  = count;
+		for (size_t i = 0; i < count; i++)
+		{
+			workers[i].ctx			   = *ctx;
+			workers[i].ctx.store_cache = NULL;	//!< Rewritten by the parse that reads it
+			workers[i].executor		   = executor;
+			workers[i].processed	   = 0;
+			k_devjson_protocol_ctx_set_arena(&workers[i].ctx, arenas ? &arenas[i] : NULL);	//!< An arena serves one parse at a time
+		}
+		if (0 == pthread_mutex_init(&executor->lock, NULL))
+		{
+			if (0 == pthread_cond_init(&executor->ready, NULL))
+			{
+				result = 0;
+			}
+			else
+			{
+				pthread_mutex_destroy(&executor->lock);
+			}
+		}
+	}
+	return result;
+}
+
+int k_devjson_protocol_executor_start(k_devjson_protocol_executor_t *executor)
+{
+	int result = -1;
+	if (K_DEVJSON_PROTOCOL_EXECUTOR_AVAILABLE)
+	{
+		k_devjson_protocol_alloc_init();  //!< Hooks installed before the workers allocate
+		executor->running = 1;
+		while ((executor->started < executor->count) && (0 == pthread_create(&executor->workers[executor->started].thread, NULL,
+																			  k_devjson_protocol_executor_work, &executor->workers[executor->started])))
+		{
+			executor->started++;
+		}
+		if (executor->started == executor->count)
+		{
+			result = 0;
+		}
+		else
+		{
+			k_devjson_protocol_executor_join(executor);
+		}
+	}
+	return result;
+}
+
+int k_devjson_protocol_executor_submit(k_devjson_protocol_executor_t *executor, k_devjson_protocol_job_t *job)
+{
+	int result = -1;
+	if (job && job->completion)
+	{
+		pthread_mutex_lock(&executor->lock);
+		if (executor->running)
+		{
+			job->next = NULL;
+			if (job->channel)
+			{
+				job->sequence = job->channel->submitted++;
+			}
+			if (executor->tail)
+			{
+				executor->tail->next = job;
+			}
+			else
+			{
+				executor->head = job;
+			}
+			executor->tail = job;
+			pthread_cond_signal(&executor->ready);
+			result = 0;
+		}
+		pthread_mutex_unlock(&executor->lock);
+	}
+	return result;
+}
+
+void k_devjson_protocol_executor_stop(k_devjson_protocol_executor_t *executor)
+{
+	k_devjson_protocol_executor_join(executor);
+	pthread_cond_destroy(&executor->ready);
+	pthread_mutex_destroy(&executor->lock);
+}
+
+void k_devjson_protocol_channel_init(k_devjson_protocol_channel_t *channel)
+{
+	channel->parked		= NULL;
+	channel->submitted	= 0;
+	channel->delivered	= 0;
+	channel->delivering = 0;
+}
+
+static void *k_devjson_protocol_executor_work(void *arg)
+{
+	k_devjson_protocol_worker_t	  *worker	= arg;
+	k_devjson_protocol_executor_t *executor = worker->executor;
+	k_devjson_protocol_job_t	  *job		= NULL;
+	pthread_mutex_lock(&executor->lock);
+	do
+	{
+		while (!executor->head && executor->running)
+		{
+			pthread_cond_wait(&executor->ready, &executor->lock);
+		}
+		job = executor->head;
+		if (job)
+		{
+			executor->head = job->next;
+			executor->tail = executor->head ? executor->tail : NULL;
+			pthread_mutex_unlock(&executor->lock);
+			job->status = k_devjson_protocol_ctx_parse(&worker->ctx, job->json, job->length, &job->output);
+			worker->processed++;
+			k_devjson_protocol_executor_complete(executor, job);
+			pthread_mutex_lock(&executor->lock);
+		}
+	} while (job);	//!< The queue is drained before the worker exits
+	pthread_mutex_unlock(&executor->lock);
+	return NULL;
+}
+
+static void k_devjson_protocol_executor_join(k_devjson_protocol_executor_t *executor)
+{
+	pthread_mutex_lock(&executor->lock);
+	executor->running = 0;
+	pthread_cond_broadcast(&executor->ready);
+	pthread_mutex_unlock(&executor->lock);
+	for (size_t i = 0; i < executor->started; i++)
+	{
+		pthread_join(executor->workers[i].thread, NULL);
+	}
+	executor->started = 0;
+}
+
+static void k_devjson_protocol_executor_complete(k_devjson_protocol_executor_t *executor, k_devjson_protocol_job_t *job)
+{
+	k_devjson_protocol_channel_t *channel = job->channel;
+	if (channel)
+	{
+		pthread_mutex_lock(&executor->lock);
+		job->next		= channel->parked;
+		channel->parked = job;
+		if (!channel->delivering)
+		{
+			/* This worker fires the completions of the channel in order until the next one is still being parsed */
+			channel->delivering = 1;
+			do
+			{
+				k_devjson_protocol_job_t **link = &channel->parked;
+				while (*link && ((*link)->sequence != channel->delivered))
+				{
+					link = &(*link)->next;
+				}
+				job = *link;
+				if (job)
+				{
+					*link = job->next;
+					channel->delivered++;
+					pthread_mutex_unlock(&executor->lock);
+					job->completion(job);
+					pthread_mutex_lock(&executor->lock);
+				}
+			} while (job);
+			channel->delivering = 0;
+		}
+		pthread_mutex_unlock(&executor->lock);
+	}
+	else
+	{
+		job->completion(job);
+	}
+}
@@ -0,0 +1,408 @@
+/**
+ * @file k_devjson_protocol_float.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_FLOAT_MANTISSA_BITS	   23  //!< Stored bits of the significand of a float
+#define K_DEVJSON_PROTOCOL_FLOAT_BIAS			   127 //!< Exponent bias of a float
+#define K_DEVJSON_PROTOCOL_FLOAT_POW5_INV_BITCOUNT 59  //!< Precision of the table of 2^k / 5^q
+#define K_DEVJSON_PROTOCOL_FLOAT_POW5_BITCOUNT	   61  //!< Precision of the table of 5^i / 2^k
+#define K_DEVJSON_PROTOCOL_FLOAT_FIXED_LIMIT	   1e17	 //!< Largest scaled value printed in fixed notation
+
+/* Typedef -------------------------------------------------------------------*/
+/**
+ * @brief Decimal value mantissa * 10^exponent
+ */
+typedef struct
+{
+	uint32_t mantissa;	//!< Decimal digits
+	int32_t	 exponent;	//!< Power of ten of the last digit
+} k_devjson_protocol_decimal_t;
+
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Shortest decimal that reads back as the same float, Ryu algorithm by Ulf Adams
+ * @param ieee_mantissa Stored significand bits of a finite float
+ * @param ieee_exponent Biased exponent bits of a finite float
+ * @return Digits and power of ten of the decimal
+ */
+static k_devjson_protocol_decimal_t k_devjson_protocol_float_decimal(uint32_t ieee_mantissa, uint32_t ieee_exponent);
+
+/**
+ * @brief Number of bits of 5^e, 1 for e = 0
+ * @param e Power of five, from 0 to 3528
+ * @return ceil(log2(5^e)), or 1
+ */
+static int32_t k_devjson_protocol_float_pow5_bits(int32_t e);
+
+/**
+ * @brief Power of ten of 2^e
+ * @param e Power of two, from 0 to 1650
+ * @return floor(log10(2^e))
+ */
+static uint32_t k_devjson_protocol_float_log10_pow2(int32_t e);
+
+/**
+ * @brief Power of ten of 5^e
+ * @param e Power of five, from 0 to 2620
+ * @return floor(log10(5^e))
+ */
+static uint32_t k_devjson_protocol_float_log10_pow5(int32_t e);
+
+/**
+ * @brief Check whether a value is divisible by 5^p
+ * @param value Value to check, not 0
+ * @param p Power of five
+ * @return 1 if it is divisible, 0 if not
+ */
+static uint32_t k_devjson_protocol_float_multiple_of_pow5(uint32_t value, uint32_t p);
+
+/**
+ * @brief Multiply by a 64-bit factor and shift right, keeping 32 bits of the product
+ * @param m Value to multiply
+ * @param factor Entry of one of the power of five tables
+ * @param shift Right shift of the product, more than 32
+ * @return (m * factor) >> shift
+ */
+static uint32_t k_devjson_protocol_float_mul_shift(uint32_t m, uint64_t factor, int32_t shift);
+
+/**
+ * @brief Write the decimal digits of a value
+ * @param value Value to write, not 0
+ * @param digits Destination of the digits, at least 10 characters, not NUL-terminated
+ * @return Number of digits
+ */
+static size_t k_devjson_protocol_float_digits(uint64_t value, char *digits);
+
+/* Constant ------------------------------------------------------------------*/
+/**
+ * @brief floor(2^k / 5^q) + 1, k being K_DEVJSON_PROTOCOL_FLOAT_POW5_INV_BITCOUNT plus the number of bits of 5^q minus one
+ */
+static const uint64_t k_devjson_protocol_float_pow5_inv_split[31] = {
+	UINT64_C(576460752303423489), UINT64_C(461168601842738791), UINT64_C(368934881474191033), UINT64_C(295147905179352826),
+	UINT64_C(472236648286964522), UINT64_C(377789318629571618), UINT64_C(302231454903657294), UINT64_C(483570327845851670),
+	UINT64_C(386856262276681336), UINT64_C(309485009821345069), UINT64_C(495176015714152110), UINT64_C(396140812571321688),
+	UINT64_C(316912650057057351), UINT64_C(507060240091291761), UINT64_C(405648192073033409), UINT64_C(324518553658426727),
+	UINT64_C(519229685853482763), UINT64_C(415383748682786211), UINT64_C(332306998946228969), UINT64_C(531691198313966350),
+	UINT64_C(425352958651173080), UINT64_C(340282366920938464), UINT64_C(544451787073501542), UINT64_C(435561429658801234),
+	UINT64_C(348449143727040987), UINT64_C(557518629963265579), UINT64_C(446014903970612463), UINT64_C(356811923176489971),
+	UINT64_C(570899077082383953), UINT64_C(456719261665907162), UINT64_C(365375409332725730)};
+
+/**
+ * @brief 5^i scaled to K_DEVJSON_PROTOCOL_FLOAT_POW5_BITCOUNT bits
+ */
+static const uint64_t k_devjson_protocol_float_pow5_split[47] = {
+	UINT64_C(1152921504606846976), UINT64_C(1441151880758558720), UINT64_C(1801439850948198400), UINT64_C(2251799813685248000),
+	UINT64_C(1407374883553280000), UINT64_C(1759218604441600000), UINT64_C(2199023255552000000), UINT64_C(1374389534720000000),
+	UINT64_C(1717986918400000000), UINT64_C(2147483648000000000), UINT64_C(1342177280000000000), UINT64_C(1677721600000000000),
+	UINT64_C(2097152000000000000), UINT64_C(1310720000000000000), UINT64_C(1638400000000000000), UINT64_C(2048000000000000000),
+	UINT64_C(1280000000000000000), UINT64_C(1600000000000000000), UINT64_C(2000000000000000000), UINT64_C(1250000000000000000),
+	UINT64_C(1562500000000000000), UINT64_C(1953125000000000000), UINT64_C(1220703125000000000), UINT64_C(1525878906250000000),
+	UINT64_C(1907348632812500000), UINT64_C(1192092895507812500), UINT64_C(1490116119384765625), UINT64_C(1862645149230957031),
+	UINT64_C(1164153218269348144), UINT64_C(1455191522836685180), UINT64_C(1818989403545856475), UINT64_C(2273736754432320594),
+	UINT64_C(1421085471520200371), UINT64_C(1776356839400250464), UINT64_C(2220446049250313080), UINT64_C(1387778780781445675),
+	UINT64_C(1734723475976807094), UINT64_C(2168404344971008868), UINT64_C(1355252715606880542), UINT64_C(1694065894508600678),
+	UINT64_C(2117582368135750847), UINT64_C(1323488980084844279), UINT64_C(1654361225106055349), UINT64_C(2067951531382569187),
+	UINT64_C(1292469707114105741), UINT64_C(1615587133892632177), UINT64_C(2019483917365790221)};
+
+/**
+ * @brief Powers of ten scaling a value to its fixed decimals, exact in a double
+ */
+static const double k_devjson_protocol_float_pow10[K_DEVJSON_PROTOCOL_FLOAT_DECIMALS_MAX + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+size_t k_devjson_protocol_float_format(const float value, char *buffer)
+{
+	size_t	 length = 0;
+	uint32_t bits	= 0;
+	memcpy(&bits, &value, sizeof(bits));
+	const uint32_t ieee_mantissa = bits & ((1u << K_DEVJSON_PROTOCOL_FLOAT_MANTISSA_BITS) - 1);
+	const uint32_t ieee_exponent = (bits >> K_DEVJSON_PROTOCOL_FLOAT_MANTISSA_BITS) & 0xff;
+	if (0xff == ieee_exponent)
+	{
+		memcpy(buffer, "null", 4);	//!< No JSON literal for NaN and infinities, same as cJSON
+		length = 4;
+	}
+	else if ((0 == ieee_exponent) && (0 == ieee_mantissa))
+	{
+		buffer[0] = '0';  //!< Negative zero too, same as cJSON
+		length	  = 1;
+	}
+	else
+	{
+		const k_devjson_protocol_decimal_t decimal = k_devjson_protocol_float_decimal(ieee_mantissa, ieee_exponent);
+		char							   digits[10];
+		const size_t					   count   = k_devjson_protocol_float_digits(decimal.mantissa, digits);
+		const int32_t					   point   = (int32_t)count + decimal.exponent;	 //!< Digits before the decimal point
+		if (bits >> 31)
+		{
+			buffer[length++] = '-';
+		}
+		/* Same notation as JavaScript: plain up to 21 integer digits or 6 leading zeros, exponent otherwise */
+		if (((int32_t)count <= point) && (point <= 21))
+		{
+			memcpy(buffer + length, digits, count);
+			memset(buffer + length + count, '0', (size_t)point - count);
+			length += (size_t)point;
+		}
+		else if ((0 < point) && (point <= 21))
+		{
+			memcpy(buffer + length, digits, (size_t)point);
+			buffer[length + (size_t)point] = '.';
+			memcpy(buffer + length + (size_t)point + 1, digits + point, count - (size_t)point);
+			length += count + 1;
+		}
+		else if ((-6 < point) && (point <= 0))
+		{
+			buffer[length]	   = '0';
+			buffer[length + 1] = '.';
+			memset(buffer + length + 2, '0', (size_t)-point);
+			memcpy(buffer + length + 2 + (size_t)-point, digits, count);
+			length += 2 + (size_t)-point + count;
+		}
+		else
+		{
+			const int32_t exponent = point - 1;
+			buffer[length++]	   = digits[0];
+			if (1 < count)
+			{
+				buffer[length++] = '.';
+				memcpy(buffer + length, digits + 1, count - 1);
+				length += count - 1;
+			}
+			buffer[length++] = 'e';
+			buffer[length++] = exponent < 0 ? '-' : '+';
+			length += k_devjson_protocol_float_digits((uint64_t)(exponent < 0 ? -exponent : exponent), buffer + length);
+		}
+	}
+	buffer[length] = '\0';
+	return length;
+}
+
+size_t k_devjson_protocol_float_fixed(const float value, unsigned int decimals, char *buffer)
+{
+	size_t length = 0;
+	decimals	  = decimals < K_DEVJSON_PROTOCOL_FLOAT_DECIMALS_MAX ? decimals : K_DEVJSON_PROTOCOL_FLOAT_DECIMALS_MAX;
+	/* Exact: 24 significant bits times at most 21 bits of 5^9 fit in a double */
+	const double product = (double)value * k_devjson_protocol_float_pow10[decimals];
+	const double scaled	 = product < 0 ? -product : product;
+	if (!(scaled < K_DEVJSON_PROTOCOL_FLOAT_FIXED_LIMIT))
+	{
+		length = k_devjson_protocol_float_format(value, buffer);  //!< Too large, NaN or infinite: shortest form
+	}
+	else
+	{
+		const uint64_t units = (uint64_t)(scaled + 0.5);  //!< Halves rounded away from zero: the sum of 45 bits and a half is exact too
+		char		   digits[20];
+		size_t		   count = units ? k_devjson_protocol_float_digits(units, digits) : 0;
+		if ((value < 0) && units)
+		{
+			buffer[length++] = '-';
+		}
+		if (count <= decimals)
+		{
+			/* Leading zeros, up to the one before the decimal point */
+			memmove(digits + decimals + 1 - count, digits, count);
+			memset(digits, '0', decimals + 1 - count);
+			count = decimals + 1;
+		}
+		memcpy(buffer + length, digits, count - decimals);
+		length += count - decimals;
+		if (decimals)
+		{
+			buffer[length++] = '.';
+			memcpy(buffer + length, digits + count - decimals, decimals);
+			length += decimals;
+		}
+		buffer[length] = '\0';
+	}
+	return length;
+}
+
+static k_devjson_protocol_decimal_t k_devjson_protocol_float_decimal(const uint32_t ieee_mantissa, const uint32_t ieee_exponent)
+{
+	/* Value as m2 * 2^e2, two more bits so the halfway points to the neighbours are integers */
+	const int32_t  e2 = (ieee_exponent ? (int32_t)ieee_exponent : 1) - K_DEVJSON_PROTOCOL_FLOAT_BIAS - K_DEVJSON_PROTOCOL_FLOAT_MANTISSA_BITS - 2;
+	const uint32_t m2 = ieee_exponent ? (1u << K_DEVJSON_PROTOCOL_FLOAT_MANTISSA_BITS) | ieee_mantissa : ieee_mantissa;
+	/* Decimals of the value and of the halfway points, computed with the same power of ten */
+	const int	   accept_bounds	  = 0 == (m2 & 1);								   //!< Round to even: the halfway points read back as this float
+	const uint32_t mv				  = 4 * m2;
+	const uint32_t mp				  = 4 * m2 + 2;
+	const uint32_t mm_shift			  = (0 != ieee_mantissa) || (ieee_exponent <= 1);  //!< Closer lower neighbour at a power of two
+	const uint32_t mm				  = 4 * m2 - 1 - mm_shift;
+	uint32_t	   vr				  = 0;
+	uint32_t	   vp				  = 0;
+	uint32_t	   vm				  = 0;
+	int32_t		   e10				  = 0;
+	int			   vm_trailing_zeros  = 0;
+	int			   vr_trailing_zeros  = 0;
+	uint32_t	   last_removed_digit = 0;
+	uint32_t	   output			  = 0;
+	int32_t		   removed			  = 0;
+	if (e2 >= 0)
+	{
+		const uint32_t q = k_devjson_protocol_float_log10_pow2(e2);
+		const int32_t  k = K_DEVJSON_PROTOCOL_FLOAT_POW5_INV_BITCOUNT + k_devjson_protocol_float_pow5_bits((int32_t)q) - 1;
+		const int32_t  i = -e2 + (int32_t)q + k;
+		e10				 = (int32_t)q;
+		vr				 = k_devjson_protocol_float_mul_shift(mv, k_devjson_protocol_float_pow5_inv_split[q], i);
+		vp				 = k_devjson_protocol_float_mul_shift(mp, k_devjson_protocol_float_pow5_inv_split[q], i);
+		vm				 = k_devjson_protocol_float_mul_shift(mm, k_devjson_protocol_float_pow5_inv_split[q], i);
+		if ((0 != q) && ((vp - 1) / 10 <= vm / 10))
+		{
+			/* The loop below removes no digit: compute the one dropped by the division */
+			const int32_t l = K_DEVJSON_PROTOCOL_FLOAT_POW5_INV_BITCOUNT + k_devjson_protocol_float_pow5_bits((int32_t)(q - 1)) - 1;
+			last_removed_digit = k_devjson_protocol_float_mul_shift(mv, k_devjson_protocol_float_pow5_inv_split[q - 1], -e2 + (int32_t)q - 1 + l) % 10;
+		}
+		if (q <= 9)
+		{
+			/* Only one of mp, mv and mm can be a multiple of 5 */
+			if (0 == mv % 5)
+			{
+				vr_trailing_zeros = (int)k_devjson_protocol_float_multiple_of_pow5(mv, q);
+			}
+			else if (accept_bounds)
+			{
+				vm_trailing_zeros = (int)k_devjson_protocol_float_multiple_of_pow5(mm, q);
+			}
+			else
+			{
+				vp -= k_devjson_protocol_float_multiple_of_pow5(mp, q);
+			}
+		}
+	}
+	else
+	{
+		const uint32_t q = k_devjson_protocol_float_log10_pow5(-e2);
+		const int32_t  i = -e2 - (int32_t)q;
+		const int32_t  k = k_devjson_protocol_float_pow5_bits(i) - K_DEVJSON_PROTOCOL_FLOAT_POW5_BITCOUNT;
+		const int32_t  j = (int32_t)q - k;
+		e10				 = (int32_t)q + e2;
+		vr				 = k_devjson_protocol_float_mul_shift(mv, k_devjson_protocol_float_pow5_split[i], j);
+		vp				 = k_devjson_protocol_float_mul_shift(mp, k_devjson_protocol_float_pow5_split[i], j);
+		vm				 = k_devjson_protocol_float_mul_shift(mm, k_devjson_protocol_float_pow5_split[i], j);
+		if ((0 != q) && ((vp - 1) / 10 <= vm / 10))
+		{
+			const int32_t l = (int32_t)q - 1 - (k_devjson_protocol_float_pow5_bits(i + 1) - K_DEVJSON_PROTOCOL_FLOAT_POW5_BITCOUNT);
+			last_removed_digit = k_devjson_protocol_float_mul_shift(mv, k_devjson_protocol_float_pow5_split[i + 1], l) % 10;
+		}
+		if (q <= 1)
+		{
+			/* mv = 4 * m2 has at least two trailing zero bits, mm one if mm_shift is set, mp one */
+			vr_trailing_zeros = 1;
+			if (accept_bounds)
+			{
+				vm_trailing_zeros = 1 == mm_shift;
+			}
+			else
+			{
+				vp--;
+			}
+		}
+		else if (q < 31)
+		{
+			vr_trailing_zeros = 0 == (mv & ((1u << (q - 1)) - 1));
+		}
+	}
+	if (vm_trailing_zeros || vr_trailing_zeros)
+	{
+		/* Rare: the exact value or the lower bound end with zeros */
+		while (vp / 10 > vm / 10)
+		{
+			vm_trailing_zeros &= 0 == vm % 10;
+			vr_trailing_zeros &= 0 == last_removed_digit;
+			last_removed_digit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		if (vm_trailing_zeros)
+		{
+			while (0 == vm % 10)
+			{
+				vr_trailing_zeros &= 0 == last_removed_digit;
+				last_removed_digit = vr % 10;
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+		if (vr_trailing_zeros && (5 == last_removed_digit) && (0 == vr % 2))
+		{
+			last_removed_digit = 4;	 //!< Exactly halfway: round to even
+		}
+		output = vr + (((vr == vm) && (!accept_bounds || !vm_trailing_zeros)) || (last_removed_digit >= 5));
+	}
+	else
+	{
+		while (vp / 10 > vm / 10)
+		{
+			last_removed_digit = vr % 10;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+		output = vr + ((vr == vm) || (last_removed_digit >= 5));
+	}
+	return (k_devjson_protocol_decimal_t){.mantissa = output, .exponent = e10 + removed};
+}
+
+static int32_t k_devjson_protocol_float_pow5_bits(const int32_t e)
+{
+	return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+static uint32_t k_devjson_protocol_float_log10_pow2(const int32_t e)
+{
+	return ((uint32_t)e * 78913) >> 18;
+}
+
+static uint32_t k_devjson_protocol_float_log10_pow5(const int32_t e)
+{
+	return ((uint32_t)e * 732923) >> 20;
+}
+
+static uint32_t k_devjson_protocol_float_multiple_of_pow5(uint32_t value, const uint32_t p)
+{
+	uint32_t count = 0;
+	while ((count < p) && (0 == value % 5))
+	{
+		value /= 5;
+		count++;
+	}
+	return count >= p;
+}
+
+static uint32_t k_devjson_protocol_float_mul_shift(const uint32_t m, const uint64_t factor, const int32_t shift)
+{
+	const uint64_t low	= (uint64_t)m * (uint32_t)factor;
+	const uint64_t high = (uint64_t)m * (uint32_t)(factor >> 32);
+	return (uint32_t)(((low >> 32) + high) >> (shift - 32));
+}
+
+static size_t k_devjson_protocol_float_digits(uint64_t value, char *digits)
+{
+	size_t count = 0;
+	for (uint64_t rest = value; rest; rest /= 10)
+	{
+		count++;
+	}
+	for (size_t i = count; i; i--)
+	{
+		digits[i - 1] = (char)('0' + value % 10);
+		value /= 10;
+	}
+	return count;
+}
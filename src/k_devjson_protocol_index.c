@@ -0,0 +1,132 @@
+/**
+ * @file k_devjson_protocol_index.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_INDEX_EVEN_BITS UINT64_C(0x5555555555555555)	//!< Bits at even positions
+
+/* Typedef -------------------------------------------------------------------*/
+/**
+ * @brief State carried from a block to the next one
+ */
+typedef struct
+{
+	uint64_t escaped;	 //!< 1 if the first byte of the next block is escaped
+	uint64_t in_string;	 //!< All ones if the next block starts inside a string
+} k_devjson_protocol_index_carry_t;
+
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Find the braces and brackets of a block that are outside strings
+ * @param block Start of the block, K_DEVJSON_PROTOCOL_SCAN_BLOCK bytes
+ * @param carry State carried from the previous block, updated for the next one
+ * @param open Set to the opening braces and brackets
+ * @return Closing braces and brackets
+ */
+static uint64_t k_devjson_protocol_index_block(const char *block, k_devjson_protocol_index_carry_t *carry, uint64_t *open);
+
+/**
+ * @brief Find the bytes escaped by a backslash
+ * @param backslash Backslashes of the block
+ * @param carry State carried from the previous block, its escape is updated for the next one
+ * @return Escaped bytes of the block
+ */
+static uint64_t k_devjson_protocol_index_escaped(uint64_t backslash, k_devjson_protocol_index_carry_t *carry);
+
+/**
+ * @brief Compute the prefix XOR of a mask: bit i is the parity of the bits 0 to i
+ * @param mask Mask
+ * @return Prefix XOR
+ */
+static uint64_t k_devjson_protocol_index_prefix_xor(uint64_t mask);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+const char *k_devjson_protocol_index_skip(const char *cursor, const char *end)
+{
+	const char						*container_end = NULL;
+	size_t							 depth		   = 0;
+	k_devjson_protocol_index_carry_t carry		   = {0, 0};
+	while ((cursor < end) && !container_end)
+	{
+		uint64_t open  = 0;
+		uint64_t close = 0;
+		if (end - cursor >= K_DEVJSON_PROTOCOL_SCAN_BLOCK)
+		{
+			close = k_devjson_protocol_index_block(cursor, &carry, &open);
+		}
+		else
+		{
+			/* Last block: the bytes past the end are spaces, which hold no token */
+			char padded[K_DEVJSON_PROTOCOL_SCAN_BLOCK];
+			memset(padded, ' ', sizeof(padded));
+			memcpy(padded, cursor, (size_t)(end - cursor));
+			close = k_devjson_protocol_index_block(padded, &carry, &open);
+		}
+		if (depth > k_devjson_protocol_popcount64(close))
+		{
+			depth += (size_t)k_devjson_protocol_popcount64(open) - (size_t)k_devjson_protocol_popcount64(close);	//!< The container does not end in this block
+		}
+		else
+		{
+			/* Walk the brackets in order until the depth drops to zero */
+			uint64_t brackets = open | close;
+			while (brackets && !container_end)
+			{
+				const uint64_t bit = brackets & (~brackets + 1);
+				depth			   = (open & bit) ? depth + 1 : depth - 1;
+				container_end	   = 0 == depth ? cursor + k_devjson_protocol_ctz64(bit) + 1 : NULL;
+				brackets ^= bit;
+			}
+		}
+		cursor = end - cursor > K_DEVJSON_PROTOCOL_SCAN_BLOCK ? cursor + K_DEVJSON_PROTOCOL_SCAN_BLOCK : end;
+	}
+	return container_end;
+}
+
+static uint64_t k_devjson_protocol_index_block(const char *block, k_devjson_protocol_index_carry_t *carry, uint64_t *open)
+{
+	k_devjson_protocol_scan_classes_t classes;
+	uint64_t						  in_string;
+	k_devjson_protocol_scan_classify(block, &classes);
+	/* A string runs from a quote that is not escaped to the byte before the next one */
+	in_string		 = k_devjson_protocol_index_prefix_xor(classes.quote & ~k_devjson_protocol_index_escaped(classes.backslash, carry)) ^ carry->in_string;
+	carry->in_string = (uint64_t)((int64_t)in_string >> 63);
+	*open			 = classes.open & ~in_string;
+	return classes.close & ~in_string;
+}
+
+static uint64_t k_devjson_protocol_index_escaped(uint64_t backslash, k_devjson_protocol_index_carry_t *carry)
+{
+	/* Every other byte from the start of a run of backslashes is escaped: the odd bits after a run starting on an even bit,
+	 * the even bits otherwise. Adding the starts on odd bits to the backslashes clears those runs and leaves the others */
+	const uint64_t escape_first = carry->escaped;
+	uint64_t	   follows;
+	uint64_t	   odd_starts;
+	uint64_t	   even_starts;
+	backslash &= ~escape_first;	 //!< A backslash escaped by the previous block starts no escape
+	follows		   = (backslash << 1) | escape_first;
+	odd_starts	   = backslash & ~K_DEVJSON_PROTOCOL_INDEX_EVEN_BITS & ~follows;
+	carry->escaped = (uint64_t)k_devjson_protocol_add_overflow64(odd_starts, backslash, &even_starts);
+	return (K_DEVJSON_PROTOCOL_INDEX_EVEN_BITS ^ (even_starts << 1)) & follows;
+}
+
+static uint64_t k_devjson_protocol_index_prefix_xor(uint64_t mask)
+{
+	mask ^= mask << 1;
+	mask ^= mask << 2;
+	mask ^= mask << 4;
+	mask ^= mask << 8;
+	mask ^= mask << 16;
+	mask ^= mask << 32;
+	return mask;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file k_devjson_protocol_lazy.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+int k_devjson_protocol_lazy_member(const k_devjson_protocol_lazy_t *lazy, const char *key, k_devjson_protocol_lazy_t *member)
+{
+	int found = 0;
+	if (lazy && key && member)
+	{
+		memset(member, 0, sizeof(*member));
+		if (lazy->json)
+		{
+			const size_t key_length = strlen(key);
+			const char	*end		= lazy->json + lazy->length;
+			const char	*cursor		= k_devjson_protocol_peek_space(lazy->json, end);
+			if ((cursor < end) && ('{' == *cursor))
+			{
+				cursor = k_devjson_protocol_peek_space(cursor + 1, end);
+				while (cursor && (cursor < end) && ('"' == *cursor) && !found)
+				{
+					const char *member_key = cursor + 1;
+					const char *key_end	   = k_devjson_protocol_peek_string(cursor, end);
+					const char *value	   = key_end ? k_devjson_protocol_peek_space(key_end, end) : NULL;
+					value				   = value && (value < end) && (':' == *value) ? k_devjson_protocol_peek_space(value + 1, end) : NULL;
+					cursor				   = value ? k_devjson_protocol_peek_value(value, end) : NULL;
+					if (cursor && ((size_t)(key_end - member_key) == key_length + 1) && (0 == memcmp(member_key, key, key_length)))
+					{
+						member->json   = value;
+						member->length = (size_t)(cursor - value);
+						found		   = 1;
+					}
+					else
+					{
+						cursor = cursor ? k_devjson_protocol_peek_space(cursor, end) : NULL;
+						cursor = cursor && (cursor < end) && (',' == *cursor) ? k_devjson_protocol_peek_space(cursor + 1, end) : NULL;
+					}
+				}
+			}
+		}
+		else if (cJSON_IsObject(lazy->item))
+		{
+			member->item = cJSON_GetObjectItemCaseSensitive(lazy->item, key);	//!< Value parsed with the request by the DOM engine
+			found		 = member->item ? 1 : 0;
+		}
+	}
+	return found;
+}
+
+k_devjson_protocol_value_type_t k_devjson_protocol_lazy_value(k_devjson_protocol_lazy_t *lazy, k_devjson_protocol_value_t *value)
+{
+	k_devjson_protocol_value_type_t value_type = K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN;
+	if (lazy && value)
+	{
+		const char first = lazy->json && lazy->length ? lazy->json[0] : '\0';
+		if (('-' == first) || ((first >= '0') && (first <= '9')))
+		{
+			if (lazy->length < K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE)
+			{
+				value_type = k_devjson_protocol_number_parse(lazy->json, lazy->length, value);
+			}
+		}
+		else if (('t' == first) || ('f' == first))
+		{
+			value->bool_value = 't' == first ? 1 : 0;
+			value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL;
+		}
+		else if ('{' == first)
+		{
+			value->lazy_value = lazy;
+			value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON;
+		}
+		else if (('"' == first) || !lazy->json)
+		{
+			/* Strings are decoded by cJSON; a value parsed with the request is converted as the DOM engine does */
+			const cJSON *item = k_devjson_protocol_lazy_json(lazy);
+			if (cJSON_IsString(item))
+			{
+				value->string_value = item->valuestring;
+				value_type			= K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING;
+			}
+			else if (cJSON_IsNumber(item))
+			{
+				value_type = k_devjson_protocol_number_value(item->valuedouble, value);
+			}
+			else if (cJSON_IsBool(item))
+			{
+				value->bool_value = cJSON_IsTrue(item) ? 1 : 0;
+				value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL;
+			}
+			else if (cJSON_IsObject(item))
+			{
+				value->lazy_value = lazy;
+				value_type		  = K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON;
+			}
+		}
+	}
+	return value_type;
+}
+
+const cJSON *k_devjson_protocol_lazy_json(k_devjson_protocol_lazy_t *lazy)
+{
+	const cJSON *item = NULL;
+	if (lazy)
+	{
+		if (!lazy->item && lazy->json)
+		{
+			lazy->item	= cJSON_ParseWithLength(lazy->json, lazy->length);
+			lazy->owned = lazy->item ? 1 : 0;
+		}
+		item = lazy->item;
+	}
+	return item;
+}
+
+void k_devjson_protocol_lazy_release(k_devjson_protocol_lazy_t *lazy)
+{
+	if (lazy && lazy->owned)
+	{
+		cJSON_Delete(lazy->item);
+		lazy->item	= NULL;
+		lazy->owned = 0;
+	}
+}
@@ -0,0 +1,154 @@
+/**
+ * @file k_devjson_protocol_number.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_NUMBER_DIGITS_MAX   19						 //!< Significant digits accumulated in a uint64_t without overflow
+#define K_DEVJSON_PROTOCOL_NUMBER_EXPONENT_MAX 22						 //!< Largest power of ten exact in a double
+#define K_DEVJSON_PROTOCOL_NUMBER_MANTISSA_MAX (UINT64_C(1) << DBL_MANT_DIG)	 //!< Largest integer below which every integer is exact in a double
+
+#if defined(FLT_EVAL_METHOD) && (0 == FLT_EVAL_METHOD)
+#define K_DEVJSON_PROTOCOL_NUMBER_FAST_PATH 1  //!< Double operations are rounded once, to a double
+#else
+#define K_DEVJSON_PROTOCOL_NUMBER_FAST_PATH 0  //!< Excess precision would round twice: always use strtod
+#endif
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Convert a number literal with strtod, with the decimal point of the current locale, the same way as cJSON
+ * @param number Literal, not NUL-terminated
+ * @param length Length of the literal
+ * @param value Destination of the converted value
+ * @return 1 if the whole literal was converted, 0 if not
+ */
+static int k_devjson_protocol_number_strtod(const char *number, size_t length, double *value);
+
+/* Constant ------------------------------------------------------------------*/
+/**
+ * @brief Powers of ten exact in a double
+ */
+static const double k_devjson_protocol_number_pow10[K_DEVJSON_PROTOCOL_NUMBER_EXPONENT_MAX + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+k_devjson_protocol_value_type_t k_devjson_protocol_number_parse(const char *number, const size_t length, k_devjson_protocol_value_t *value)
+{
+	k_devjson_protocol_value_type_t value_type = K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN;
+	const char					   *end		   = number + length;
+	const char					   *cursor	   = number;
+	const int						negative   = (cursor < end) && ('-' == *cursor);
+	uint64_t						mantissa   = 0;
+	size_t							digits	   = 0;	 //!< Significant digits, leading zeros excluded
+	size_t							integer	   = 0;	 //!< Digits before the decimal point
+	size_t							fraction   = 0;	 //!< Digits after the decimal point
+	int								exponent   = 0;
+	int								integral   = 1;	 //!< No decimal point and no exponent
+	int								plain	   = 1;	 //!< Digits around the decimal point and in the exponent
+	cursor += negative;
+	for (; (cursor < end) && (*cursor >= '0') && (*cursor <= '9'); cursor++, integer++)
+	{
+		digits += (0 != digits) || ('0' != *cursor);
+		mantissa = digits <= K_DEVJSON_PROTOCOL_NUMBER_DIGITS_MAX ? mantissa * 10 + (uint64_t)(*cursor - '0') : mantissa;
+	}
+	if ((cursor < end) && ('.' == *cursor))
+	{
+		for (cursor++; (cursor < end) && (*cursor >= '0') && (*cursor <= '9'); cursor++, fraction++)
+		{
+			digits += (0 != digits) || ('0' != *cursor);
+			mantissa = digits <= K_DEVJSON_PROTOCOL_NUMBER_DIGITS_MAX ? mantissa * 10 + (uint64_t)(*cursor - '0') : mantissa;
+		}
+		integral = 0;
+		plain	 = 0 != fraction;  //!< "1." is left to strtod, as cJSON accepts it
+	}
+	if ((cursor < end) && (('e' == *cursor) || ('E' == *cursor)))
+	{
+		const int sign			  = (cursor + 1 < end) && ('-' == cursor[1]) ? -1 : 1;
+		size_t	  exponent_digits = 0;
+		cursor += 1 + ((cursor + 1 < end) && (('-' == cursor[1]) || ('+' == cursor[1])));
+		for (; (cursor < end) && (*cursor >= '0') && (*cursor <= '9'); cursor++, exponent_digits++)
+		{
+			exponent = exponent < 10000 ? exponent * 10 + (*cursor - '0') : exponent;  //!< Saturated, already far out of range
+		}
+		exponent *= sign;
+		integral = 0;
+		plain &= 0 != exponent_digits;
+	}
+	plain &= (cursor == end) && (0 != integer);
+	if (plain && integral && (digits <= 10) && (mantissa <= (negative ? (uint64_t)INT_MAX + 1 : (uint64_t)INT_MAX)))
+	{
+		/* Integral literal in the range of int: no floating-point round trip */
+		value->int_value = negative ? (int)-(int64_t)mantissa : (int)mantissa;
+		value_type		 = K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER;
+	}
+	else if (K_DEVJSON_PROTOCOL_NUMBER_FAST_PATH && plain && (digits <= K_DEVJSON_PROTOCOL_NUMBER_DIGITS_MAX) &&
+			 (mantissa <= K_DEVJSON_PROTOCOL_NUMBER_MANTISSA_MAX) && (exponent - (int)fraction >= -K_DEVJSON_PROTOCOL_NUMBER_EXPONENT_MAX) &&
+			 (exponent - (int)fraction <= K_DEVJSON_PROTOCOL_NUMBER_EXPONENT_MAX))
+	{
+		/* Both operands exact in a double: a single rounding gives the double strtod returns (Clinger's fast path) */
+		const int scale	  = exponent - (int)fraction;
+		double	  decimal = (double)mantissa;
+		decimal			  = scale < 0 ? decimal / k_devjson_protocol_number_pow10[-scale] : decimal * k_devjson_protocol_number_pow10[scale];
+		value_type		  = k_devjson_protocol_number_value(negative ? -decimal : decimal, value);
+	}
+	else
+	{
+		/* Long mantissas, large exponents and the forms cJSON accepts beyond the JSON grammar */
+		double decimal = 0;
+		if (k_devjson_protocol_number_strtod(number, length, &decimal))
+		{
+			value_type = k_devjson_protocol_number_value(decimal, value);
+		}
+	}
+	return value_type;
+}
+
+k_devjson_protocol_value_type_t k_devjson_protocol_number_value(const double number, k_devjson_protocol_value_t *value)
+{
+	k_devjson_protocol_value_type_t value_type = K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT;
+	if ((number >= (double)INT_MIN) && (number <= (double)INT_MAX) && ((double)(int)number == number))
+	{
+		value->int_value = (int)number;
+		value_type		 = K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER;
+	}
+	else
+	{
+		value->float_value = (float)number;
+	}
+	return value_type;
+}
+
+static int k_devjson_protocol_number_strtod(const char *number, const size_t length, double *value)
+{
+	int		   converted	 = 0;
+	size_t	   i			 = 0;
+	const char decimal_point = *localeconv()->decimal_point;
+	char	   buffer[K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE];
+	/* Same characters as cJSON: strtod alone would also take spaces, "inf", "nan" or hexadecimal */
+	while ((i < length) && (i < sizeof(buffer) - 1) && number[i] && strchr("0123456789+-.eE", number[i]))
+	{
+		buffer[i] = '.' == number[i] ? decimal_point : number[i];
+		i++;
+	}
+	if (length && (i == length) && (('-' == number[0]) || ((number[0] >= '0') && (number[0] <= '9'))))
+	{
+		char *number_end = NULL;
+		buffer[i]		 = '\0';
+		*value			 = strtod(buffer, &number_end);
+		converted		 = number_end == buffer + length;
+	}
+	return converted;
+}
@@ -0,0 +1,1383 @@
+/**
+ * @file k_devjson_protocol_parser.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+static void k_devjson_protocol_parser_on_event(k_devjson_protocol_parser_t *parser, k_devjson_protocol_parser_event_t event, const char *position);
+static void k_devjson_protocol_parser_dispatch(k_devjson_protocol_parser_t *parser, const char *key, k_devjson_protocol_value_t value,
+											   k_devjson_protocol_value_type_t value_type, const char *raw, size_t raw_length);
+static k_devjson_protocol_parse_status_t k_devjson_protocol_parser_complete(k_devjson_protocol_parser_t *parser);
+static void k_devjson_protocol_parser_capture(k_devjson_protocol_parser_t *parser, const char *data, size_t length);
+static void k_devjson_protocol_parser_begin_string(k_devjson_protocol_parser_t *parser, int is_key);
+static void k_devjson_protocol_parser_append(k_devjson_protocol_parser_t *parser, const char *data, size_t length);
+static void k_devjson_protocol_parser_append_code_point(k_devjson_protocol_parser_t *parser, unsigned long code_point);
+static void k_devjson_protocol_parser_end_value(k_devjson_protocol_parser_t *parser);
+static void k_devjson_protocol_parser_end_number(k_devjson_protocol_parser_t *parser, const char *position);
+static void k_devjson_protocol_parser_grow(k_devjson_protocol_parser_t *parser, size_t needed);
+static int k_devjson_protocol_parser_reserve(k_devjson_protocol_parser_t *parser, char **buffer, size_t *size, const char *embedded, size_t used,
+											 size_t needed);
+static void k_devjson_protocol_parser_release(k_devjson_protocol_parser_t *parser);
+static void k_devjson_protocol_parser_push(k_devjson_protocol_parser_t *parser, char container);
+static char k_devjson_protocol_parser_container(const k_devjson_protocol_parser_t *parser, size_t level);
+static void k_devjson_protocol_parser_fail(k_devjson_protocol_parser_t *parser, k_devjson_protocol_parse_status_t status);
+static const char *k_devjson_protocol_parser_group_key(k_devjson_protocol_parser_key_t group);
+static void k_devjson_protocol_parser_close_group(k_devjson_protocol_parser_t *parser);
+
+/**
+ * @brief Tell whether a group that comes before a set or cmd group may follow it
+ *
+ * Only the quoted names are searched, so the members are walked only when such a key can be there.
+ * @param cursor Byte after the key of the set or cmd group
+ * @param end End of the request buffer
+ * @param group K_DEVJSON_PROTOCOL_PARSER_KEY_SET or K_DEVJSON_PROTOCOL_PARSER_KEY_CMD
+ * @return 1 if "get" (or "set" after a cmd group) appears after the cursor, 0 otherwise
+ */
+static int k_devjson_protocol_parser_find_group(const char *cursor, const char *end, k_devjson_protocol_parser_key_t group);
+
+/**
+ * @brief Walk the members of a whole request after its first set or cmd group to find the groups that must wait
+ *
+ * A set or cmd group followed by a group that comes first in the get, set, cmd order is held and replayed
+ * when the request ends. Members are skipped by matching quotes and brackets only, like \ref k_devjson_protocol_peek_id.
+ * @param parser Pointer to the parser, its group being the first set or cmd group of the request
+ * @param cursor Byte after the key of that group
+ */
+static void k_devjson_protocol_parser_walk_groups(k_devjson_protocol_parser_t *parser, const char *cursor);
+
+/**
+ * @brief Dispatch a held group before the response of the request is closed
+ * @param parser Pointer to the parser
+ * @param group K_DEVJSON_PROTOCOL_PARSER_KEY_SET or K_DEVJSON_PROTOCOL_PARSER_KEY_CMD
+ */
+static void k_devjson_protocol_parser_replay_group(k_devjson_protocol_parser_t *parser, k_devjson_protocol_parser_key_t group);
+
+/**
+ * @brief Keep only the first member of each protocol key, as the DOM engine does with cJSON_GetObjectItem
+ * @param parser Pointer to the parser
+ * @param key Key just read
+ * @return The key, or K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER if it was already read: its value is scanned without events
+ */
+static k_devjson_protocol_parser_key_t k_devjson_protocol_parser_skip_repeat(k_devjson_protocol_parser_t *parser, k_devjson_protocol_parser_key_t key);
+static void k_devjson_protocol_parser_resolve_id(k_devjson_protocol_parser_t *parser);
+
+/**
+ * @brief Skip whitespace between tokens
+ * @param cursor Whitespace byte
+ * @param end End of the bytes available
+ * @return Pointer to the byte after the whitespace, end if none
+ */
+static const char *k_devjson_protocol_parser_skip_space(const char *cursor, const char *end);
+
+/* Constant ------------------------------------------------------------------*/
+static const char k_devjson_protocol_parser_empty_response[] = "{}";	//!< Response written when the request fails
+
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_sax(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, const size_t json_length,
+															   k_devjson_protocol_output_t *output)
+{
+	k_devjson_protocol_parse_status_t parse_status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+	if (ctx->callback)
+	{
+		parse_status = K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON;
+		if (json_buffer)
+		{
+			k_devjson_protocol_parser_t parser;
+			k_devjson_protocol_parser_setup(&parser, ctx, output);
+			k_devjson_protocol_parser_contiguous(&parser, json_buffer, json_length);
+			k_devjson_protocol_parser_scan(&parser, json_buffer, json_length);
+			k_devjson_protocol_parser_end(&parser);
+			parse_status = k_devjson_protocol_parser_complete(&parser);
+		}
+	}
+	return parse_status;
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_parser_feed(k_devjson_protocol_parser_t *parser, const char *chunk, size_t chunk_length, size_t *consumed)
+{
+	k_devjson_protocol_parse_status_t parse_status = K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE;
+	size_t							  scanned	   = 0;
+	if (parser->active)
+	{
+		scanned = k_devjson_protocol_parser_scan(parser, chunk, chunk_length);
+		if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE == parser->state)
+		{
+			k_devjson_protocol_parser_end(parser);	//!< Replays a request read before its ID
+			parse_status = k_devjson_protocol_parser_complete(parser);
+		}
+	}
+	else
+	{
+		parse_status = parser->status;	//!< Request already completed
+	}
+	if (consumed)
+	{
+		*consumed = scanned;
+	}
+	return parse_status;
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_parser_finish(k_devjson_protocol_parser_t *parser)
+{
+	if (parser->active)
+	{
+		k_devjson_protocol_parser_end(parser);
+		k_devjson_protocol_parser_complete(parser);
+	}
+	return parser->status;
+}
+
+void k_devjson_protocol_parser_setup(k_devjson_protocol_parser_t *parser, const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_output_t *output)
+{
+	memset(parser, 0, offsetof(k_devjson_protocol_parser_t, nesting));
+	k_devjson_protocol_writer_init(&parser->writer, output->buffer, output->size);
+	k_devjson_protocol_writer_set_sink(&parser->writer, output->sink, output->sink_arg);
+	k_devjson_protocol_writer_begin_object(&parser->writer, NULL);	//!< Root of the response
+	parser->callback	   = ctx->callback;
+	parser->user_data	   = ctx->user_data;
+	parser->registry	   = ctx->registry;
+	parser->store		   = ctx->store;
+	parser->store_cache	   = ctx->store_cache;
+	parser->lazy_json	   = ctx->config.lazy_json;
+	parser->output		   = output;
+	parser->active		   = 1;
+	parser->status		   = K_DEVJSON_PROTOCOL_PARSE_SUCCESS;
+	parser->state		   = K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE;
+	parser->member		   = K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER;
+	parser->group		   = K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER;
+	parser->id			   = -1;
+	parser->alloc_failures = k_devjson_protocol_alloc_failures();
+	parser->deferred	   = output->sink ? NULL : output->deferred;  //!< A response flushed to a sink cannot be completed later
+	output->length		   = 0;
+	k_devjson_protocol_parser_release(parser);	//!< Strings are decoded in the parser until they outgrow it
+	if (parser->deferred)
+	{
+		k_devjson_protocol_deferred_begin(parser->deferred, output);
+	}
+}
+
+void k_devjson_protocol_parser_contiguous(k_devjson_protocol_parser_t *parser, const char *json_buffer, const size_t json_length)
+{
+	parser->contiguous = 1;
+	parser->input_end  = json_buffer + json_length;
+	if (K_DEVJSON_PROTOCOL_PEEK_UNKNOWN != k_devjson_protocol_peek_id(json_buffer, json_length, &parser->id))
+	{
+		/* A request for another device is rejected before its body is read, a request without ID is dispatched as it is read */
+		k_devjson_protocol_parser_resolve_id(parser);
+	}
+}
+
+size_t k_devjson_protocol_parser_scan(k_devjson_protocol_parser_t *parser, const char *data, size_t length)
+{
+	const char *cursor = data;
+	const char *end	   = data + length;
+	parser->value_start = NULL;	 //!< A value that started in the previous chunk has no span
+	if (parser->raw_pending)
+	{
+		parser->raw_start	= data;	 //!< The cmd JSON value continues at the start of this chunk
+		parser->raw_pending = 0;
+	}
+	while ((cursor < end) && (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state))
+	{
+		const char character = *cursor;
+		switch (parser->state)
+		{
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE:
+				if ((unsigned char)character <= ' ')
+				{
+					cursor = k_devjson_protocol_parser_skip_space(cursor, end);
+				}
+				else if ('{' == character)
+				{
+					k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_BEGIN, cursor);
+					k_devjson_protocol_parser_push(parser, '{');
+					if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state)
+					{
+						parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY_OR_END;
+					}
+					cursor++;
+				}
+				else if ('[' == character)
+				{
+					k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_BEGIN, cursor);
+					k_devjson_protocol_parser_push(parser, '[');
+					if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state)
+					{
+						parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_ARRAY_VALUE_OR_END;
+					}
+					cursor++;
+				}
+				else if ('"' == character)
+				{
+					k_devjson_protocol_parser_begin_string(parser, 0);
+					parser->value_start = cursor;
+					cursor++;
+				}
+				else if (('-' == character) || ((character >= '0') && (character <= '9')))
+				{
+					parser->number_length = 0;
+					parser->value_start	  = cursor;
+					parser->state		  = K_DEVJSON_PROTOCOL_PARSER_STATE_NUMBER;
+				}
+				else if (('t' == character) || ('f' == character) || ('n' == character))
+				{
+					parser->literal		   = 't' == character ? "true" : 'f' == character ? "false" : "null";
+					parser->literal_length = 0;
+					parser->value_start	   = cursor;
+					parser->state		   = K_DEVJSON_PROTOCOL_PARSER_STATE_LITERAL;
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY_OR_END:
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY:
+				if ((unsigned char)character <= ' ')
+				{
+					cursor = k_devjson_protocol_parser_skip_space(cursor, end);
+				}
+				else if ('"' == character)
+				{
+					k_devjson_protocol_parser_begin_string(parser, 1);
+					cursor++;
+				}
+				else if (('}' == character) && (K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY_OR_END == parser->state))
+				{
+					parser->depth--;
+					cursor++;
+					k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END, cursor);
+					k_devjson_protocol_parser_end_value(parser);
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_COLON:
+				if ((unsigned char)character <= ' ')
+				{
+					cursor = k_devjson_protocol_parser_skip_space(cursor, end);
+				}
+				else if (':' == character)
+				{
+					parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE;
+					cursor++;
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_ARRAY_VALUE_OR_END:
+				if ((unsigned char)character <= ' ')
+				{
+					cursor = k_devjson_protocol_parser_skip_space(cursor, end);
+				}
+				else if (']' == character)
+				{
+					parser->depth--;
+					cursor++;
+					k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_END, cursor);
+					k_devjson_protocol_parser_end_value(parser);
+				}
+				else
+				{
+					parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE;	//!< Reprocess the character as a value
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_AFTER_VALUE:
+			{
+				const char container = k_devjson_protocol_parser_container(parser, parser->depth - 1);
+				if ((unsigned char)character <= ' ')
+				{
+					cursor = k_devjson_protocol_parser_skip_space(cursor, end);
+				}
+				else if (',' == character)
+				{
+					parser->state = '{' == container ? K_DEVJSON_PROTOCOL_PARSER_STATE_OBJECT_KEY : K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE;
+					cursor++;
+				}
+				else if ((('}' == character) && ('{' == container)) || ((']' == character) && ('[' == container)))
+				{
+					parser->depth--;
+					cursor++;
+					k_devjson_protocol_parser_on_event(
+						parser, '}' == character ? K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END : K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_END, cursor);
+					k_devjson_protocol_parser_end_value(parser);
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			}
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_STRING:
+			{
+				const char *run = cursor;
+				cursor			= k_devjson_protocol_scan_string(cursor, end);
+				k_devjson_protocol_parser_append(parser, run, (size_t)(cursor - run));
+				if ((cursor < end) && (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state))
+				{
+					if ('"' == *cursor)
+					{
+						cursor++;
+						if (parser->string)
+						{
+							parser->string[parser->string_length] = '\0';
+						}
+						if (parser->is_key)
+						{
+							k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_KEY, cursor);
+							if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state)
+							{
+								parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_COLON;
+							}
+						}
+						else
+						{
+							k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_STRING, cursor);
+							k_devjson_protocol_parser_end_value(parser);
+						}
+					}
+					else
+					{
+						parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_ESCAPE;
+						cursor++;
+					}
+				}
+				break;
+			}
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_ESCAPE:
+			{
+				char decoded = '\0';
+				switch (character)
+				{
+					case 'b':
+						decoded = '\b';
+						break;
+					case 'f':
+						decoded = '\f';
+						break;
+					case 'n':
+						decoded = '\n';
+						break;
+					case 'r':
+						decoded = '\r';
+						break;
+					case 't':
+						decoded = '\t';
+						break;
+					case '"':
+					case '\\':
+					case '/':
+						decoded = character;
+						break;
+					case 'u':
+						parser->unicode		   = 0;
+						parser->unicode_digits = 0;
+						parser->state		   = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_UNICODE;
+						break;
+					default:
+						k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+						break;
+				}
+				if ('\0' != decoded)
+				{
+					parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING;
+					k_devjson_protocol_parser_append(parser, &decoded, 1);
+				}
+				cursor++;
+				break;
+			}
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_UNICODE:
+			{
+				unsigned long digit = 16;
+				if ((character >= '0') && (character <= '9'))
+				{
+					digit = (unsigned long)(character - '0');
+				}
+				else if ((character >= 'a') && (character <= 'f'))
+				{
+					digit = (unsigned long)(character - 'a' + 10);
+				}
+				else if ((character >= 'A') && (character <= 'F'))
+				{
+					digit = (unsigned long)(character - 'A' + 10);
+				}
+				if (digit < 16)
+				{
+					parser->unicode = (parser->unicode << 4) | digit;
+					if (4 == ++parser->unicode_digits)
+					{
+						const unsigned long code_point = parser->unicode;
+						if (parser->surrogate)
+						{
+							if ((code_point >= 0xDC00) && (code_point <= 0xDFFF))
+							{
+								parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING;
+								k_devjson_protocol_parser_append_code_point(parser, 0x10000 + (((parser->surrogate & 0x3FF) << 10) | (code_point & 0x3FF)));
+								parser->surrogate = 0;
+							}
+							else
+							{
+								k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+							}
+						}
+						else if ((code_point >= 0xD800) && (code_point <= 0xDBFF))
+						{
+							parser->surrogate = code_point;
+							parser->state	  = K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_BACKSLASH;
+						}
+						else if ((code_point >= 0xDC00) && (code_point <= 0xDFFF))
+						{
+							k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);	//!< Low surrogate without a high one
+						}
+						else
+						{
+							parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING;
+							k_devjson_protocol_parser_append_code_point(parser, code_point);
+						}
+					}
+					cursor++;
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			}
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_BACKSLASH:
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_U:
+				if (('\\' == character) && (K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_BACKSLASH == parser->state))
+				{
+					parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_U;
+					cursor++;
+				}
+				else if (('u' == character) && (K_DEVJSON_PROTOCOL_PARSER_STATE_SURROGATE_U == parser->state))
+				{
+					parser->unicode		   = 0;
+					parser->unicode_digits = 0;
+					parser->state		   = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING_UNICODE;
+					cursor++;
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_NUMBER:
+				if (((character >= '0') && (character <= '9')) || ('-' == character) || ('+' == character) || ('.' == character) || ('e' == character) ||
+					('E' == character))
+				{
+					if (parser->number_length < (K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE - 1))
+					{
+						parser->number[parser->number_length++] = character;
+						cursor++;
+					}
+					else
+					{
+						k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+					}
+				}
+				else
+				{
+					k_devjson_protocol_parser_end_number(parser, cursor);  //!< The character is reprocessed after the number
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_STATE_LITERAL:
+				if (character == parser->literal[parser->literal_length])
+				{
+					cursor++;
+					if ('\0' == parser->literal[++parser->literal_length])
+					{
+						k_devjson_protocol_parser_on_event(parser,
+														   't' == parser->literal[0]   ? K_DEVJSON_PROTOCOL_PARSER_EVENT_TRUE :
+														   'f' == parser->literal[0] ? K_DEVJSON_PROTOCOL_PARSER_EVENT_FALSE :
+																					   K_DEVJSON_PROTOCOL_PARSER_EVENT_NULL,
+														   cursor);
+						k_devjson_protocol_parser_end_value(parser);
+					}
+				}
+				else
+				{
+					k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	if (parser->raw_start && !parser->contiguous && (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state))
+	{
+		if (parser->req_held || ((K_DEVJSON_PROTOCOL_PARSER_KEY_CMD == parser->group) && ('{' == k_devjson_protocol_parser_container(parser, 2))))
+		{
+			/* The chunk ends inside a request held until its ID or inside a cmd JSON value: keep what was read so far */
+			k_devjson_protocol_parser_capture(parser, parser->raw_start, (size_t)(end - parser->raw_start));
+			parser->raw_pending = 1;
+		}
+		parser->raw_start = NULL;  //!< Any other container is dispatched without its bytes
+	}
+	return (size_t)(cursor - data);
+}
+
+k_devjson_protocol_parse_status_t k_devjson_protocol_parser_end(k_devjson_protocol_parser_t *parser)
+{
+	if ((K_DEVJSON_PROTOCOL_PARSER_STATE_NUMBER == parser->state) && (0 == parser->depth))
+	{
+		k_devjson_protocol_parser_end_number(parser, NULL);	 //!< A top-level number ends with the input
+	}
+	if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state)
+	{
+		k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);	//!< Truncated input
+	}
+	if ((K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parser->status) && parser->req_start)
+	{
+		/* The request came before the ID: now that the ID is known, dispatch it */
+		const char *req_start = parser->req_start;
+		const char *req_end	  = parser->req_end;
+		parser->req_start	= NULL;
+		parser->id_resolved = 1;
+		parser->member		= K_DEVJSON_PROTOCOL_PARSER_KEY_REQ;
+		parser->depth		= 0;
+		k_devjson_protocol_parser_push(parser, '{');  //!< Back inside the envelope
+		parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE;
+		k_devjson_protocol_parser_scan(parser, req_start, (size_t)(req_end - req_start));
+		if ((K_DEVJSON_PROTOCOL_PARSER_STATE_AFTER_VALUE != parser->state) && (K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parser->status))
+		{
+			parser->status = K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON;
+		}
+		parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_DONE;
+	}
+	return parser->status;
+}
+
+static void k_devjson_protocol_parser_on_event(k_devjson_protocol_parser_t *parser, k_devjson_protocol_parser_event_t event, const char *position)
+{
+	const size_t depth = parser->depth;
+	if (1 == depth)
+	{
+		/* Envelope member */
+		if (K_DEVJSON_PROTOCOL_PARSER_EVENT_KEY == event)
+		{
+			parser->member = k_devjson_protocol_parser_skip_repeat(parser, k_devjson_protocol_parser_classify_key(parser->key_string, depth));
+		}
+		else if (K_DEVJSON_PROTOCOL_PARSER_KEY_ID == parser->member)
+		{
+			if ((K_DEVJSON_PROTOCOL_PARSER_EVENT_NUMBER == event) && !parser->id_resolved)
+			{
+				parser->id = k_devjson_protocol_parser_number_to_id(parser->number_value, parser->number_type);
+				k_devjson_protocol_parser_resolve_id(parser);
+			}
+		}
+		else if (K_DEVJSON_PROTOCOL_PARSER_KEY_REQ == parser->member)
+		{
+			if (K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_BEGIN == event)
+			{
+				if (parser->id_resolved)
+				{
+					k_devjson_protocol_writer_begin_object(&parser->writer, k_devjson_protocol_res_key);
+					parser->res_written	  = 1;
+					parser->in_req		  = 1;
+					parser->groups_walked = 0;
+					parser->held_groups	  = 0;
+				}
+				else if (parser->contiguous)
+				{
+					parser->req_start = position;  //!< An ID may still follow: skip the request and replay it at the end
+				}
+				else
+				{
+					parser->req_held  = 1;	//!< An ID may still follow: keep the bytes of the request and replay them at the end
+					parser->raw_start = position;
+				}
+			}
+			else if (K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END == event)
+			{
+				if (parser->in_req)
+				{
+					k_devjson_protocol_parser_replay_group(parser, K_DEVJSON_PROTOCOL_PARSER_KEY_SET);
+					k_devjson_protocol_parser_replay_group(parser, K_DEVJSON_PROTOCOL_PARSER_KEY_CMD);
+					k_devjson_protocol_writer_end_object(&parser->writer);
+				}
+				if (parser->req_held)
+				{
+					k_devjson_protocol_parser_capture(parser, parser->raw_start, (size_t)(position - parser->raw_start));
+					parser->req_start	   = parser->capture_json;
+					parser->req_end		   = parser->capture_json + parser->capture_length;
+					parser->raw_start	   = NULL;
+					parser->capture_length = 0;	 //!< The capture buffer is not written again before the request is replayed
+					parser->req_held	   = 0;
+				}
+				else
+				{
+					parser->req_end = position;
+				}
+				parser->in_req = 0;
+			}
+			else if ((K_DEVJSON_PROTOCOL_PARSER_EVENT_KEY != event) && (K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_END != event) && !parser->res_written)
+			{
+				/* Request is not an object */
+				k_devjson_protocol_writer_begin_object(&parser->writer, k_devjson_protocol_res_key);
+				k_devjson_protocol_writer_end_object(&parser->writer);
+				parser->res_written = 1;
+			}
+		}
+	}
+	else if ((2 == depth) && parser->in_req)
+	{
+		/* Request member: get, set or cmd group */
+		if (K_DEVJSON_PROTOCOL_PARSER_EVENT_KEY == event)
+		{
+			parser->group = k_devjson_protocol_parser_skip_repeat(parser, k_devjson_protocol_parser_classify_key(parser->key_string, depth));
+			if (parser->input_end && !parser->groups_walked &&
+				((K_DEVJSON_PROTOCOL_PARSER_KEY_SET == parser->group) || (K_DEVJSON_PROTOCOL_PARSER_KEY_CMD == parser->group)))
+			{
+				parser->groups_walked = 1;
+				if (k_devjson_protocol_parser_find_group(position, parser->input_end, parser->group))
+				{
+					k_devjson_protocol_parser_walk_groups(parser, position);
+				}
+			}
+			if ((parser->held_groups & (1U << parser->group)) && (position < parser->group_start[parser->group - K_DEVJSON_PROTOCOL_PARSER_KEY_SET]))
+			{
+				parser->group = K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER;	//!< First group of its kind, replayed when the request ends
+			}
+		}
+		else if (K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER != parser->group)
+		{
+			if ((K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END == event) || (K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_END == event))
+			{
+				k_devjson_protocol_parser_close_group(parser);
+			}
+			else
+			{
+				k_devjson_protocol_writer_begin_object(&parser->writer, k_devjson_protocol_parser_group_key(parser->group));
+				parser->group_open = 1;
+				if (K_DEVJSON_PROTOCOL_PARSER_KEY_GET == parser->group)
+				{
+					if (K_DEVJSON_PROTOCOL_PARSER_EVENT_STRING == event)
+					{
+						/* Special case */
+						k_devjson_protocol_parser_dispatch(parser, parser->value_string, (k_devjson_protocol_value_t){.string_value = parser->value_string},
+														   K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING, parser->value_start,
+														   parser->value_start ? (size_t)(position - parser->value_start) : 0);
+					}
+					parser->in_group = K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_BEGIN == event;
+				}
+				else
+				{
+					parser->in_group = K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_BEGIN == event;
+				}
+				if ((K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_BEGIN != event) && (K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_BEGIN != event))
+				{
+					k_devjson_protocol_parser_close_group(parser);	//!< Not a container: the group ends with its value
+				}
+			}
+		}
+	}
+	else if ((3 == depth) && parser->in_group)
+	{
+		/* Group entry */
+		const int				   is_get	  = K_DEVJSON_PROTOCOL_PARSER_KEY_GET == parser->group;
+		const int				   is_cmd	  = K_DEVJSON_PROTOCOL_PARSER_KEY_CMD == parser->group;
+		const char				  *key		  = is_get ? NULL : parser->key_string;
+		const char				  *raw		  = parser->value_start;
+		const size_t			   raw_length = raw ? (size_t)(position - raw) : 0;
+		k_devjson_protocol_value_t value	  = {0};
+		switch (event)
+		{
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_STRING:
+				value.string_value = parser->value_string;
+				k_devjson_protocol_parser_dispatch(parser, is_get ? parser->value_string : key, value, K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING, raw, raw_length);
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_NUMBER:
+				k_devjson_protocol_parser_dispatch(parser, key, parser->number_value, parser->number_type, raw, raw_length);
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_TRUE:
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_FALSE:
+				value.bool_value = K_DEVJSON_PROTOCOL_PARSER_EVENT_TRUE == event ? 1 : 0;
+				k_devjson_protocol_parser_dispatch(parser, key, value, is_get ? K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN : K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL, raw,
+												   raw_length);
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_NULL:
+				k_devjson_protocol_parser_dispatch(parser, key, value, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN, raw, raw_length);
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_BEGIN:
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_BEGIN:
+				if (is_get)
+				{
+					k_devjson_protocol_parser_dispatch(parser, key, value, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN, NULL, 0);
+				}
+				else
+				{
+					parser->raw_start = position;  //!< Dispatched when the container ends, with its bytes
+				}
+				break;
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END:
+			case K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_END:
+				if (is_cmd && (K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END == event))
+				{
+					k_devjson_protocol_lazy_t lazy = {parser->raw_start, (size_t)(position - parser->raw_start), NULL, 0};
+					if (parser->capture_length)
+					{
+						/* The value was split across chunks */
+						k_devjson_protocol_parser_capture(parser, lazy.json, lazy.length);
+						lazy.json			   = parser->capture_json;
+						lazy.length			   = parser->capture_length;
+						parser->capture_length = 0;
+					}
+					parser->raw_start = NULL;
+					if (parser->lazy_json)
+					{
+						/* The tokenizer checked the value: it is handed as is and only parsed if the callback asks for it */
+						value.lazy_value = &lazy;
+						k_devjson_protocol_parser_dispatch(parser, key, value,
+														   K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parser->status ? K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON :
+																												K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN,
+														   lazy.json, lazy.length);
+						k_devjson_protocol_lazy_release(&lazy);
+					}
+					else
+					{
+						value.json_value = cJSON_ParseWithLength(lazy.json, lazy.length);
+						k_devjson_protocol_parser_dispatch(parser, key, value,
+														   value.json_value ? K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON : K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN,
+														   lazy.json, lazy.length);
+						cJSON_Delete(value.json_value);
+					}
+				}
+				else if (!is_get)
+				{
+					/* Only the bytes of a cmd object are kept across chunks */
+					raw = parser->raw_start;
+					k_devjson_protocol_parser_dispatch(parser, key, value, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN, raw, raw ? (size_t)(position - raw) : 0);
+					parser->raw_start = NULL;
+				}
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+static void k_devjson_protocol_parser_dispatch(k_devjson_protocol_parser_t *parser, const char *key, k_devjson_protocol_value_t value,
+											   k_devjson_protocol_value_type_t value_type, const char *raw, const size_t raw_length)
+{
+	k_devjson_protocol_cb_arg_t cb_arg = {0};
+	cb_arg.key						   = key;
+	cb_arg.output_json				   = &parser->writer.items;
+	cb_arg.writer					   = &parser->writer;
+	cb_arg.input_value				   = value;
+	cb_arg.input_value_type			   = value_type;
+	cb_arg.raw						   = raw;
+	cb_arg.raw_length				   = raw_length;
+	cb_arg.id						   = parser->id;
+	cb_arg.deferred					   = parser->deferred;
+	cb_arg.group_type				   = K_DEVJSON_PROTOCOL_PARSER_KEY_GET == parser->group ? K_DEVJSON_PROTOCOL_GROUP_TYPE_GET :
+										 K_DEVJSON_PROTOCOL_PARSER_KEY_SET == parser->group ? K_DEVJSON_PROTOCOL_GROUP_TYPE_SET :
+																							  K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD;
+	if (parser->group_open)
+	{
+		k_devjson_protocol_registry_dispatch(parser->store, parser->store_cache, parser->registry, parser->callback, parser->user_data, &cb_arg);
+		k_devjson_protocol_writer_flush_items(&parser->writer);
+	}
+}
+
+static k_devjson_protocol_parse_status_t k_devjson_protocol_parser_complete(k_devjson_protocol_parser_t *parser)
+{
+	size_t length = 0;
+	if (parser->alloc_failures != k_devjson_protocol_alloc_failures())
+	{
+		k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_OUT_OF_MEMORY);	 //!< Part of the response was dropped
+	}
+	if (K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parser->status)
+	{
+		length = k_devjson_protocol_writer_finish(&parser->writer);
+		if (parser->writer.sink_error)
+		{
+			parser->status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+		}
+		else if (parser->writer.overflow)
+		{
+			parser->status = K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW;	//!< The buffer holds an empty string, length is the size needed
+		}
+	}
+	else if (parser->writer.sink)
+	{
+		if (0 == parser->writer.flushed)
+		{
+			/* Nothing was sent yet: same output as the DOM engine, an empty object */
+			length = sizeof(k_devjson_protocol_parser_empty_response) - 1;
+			(void)parser->writer.sink(parser->writer.sink_arg, k_devjson_protocol_parser_empty_response, length);
+		}
+	}
+	else if (parser->writer.size >= sizeof(k_devjson_protocol_parser_empty_response))
+	{
+		/* Same output as the DOM engine: an empty object */
+		memcpy(parser->writer.buffer, k_devjson_protocol_parser_empty_response, sizeof(k_devjson_protocol_parser_empty_response));
+		length = sizeof(k_devjson_protocol_parser_empty_response) - 1;
+	}
+	if (parser->output)
+	{
+		parser->output->length = length;
+	}
+	if (parser->deferred && parser->deferred->pending)
+	{
+		/* The response is completed by the last deferred key */
+		parser->deferred->status = parser->status;
+		parser->status			 = K_DEVJSON_PROTOCOL_PARSE_PENDING;
+		k_devjson_protocol_deferred_release(parser->deferred);
+	}
+	k_devjson_protocol_parser_release(parser);
+	parser->active = 0;
+	return parser->status;
+}
+
+static void k_devjson_protocol_parser_capture(k_devjson_protocol_parser_t *parser, const char *data, size_t length)
+{
+	if ((parser->capture_length + length <= parser->capture_size) ||
+		k_devjson_protocol_parser_reserve(parser, &parser->capture_json, &parser->capture_size, parser->capture, parser->capture_length,
+										  parser->capture_length + length))
+	{
+		memcpy(&parser->capture_json[parser->capture_length], data, length);
+		parser->capture_length += length;
+	}
+}
+
+static void k_devjson_protocol_parser_begin_string(k_devjson_protocol_parser_t *parser, int is_key)
+{
+	const size_t depth = parser->depth;
+	int			 wanted;
+	if (is_key)
+	{
+		wanted = (1 == depth) || ((2 == depth) && parser->in_req) || ((3 == depth) && parser->in_group);
+	}
+	else
+	{
+		wanted = ((2 == depth) && parser->in_req && (K_DEVJSON_PROTOCOL_PARSER_KEY_GET == parser->group)) || ((3 == depth) && parser->in_group);
+	}
+	parser->is_key		  = is_key;
+	parser->string		  = wanted ? (is_key ? parser->key_string : parser->value_string) : NULL;  //!< Strings nobody reads are only skipped
+	parser->string_size	  = is_key ? parser->key_size : parser->value_size;
+	parser->string_length = 0;
+	parser->surrogate	  = 0;
+	parser->state		  = K_DEVJSON_PROTOCOL_PARSER_STATE_STRING;
+}
+
+static void k_devjson_protocol_parser_append(k_devjson_protocol_parser_t *parser, const char *data, size_t length)
+{
+	if (parser->string)
+	{
+		if (parser->string_length + length >= parser->string_size)
+		{
+			k_devjson_protocol_parser_grow(parser, parser->string_length + length + 1);
+		}
+		if (parser->string_length + length < parser->string_size)
+		{
+			memcpy(&parser->string[parser->string_length], data, length);
+			parser->string_length += length;
+		}
+	}
+}
+
+static void k_devjson_protocol_parser_append_code_point(k_devjson_protocol_parser_t *parser, unsigned long code_point)
+{
+	char   utf8[4];
+	size_t length;
+	if (code_point < 0x80)
+	{
+		utf8[0] = (char)code_point;
+		length	= 1;
+	}
+	else if (code_point < 0x800)
+	{
+		utf8[0] = (char)(0xC0 | (code_point >> 6));
+		utf8[1] = (char)(0x80 | (code_point & 0x3F));
+		length	= 2;
+	}
+	else if (code_point < 0x10000)
+	{
+		utf8[0] = (char)(0xE0 | (code_point >> 12));
+		utf8[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		utf8[2] = (char)(0x80 | (code_point & 0x3F));
+		length	= 3;
+	}
+	else
+	{
+		utf8[0] = (char)(0xF0 | (code_point >> 18));
+		utf8[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+		utf8[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		utf8[3] = (char)(0x80 | (code_point & 0x3F));
+		length	= 4;
+	}
+	k_devjson_protocol_parser_append(parser, utf8, length);
+}
+
+static void k_devjson_protocol_parser_end_value(k_devjson_protocol_parser_t *parser)
+{
+	if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state)
+	{
+		parser->state = 0 == parser->depth ? K_DEVJSON_PROTOCOL_PARSER_STATE_DONE : K_DEVJSON_PROTOCOL_PARSER_STATE_AFTER_VALUE;
+	}
+}
+
+static void k_devjson_protocol_parser_end_number(k_devjson_protocol_parser_t *parser, const char *position)
+{
+	parser->number_type = k_devjson_protocol_number_parse(parser->number, parser->number_length, &parser->number_value);
+	if (K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN != parser->number_type)
+	{
+		k_devjson_protocol_parser_on_event(parser, K_DEVJSON_PROTOCOL_PARSER_EVENT_NUMBER, position);
+		k_devjson_protocol_parser_end_value(parser);
+	}
+	else
+	{
+		k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+	}
+}
+
+static void k_devjson_protocol_parser_grow(k_devjson_protocol_parser_t *parser, const size_t needed)
+{
+	char   **buffer = parser->is_key ? &parser->key_string : &parser->value_string;
+	size_t	*size	= parser->is_key ? &parser->key_size : &parser->value_size;
+	if (k_devjson_protocol_parser_reserve(parser, buffer, size, parser->is_key ? parser->key : parser->value, parser->string_length, needed))
+	{
+		parser->string		= *buffer;
+		parser->string_size = *size;
+	}
+}
+
+static int k_devjson_protocol_parser_reserve(k_devjson_protocol_parser_t *parser, char **buffer, size_t *size, const char *embedded, const size_t used,
+											 const size_t needed)
+{
+	int reserved = 0;
+#ifdef K_DEVJSON_PROTOCOL_STATIC_POOL
+	(void)buffer;
+	(void)size;
+	(void)embedded;
+	(void)used;
+	(void)needed;
+	k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_TOO_LARGE);	 //!< No heap: the value must fit in the parser buffer
+#else
+	const size_t grown_size = needed > 2 * *size ? needed : 2 * *size;
+	char		*grown		= (char *)realloc(embedded == *buffer ? NULL : *buffer, grown_size);
+	if (grown)
+	{
+		if (embedded == *buffer)
+		{
+			memcpy(grown, embedded, used);
+		}
+		*buffer	 = grown;
+		*size	 = grown_size;
+		reserved = 1;
+	}
+	else
+	{
+		k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_OUT_OF_MEMORY);
+	}
+#endif
+	return reserved;
+}
+
+static void k_devjson_protocol_parser_release(k_devjson_protocol_parser_t *parser)
+{
+#ifndef K_DEVJSON_PROTOCOL_STATIC_POOL
+	if (parser->key_string != parser->key)
+	{
+		free(parser->key_string);
+	}
+	if (parser->value_string != parser->value)
+	{
+		free(parser->value_string);
+	}
+	if (parser->capture_json != parser->capture)
+	{
+		free(parser->capture_json);
+	}
+#endif
+	parser->key_string	 = parser->key;
+	parser->value_string = parser->value;
+	parser->capture_json = parser->capture;
+	parser->key_size	 = sizeof(parser->key);
+	parser->value_size	 = sizeof(parser->value);
+	parser->capture_size = sizeof(parser->capture);
+}
+
+static void k_devjson_protocol_parser_push(k_devjson_protocol_parser_t *parser, char container)
+{
+	if (parser->depth < K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH)
+	{
+		const unsigned char bit = (unsigned char)(1U << (parser->depth % 8));
+		if ('[' == container)
+		{
+			parser->nesting[parser->depth / 8] |= bit;
+		}
+		else
+		{
+			parser->nesting[parser->depth / 8] &= (unsigned char)~bit;
+		}
+		parser->depth++;
+	}
+	else
+	{
+		k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);	//!< Nesting too deep
+	}
+}
+
+static char k_devjson_protocol_parser_container(const k_devjson_protocol_parser_t *parser, const size_t level)
+{
+	return (parser->nesting[level / 8] >> (level % 8)) & 1U ? '[' : '{';
+}
+
+static const char *k_devjson_protocol_parser_skip_space(const char *cursor, const char *end)
+{
+	/* A single space between tokens is stepped over: the kernels only pay off on indentation and line breaks */
+	return (cursor + 1 < end) && ((unsigned char)cursor[1] <= ' ') ? k_devjson_protocol_scan_space(cursor + 2, end) : cursor + 1;
+}
+
+static void k_devjson_protocol_parser_fail(k_devjson_protocol_parser_t *parser, k_devjson_protocol_parse_status_t status)
+{
+	if (K_DEVJSON_PROTOCOL_PARSE_SUCCESS == parser->status)
+	{
+		parser->status = status;
+	}
+	parser->state = K_DEVJSON_PROTOCOL_PARSER_STATE_DONE;
+}
+
+int k_devjson_protocol_parser_number_to_id(const k_devjson_protocol_value_t value, const k_devjson_protocol_value_type_t value_type)
+{
+	int id = value.int_value;
+	if (K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT == value_type)
+	{
+		id = value.float_value >= (float)INT_MAX ? INT_MAX : value.float_value <= (float)INT_MIN ? INT_MIN : (int)value.float_value;
+	}
+	return id;
+}
+
+k_devjson_protocol_peek_t k_devjson_protocol_peek_id(const char *json_buffer, const size_t json_length, int *id)
+{
+	k_devjson_protocol_peek_t result = K_DEVJSON_PROTOCOL_PEEK_UNKNOWN;
+	const char				 *end	 = json_buffer + json_length;
+	const char				 *cursor = k_devjson_protocol_peek_space(json_buffer, end);
+	if ((cursor < end) && ('{' == *cursor))
+	{
+		cursor = k_devjson_protocol_peek_space(cursor + 1, end);
+		if ((cursor < end) && ('}' == *cursor))
+		{
+			result = K_DEVJSON_PROTOCOL_PEEK_ABSENT;  //!< Empty object
+		}
+		while (cursor && (cursor < end) && ('"' == *cursor))
+		{
+			const char *key		= cursor + 1;
+			const char *key_end = k_devjson_protocol_peek_string(cursor, end);
+			cursor				= key_end ? k_devjson_protocol_peek_space(key_end, end) : NULL;
+			if (cursor && memchr(key, '\\', (size_t)(key_end - key)))
+			{
+				cursor = NULL;	//!< An escaped key may spell "id": left to the engine
+			}
+			if (cursor && (cursor < end) && (':' == *cursor))
+			{
+				const char *value = k_devjson_protocol_peek_space(cursor + 1, end);
+				cursor			  = k_devjson_protocol_peek_value(value, end);
+				if (cursor && (key_end - key == 3) && (0 == memcmp(key, "id\"", 3)))
+				{
+					/* First "id" member: only a plain number is taken, anything else is left to the engine */
+					k_devjson_protocol_value_t			  number;
+					const size_t						  number_length = (size_t)(cursor - value);
+					const k_devjson_protocol_value_type_t number_type	=
+						number_length < K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE ? k_devjson_protocol_number_parse(value, number_length, &number)
+																			  : K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN;
+					if (K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN != number_type)
+					{
+						*id	   = k_devjson_protocol_parser_number_to_id(number, number_type);
+						result = K_DEVJSON_PROTOCOL_PEEK_FOUND;
+					}
+					cursor = NULL;	//!< Stop at the first ID
+				}
+				cursor = cursor ? k_devjson_protocol_peek_space(cursor, end) : NULL;
+				if (cursor && (cursor < end) && (',' == *cursor))
+				{
+					cursor = k_devjson_protocol_peek_space(cursor + 1, end);
+				}
+				else
+				{
+					if (cursor && (cursor < end) && ('}' == *cursor))
+					{
+						result = K_DEVJSON_PROTOCOL_PEEK_ABSENT;  //!< Last member walked without an ID
+					}
+					cursor = NULL;	//!< End of the object, or a syntax error reported by the engine
+				}
+			}
+			else
+			{
+				cursor = NULL;
+			}
+		}
+	}
+	return result;
+}
+
+k_devjson_protocol_parser_key_t k_devjson_protocol_parser_classify_key(const char *key, const size_t depth)
+{
+	k_devjson_protocol_parser_key_t key_type = K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER;
+	if (1 == depth)
+	{
+		if (0 == strcmp(key, k_devjson_protocol_id_key))
+		{
+			key_type = K_DEVJSON_PROTOCOL_PARSER_KEY_ID;
+		}
+		else if (0 == strcmp(key, k_devjson_protocol_req_key))
+		{
+			key_type = K_DEVJSON_PROTOCOL_PARSER_KEY_REQ;
+		}
+	}
+	else
+	{
+		if (0 == strcmp(key, k_devjson_protocol_get_key))
+		{
+			key_type = K_DEVJSON_PROTOCOL_PARSER_KEY_GET;
+		}
+		else if (0 == strcmp(key, k_devjson_protocol_set_key))
+		{
+			key_type = K_DEVJSON_PROTOCOL_PARSER_KEY_SET;
+		}
+		else if (0 == strcmp(key, k_devjson_protocol_cmd_key))
+		{
+			key_type = K_DEVJSON_PROTOCOL_PARSER_KEY_CMD;
+		}
+	}
+	return key_type;
+}
+
+static void k_devjson_protocol_parser_resolve_id(k_devjson_protocol_parser_t *parser)
+{
+	if (-1 != parser->id)
+	{
+		if (k_devjson_protocol_check_id(parser->callback, parser->user_data, parser->id))
+		{
+			k_devjson_protocol_writer_add(&parser->writer, k_devjson_protocol_id_key, (k_devjson_protocol_value_t){.int_value = parser->id},
+										  K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);  //!< Add the ID to the output JSON
+		}
+		else
+		{
+			k_devjson_protocol_parser_fail(parser, K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);	//!< No need to read the rest of the request
+		}
+	}
+	parser->id_resolved = 1;
+}
+
+const char *k_devjson_protocol_peek_space(const char *cursor, const char *end)
+{
+	while ((cursor < end) && ((unsigned char)*cursor <= ' '))
+	{
+		cursor++;
+	}
+	return cursor;
+}
+
+const char *k_devjson_protocol_peek_string(const char *cursor, const char *end)
+{
+	const char *string_end = NULL;
+	cursor++;  //!< Opening quote
+	while ((cursor < end) && !string_end)
+	{
+		cursor = k_devjson_protocol_scan_string(cursor, end);
+		if ((cursor < end) && ('"' == *cursor))
+		{
+			string_end = cursor + 1;
+		}
+		cursor = end - cursor > 2 ? cursor + 2 : end;	//!< Backslash and the escaped byte
+	}
+	return string_end;
+}
+
+const char *k_devjson_protocol_peek_value(const char *cursor, const char *end)
+{
+	const char *value_end = NULL;
+	if ((cursor < end) && ('"' == *cursor))
+	{
+		value_end = k_devjson_protocol_peek_string(cursor, end);
+	}
+	else if ((cursor < end) && (('{' == *cursor) || ('[' == *cursor)))
+	{
+		/* Brackets are only counted, the content is checked by the engine */
+		size_t depth = 0;
+		if (end - cursor >= K_DEVJSON_PROTOCOL_INDEX_THRESHOLD)
+		{
+			value_end = k_devjson_protocol_index_skip(cursor, end);	 //!< Large request: 64 bytes at a time
+			cursor	  = NULL;
+		}
+		while (cursor && (cursor < end) && !value_end)
+		{
+			if ('"' == *cursor)
+			{
+				cursor = k_devjson_protocol_peek_string(cursor, end);
+			}
+			else
+			{
+				if (('{' == *cursor) || ('[' == *cursor))
+				{
+					depth++;
+				}
+				else if ((('}' == *cursor) || (']' == *cursor)) && (0 == --depth))
+				{
+					value_end = cursor + 1;
+				}
+				cursor++;
+			}
+		}
+	}
+	else
+	{
+		/* Number or literal */
+		while ((cursor < end) && (',' != *cursor) && ('}' != *cursor) && (']' != *cursor) && ((unsigned char)*cursor > ' '))
+		{
+			cursor++;
+		}
+		value_end = cursor < end ? cursor : NULL;
+	}
+	return value_end;
+}
+
+static const char *k_devjson_protocol_parser_group_key(const k_devjson_protocol_parser_key_t group)
+{
+	return K_DEVJSON_PROTOCOL_PARSER_KEY_GET == group ? k_devjson_protocol_get_key :
+		   K_DEVJSON_PROTOCOL_PARSER_KEY_SET == group ? k_devjson_protocol_set_key :
+														k_devjson_protocol_cmd_key;
+}
+
+static void k_devjson_protocol_parser_close_group(k_devjson_protocol_parser_t *parser)
+{
+	if (parser->group_open)
+	{
+		k_devjson_protocol_writer_end_object(&parser->writer);
+		parser->group_open = 0;
+	}
+	parser->in_group = 0;
+}
+
+static int k_devjson_protocol_parser_find_group(const char *cursor, const char *end, const k_devjson_protocol_parser_key_t group)
+{
+	int found = 0;
+	/* The names are matched on their last byte: a byte that is not in "get" or "set" skips a whole name */
+	cursor += 4;
+	while (!found && (cursor < end))
+	{
+		switch (*cursor)
+		{
+			case '"':
+				found = ('"' == cursor[-4]) && ('e' == cursor[-2]) && ('t' == cursor[-1]) &&
+						(('g' == cursor[-3]) || ((K_DEVJSON_PROTOCOL_PARSER_KEY_CMD == group) && ('s' == cursor[-3])));
+				cursor += 4;
+				break;
+			case 't':
+				cursor += 1;
+				break;
+			case 'e':
+				cursor += 2;
+				break;
+			case 'g':
+			case 's':
+				cursor += 3;
+				break;
+			default:
+				cursor += 5;
+				break;
+		}
+	}
+	return found;
+}
+
+static void k_devjson_protocol_parser_walk_groups(k_devjson_protocol_parser_t *parser, const char *cursor)
+{
+	const char					   *end	  = parser->input_end;
+	k_devjson_protocol_parser_key_t group = parser->group;
+	unsigned int					seen  = 0;
+	while (cursor)
+	{
+		cursor = k_devjson_protocol_peek_space(cursor, end);
+		if ((cursor < end) && (':' == *cursor))
+		{
+			const char *value = k_devjson_protocol_peek_space(cursor + 1, end);
+			cursor			  = k_devjson_protocol_peek_value(value, end);
+			if (cursor && (K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER != group))
+			{
+				/* get, set and cmd follow each other in the key enumeration: the groups after this one have the higher bits */
+				const unsigned int later = ((1U << (K_DEVJSON_PROTOCOL_PARSER_KEY_CMD + 1)) - 1U) & ~((1U << (group + 1)) - 1U);
+				parser->held_groups |= seen & later;  //!< Groups read so far that come after this one
+				if ((K_DEVJSON_PROTOCOL_PARSER_KEY_GET != group) && !(seen & (1U << group)))
+				{
+					parser->group_start[group - K_DEVJSON_PROTOCOL_PARSER_KEY_SET] = value;
+					parser->group_end[group - K_DEVJSON_PROTOCOL_PARSER_KEY_SET]	 = cursor;
+				}
+				seen |= 1U << group;
+			}
+			cursor = cursor ? k_devjson_protocol_peek_space(cursor, end) : NULL;
+			if (cursor && (cursor < end) && (',' == *cursor))
+			{
+				const char *key		= k_devjson_protocol_peek_space(cursor + 1, end);
+				const char *key_end = (key < end) && ('"' == *key) ? k_devjson_protocol_peek_string(key, end) : NULL;
+				char		name[4] = {0};
+				if (key_end && (key_end - key == 5))
+				{
+					memcpy(name, key + 1, 3);  //!< An escaped key is not a protocol key here: its group keeps the request order
+				}
+				group  = k_devjson_protocol_parser_classify_key(name, 2);
+				cursor = key_end;
+			}
+			else
+			{
+				cursor = NULL;	//!< End of the request, or a syntax error reported by the engine
+			}
+		}
+		else
+		{
+			cursor = NULL;
+		}
+	}
+}
+
+static void k_devjson_protocol_parser_replay_group(k_devjson_protocol_parser_t *parser, const k_devjson_protocol_parser_key_t group)
+{
+	const size_t index = (size_t)(group - K_DEVJSON_PROTOCOL_PARSER_KEY_SET);
+	if ((parser->held_groups & (1U << group)) && (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state))
+	{
+		/* Scan the group value as if it were read inside the request object */
+		const k_devjson_protocol_parser_state_t state = parser->state;
+		parser->held_groups &= ~(1U << group);
+		parser->depth = 1;
+		k_devjson_protocol_parser_push(parser, '{');
+		parser->in_req = 1;
+		parser->group  = group;
+		parser->state  = K_DEVJSON_PROTOCOL_PARSER_STATE_VALUE;
+		k_devjson_protocol_parser_scan(parser, parser->group_start[index], (size_t)(parser->group_end[index] - parser->group_start[index]));
+		parser->depth = 1;
+		if (K_DEVJSON_PROTOCOL_PARSER_STATE_DONE != parser->state)
+		{
+			parser->state = state;
+		}
+	}
+}
+
+static k_devjson_protocol_parser_key_t k_devjson_protocol_parser_skip_repeat(k_devjson_protocol_parser_t *parser, const k_devjson_protocol_parser_key_t key)
+{
+	k_devjson_protocol_parser_key_t result = key;
+	if (K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER != key)
+	{
+		result = (parser->seen_keys & (1U << key)) ? K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER : key;
+		parser->seen_keys |= 1U << key;
+	}
+	return result;
+}
@@ -15,9 +15,107 @@ extern "C"
 #include "k_devjson_protocol.h"
 
 /* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_WRITER_ITEMS 0x4000	//!< Type flag of the cJSON object embedded in a writer, above the cJSON flags
+#define K_DEVJSON_PROTOCOL_FLOAT_SIZE	24		//!< Buffer size of a formatted float, terminator included
+#define K_DEVJSON_PROTOCOL_SCAN_BLOCK	64		//!< Bytes classified at once for the structural index, one bit each
+
+/* Accesses to the objects declared with K_DEVJSON_PROTOCOL_ATOMIC */
+#if defined(K_DEVJSON_PROTOCOL_C11_ATOMICS)
+#define K_DEVJSON_PROTOCOL_ATOMIC_LOAD(object)		   atomic_load_explicit(object, memory_order_relaxed)
+#define K_DEVJSON_PROTOCOL_ATOMIC_STORE(object, value) atomic_store_explicit(object, value, memory_order_relaxed)
+#define K_DEVJSON_PROTOCOL_ATOMIC_INCREMENT(object)	   atomic_fetch_add_explicit(object, 1, memory_order_relaxed)
+#define K_DEVJSON_PROTOCOL_ATOMIC_DECREMENT(object)	   (atomic_fetch_sub_explicit(object, 1, memory_order_acq_rel) - 1)	 //!< New value
+#elif defined(__GNUC__)
+#define K_DEVJSON_PROTOCOL_ATOMIC_LOAD(object)		   __atomic_load_n(object, __ATOMIC_RELAXED)
+#define K_DEVJSON_PROTOCOL_ATOMIC_STORE(object, value) __atomic_store_n(object, value, __ATOMIC_RELAXED)
+#define K_DEVJSON_PROTOCOL_ATOMIC_INCREMENT(object)	   __atomic_add_fetch(object, 1, __ATOMIC_RELAXED)
+#define K_DEVJSON_PROTOCOL_ATOMIC_DECREMENT(object)	   __atomic_sub_fetch(object, 1, __ATOMIC_ACQ_REL)	//!< New value
+#else
+#define K_DEVJSON_PROTOCOL_ATOMIC_LOAD(object)		   (*(object))
+#define K_DEVJSON_PROTOCOL_ATOMIC_STORE(object, value) (*(object) = (value))
+#define K_DEVJSON_PROTOCOL_ATOMIC_INCREMENT(object)	   (++*(object))
+#define K_DEVJSON_PROTOCOL_ATOMIC_DECREMENT(object)	   (--*(object))  //!< New value
+#endif
+
+#ifdef K_DEVJSON_PROTOCOL_DOM_PARSER
+#define K_DEVJSON_PROTOCOL_ENGINE_DEFAULT K_DEVJSON_PROTOCOL_ENGINE_DOM	//!< Engine of a new context
+#else
+#define K_DEVJSON_PROTOCOL_ENGINE_DEFAULT K_DEVJSON_PROTOCOL_ENGINE_STREAMING	//!< Engine of a new context
+#endif
 /* Typedef -------------------------------------------------------------------*/
+/**
+ * @brief Events emitted by the tokenizer to the dispatcher
+ */
+typedef enum
+{
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_BEGIN,  //!< '{' read
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_OBJECT_END,	   //!< '}' read
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_BEGIN,   //!< '[' read
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_ARRAY_END,	   //!< ']' read
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_KEY,		   //!< Object key completed
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_STRING,		   //!< String value completed
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_NUMBER,		   //!< Number value completed
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_TRUE,		   //!< true literal completed
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_FALSE,		   //!< false literal completed
+	K_DEVJSON_PROTOCOL_PARSER_EVENT_NULL		   //!< null literal completed
+} k_devjson_protocol_parser_event_t;
+
+/**
+ * @brief Outcome of looking for the ID of a request ahead of the engine
+ */
+typedef enum
+{
+	K_DEVJSON_PROTOCOL_PEEK_UNKNOWN,  //!< Left to the engine: the first "id" member is not a plain number, or the request could not be walked
+	K_DEVJSON_PROTOCOL_PEEK_FOUND,	  //!< The first "id" member is a number
+	K_DEVJSON_PROTOCOL_PEEK_ABSENT	  //!< Every member was walked and none is "id"
+} k_devjson_protocol_peek_t;
+
+/**
+ * @brief Members of a request parsed into a cJSON tree
+ */
+typedef struct
+{
+	const cJSON *id;   //!< "id" member, NULL if not present
+	const cJSON *req;  //!< "req" member, NULL if not present
+	const cJSON *get;  //!< "get" member of the request, NULL if not present
+	const cJSON *set;  //!< "set" member of the request, NULL if not present
+	const cJSON *cmd;  //!< "cmd" member of the request, NULL if not present
+} k_devjson_protocol_envelope_t;
+
+/**
+ * @brief Classes of the bytes of a block, bit i for byte i
+ */
+typedef struct
+{
+	uint64_t quote;		 //!< Quotes, escaped or not
+	uint64_t backslash;	 //!< Backslashes
+	uint64_t open;		 //!< Opening braces and brackets, in strings or not
+	uint64_t close;		 //!< Closing braces and brackets, in strings or not
+} k_devjson_protocol_scan_classes_t;
+
+/**
+ * @brief String scanning kernels of an instruction set
+ */
+typedef struct
+{
+	const char *name;											 //!< Instruction set
+	const char *(*string)(const char *cursor, const char *end);	 //!< First quote or backslash, end if none
+	const char *(*escape)(const char *cursor, const char *end);	 //!< First quote, backslash or control character, end if none
+	const char *(*space)(const char *cursor, const char *end);	 //!< First byte that is not whitespace, end if none
+	void (*classify)(const char *block, k_devjson_protocol_scan_classes_t *classes);  //!< Classes of the K_DEVJSON_PROTOCOL_SCAN_BLOCK bytes of a block
+	int (*supported)(void);										 //!< Check of the CPU, NULL if the kernels always run
+} k_devjson_protocol_scan_t;
+
 /* Constant ------------------------------------------------------------------*/
+extern const char *k_devjson_protocol_id_key;	//!< Key for the ID in DevJSON protocol
+extern const char *k_devjson_protocol_req_key;	//!< Key for the request in DevJSON protocol
+extern const char *k_devjson_protocol_res_key;	//!< Key for the response in DevJSON protocol
+extern const char *k_devjson_protocol_get_key;	//!< Key for the GET group in DevJSON protocol
+extern const char *k_devjson_protocol_set_key;	//!< Key for the SET group in DevJSON protocol
+extern const char *k_devjson_protocol_cmd_key;	//!< Key for the CMD group in DevJSON protocol
+
 /* Variable ------------------------------------------------------------------*/
+extern k_devjson_protocol_ctx_t k_devjson_protocol_default_ctx;	//!< Context of the functions that take no context
 /* Function Declaration ------------------------------------------------------*/
 
 /**
@@ -42,6 +140,98 @@ cJSON *k_devjson_protocol_extract_request(const cJSON *json);
  */
 cJSON *k_devjson_protocol_get_group(const cJSON *json, k_devjson_protocol_group_type_t group_type);
 
+/**
+ * @brief Find the members of a request in one pass
+ *
+ * The top-level members and the members of "req" are each visited once. Keys are compared case-sensitively,
+ * as the streaming engine does, and the first member with a given key is kept.
+ * @param json Pointer to the cJSON object of the request
+ * @param envelope Set to the members found
+ */
+void k_devjson_protocol_scan_envelope(const cJSON *json, k_devjson_protocol_envelope_t *envelope);
+
+/**
+ * @brief Ask the callback whether a request ID is accepted
+ * @param callback Callback fired with the ID
+ * @param user_data User data handed to the callback
+ * @param id ID of the request
+ * @return 1 if the callback left the ID unchanged, 0 if the request is addressed to another device
+ */
+int k_devjson_protocol_check_id(k_devjson_protocol_callback_t callback, void *user_data, int id);
+
+/**
+ * @brief Find the top-level ID of a request without parsing the rest of it
+ *
+ * The members before "id" are skipped by matching quotes and brackets only, so a request addressed to another device
+ * can be rejected before its body is read. Invalid JSON is left to the engines to report.
+ * @param json_buffer Request
+ * @param json_length Length of the request
+ * @param id Set to the ID when it is found
+ * @return K_DEVJSON_PROTOCOL_PEEK_FOUND, K_DEVJSON_PROTOCOL_PEEK_ABSENT or K_DEVJSON_PROTOCOL_PEEK_UNKNOWN
+ */
+k_devjson_protocol_peek_t k_devjson_protocol_peek_id(const char *json_buffer, size_t json_length, int *id);
+
+/**
+ * @brief Skip whitespace
+ * @param cursor First byte to look at
+ * @param end End of the buffer
+ * @return First byte that is not whitespace, end if none
+ */
+const char *k_devjson_protocol_peek_space(const char *cursor, const char *end);
+
+/**
+ * @brief Skip a string without decoding it
+ * @param cursor Opening quote
+ * @param end End of the buffer
+ * @return Byte after the closing quote, NULL if the string is not terminated
+ */
+const char *k_devjson_protocol_peek_string(const char *cursor, const char *end);
+
+/**
+ * @brief Skip a value without checking it
+ * @param cursor First byte of the value
+ * @param end End of the buffer
+ * @return Byte after the value, NULL if the value is not terminated before the end of the buffer
+ */
+const char *k_devjson_protocol_peek_value(const char *cursor, const char *end);
+
+/**
+ * @brief Convert a number to a request ID, saturated to the int range
+ * @param value Number, as converted by \ref k_devjson_protocol_number_parse
+ * @param value_type INTEGER or FLOAT
+ * @return ID
+ */
+int k_devjson_protocol_parser_number_to_id(k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type);
+
+/**
+ * @brief Convert a number literal without depending on the locale
+ *
+ * An integral literal in the range of int is converted to an INTEGER without a floating-point round trip.
+ * Other literals are converted to the double strtod would return, with short decimals computed by a single exact
+ * multiplication or division, then typed by \ref k_devjson_protocol_number_value as the DOM engine does: 3.0 is an INTEGER.
+ * @param number Number literal, not NUL-terminated
+ * @param length Length of the literal, less than K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE
+ * @param value Destination of the number
+ * @return K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER or K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN if it is not a number
+ */
+k_devjson_protocol_value_type_t k_devjson_protocol_number_parse(const char *number, size_t length, k_devjson_protocol_value_t *value);
+
+/**
+ * @brief Type a converted number: an integral value in the range of int is an INTEGER, any other value a FLOAT
+ * @param number Value of the cJSON item
+ * @param value Destination of the number
+ * @return K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER or K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT
+ */
+k_devjson_protocol_value_type_t k_devjson_protocol_number_value(double number, k_devjson_protocol_value_t *value);
+
+/**
+ * @brief Tell which protocol key a member is
+ * @param key Key of the member
+ * @param depth 1 for a top-level member, more for a member of the request
+ * @return Protocol key, K_DEVJSON_PROTOCOL_PARSER_KEY_OTHER for a key the protocol does not use at that depth
+ */
+k_devjson_protocol_parser_key_t k_devjson_protocol_parser_classify_key(const char *key, size_t depth);
+
 /**
  * @brief Process entries in a group and call the registered callback function
  * @param id The ID of the request
@@ -51,6 +241,368 @@ cJSON *k_devjson_protocol_get_group(const cJSON *json, k_devjson_protocol_group_
  */
 void k_devjson_protocol_process_group_entries(int id, cJSON *output_json, const cJSON *group, k_devjson_protocol_group_type_t group_type);
 
+/**
+ * @brief Process entries in a group and call the callback of a context
+ * @param ctx Pointer to the context
+ * Refer to \ref k_devjson_protocol_process_group_entries for the other parameters.
+ */
+void k_devjson_protocol_ctx_process_group_entries(const k_devjson_protocol_ctx_t *ctx, int id, cJSON *output_json, const cJSON *group,
+												  k_devjson_protocol_group_type_t group_type);
+
+/**
+ * @brief Serve the key of an entry from the property store, or fire the handler registered for it, or the callback if there is none
+ * @param store Pointer to the property store, may be NULL
+ * @param store_cache Pointer to the cache of the "get all" answer of the store, may be NULL
+ * @param registry Pointer to the registry, may be NULL
+ * @param callback Callback fired for the keys that are not registered
+ * @param user_data User data handed to the callback
+ * @param cb_arg Argument of the entry, its user data is set to the one of the handler fired
+ */
+void k_devjson_protocol_registry_dispatch(const k_devjson_protocol_store_t *store, k_devjson_protocol_store_cache_t *store_cache,
+										  const k_devjson_protocol_registry_t *registry, k_devjson_protocol_callback_t callback, void *user_data,
+										  k_devjson_protocol_cb_arg_t *cb_arg);
+
+/**
+ * @brief Hash a key with FNV-1a
+ * @param seed Mixed into the offset basis, so the same key hashes differently for another seed
+ * @param key Key to hash
+ * @return Hash of the key
+ */
+uint32_t k_devjson_protocol_hash(uint32_t seed, const char *key);
+
+/**
+ * @brief Answer a GET or SET entry whose key is a property
+ *
+ * A GET of "all" answers every property but is not served: the callback still adds the other keys.
+ *
+ * @param store Pointer to the property store, may be NULL
+ * @param store_cache Pointer to the cache of the "get all" answer, may be NULL
+ * @param cb_arg Argument of the entry
+ * @return 1 if the entry was served, 0 if it must be dispatched
+ */
+int k_devjson_protocol_store_serve(const k_devjson_protocol_store_t *store, k_devjson_protocol_store_cache_t *store_cache,
+								   const k_devjson_protocol_cb_arg_t *cb_arg);
+
+/**
+ * @brief Parse a request with the cJSON DOM engine
+ *
+ * The whole request is parsed into a cJSON tree before the groups are dispatched.
+ * Refer to \ref k_devjson_protocol_ctx_parse for the parameters.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_dom(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, size_t json_length,
+															   k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Parse a request with the streaming engine
+ *
+ * The request is scanned once and every get, set and cmd entry is dispatched as soon as it is read.
+ * Refer to \ref k_devjson_protocol_ctx_parse for the parameters.
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parse_sax(const k_devjson_protocol_ctx_t *ctx, const char *json_buffer, size_t json_length,
+															   k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Set up a streaming parser
+ * @param parser Pointer to the parser to set up
+ * @param ctx Context providing the callback fired for every entry and its user data
+ * @param output Destination of the response, its length is set when the request is complete
+ */
+void k_devjson_protocol_parser_setup(k_devjson_protocol_parser_t *parser, const k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Tell a streaming parser that the whole request is in one buffer
+ *
+ * The request can then be replayed if its entries come before its ID, and is rejected before its body is read
+ * if it is for another device. Its groups are dispatched in the get, set, cmd order of the DOM engine.
+ * The buffer must stay valid until the request is complete.
+ * @param parser Pointer to the parser, just set up
+ * @param json_buffer Pointer to the buffer holding the request
+ * @param json_length Number of bytes of the request in the buffer
+ */
+void k_devjson_protocol_parser_contiguous(k_devjson_protocol_parser_t *parser, const char *json_buffer, size_t json_length);
+
+/**
+ * @brief Scan bytes with a streaming parser
+ * @param parser Pointer to the parser
+ * @param data Pointer to the bytes to parse
+ * @param length Number of bytes available
+ * @return Number of bytes consumed. Parsing stops after the top-level value or on error
+ */
+size_t k_devjson_protocol_parser_scan(k_devjson_protocol_parser_t *parser, const char *data, size_t length);
+
+/**
+ * @brief Signal the end of the input to a streaming parser
+ *
+ * Completes a trailing top-level number and replays a request received before its ID.
+ * @param parser Pointer to the parser
+ * @return Status of the parsing operation
+ */
+k_devjson_protocol_parse_status_t k_devjson_protocol_parser_end(k_devjson_protocol_parser_t *parser);
+
+/**
+ * @brief Start serving cJSON allocations of the calling thread from its arena
+ *
+ * Calls can be nested: each one must be paired with \ref k_devjson_protocol_arena_leave.
+ *
+ * @return Mark to pass to \ref k_devjson_protocol_arena_leave.
+ */
+size_t k_devjson_protocol_arena_enter(void);
+
+/**
+ * @brief Release the arena allocations made since the matching \ref k_devjson_protocol_arena_enter
+ *
+ * @param mark Mark returned by \ref k_devjson_protocol_arena_enter.
+ */
+void k_devjson_protocol_arena_leave(size_t mark);
+
+/**
+ * @brief Serve the cJSON allocations of the calling thread from the heap while a handler runs
+ *
+ * What a handler allocates may outlive the parse, so only the trees of the library come from the arena.
+ * Each call must be paired with \ref k_devjson_protocol_arena_resume.
+ *
+ * @return Level to pass to \ref k_devjson_protocol_arena_resume.
+ */
+size_t k_devjson_protocol_arena_suspend(void);
+
+/**
+ * @brief Serve the cJSON allocations from the arena again once the handler returned
+ *
+ * @param level Level returned by \ref k_devjson_protocol_arena_suspend.
+ */
+void k_devjson_protocol_arena_resume(size_t level);
+
+/**
+ * @brief Redirect the cJSON hooks to the arena allocator
+ *
+ * Done once; with K_DEVJSON_PROTOCOL_STATIC_POOL nothing is done.
+ */
+void k_devjson_protocol_arena_install(void);
+
+/**
+ * @brief Bind an arena to the calling thread without installing the allocator
+ *
+ * @param arena Pointer to the arena, NULL to go back to the heap
+ * @return Arena bound before, to restore it
+ */
+k_devjson_protocol_arena_t *k_devjson_protocol_arena_bind(k_devjson_protocol_arena_t *arena);
+
+/**
+ * @brief Install the allocator selected at build time
+ *
+ * With K_DEVJSON_PROTOCOL_STATIC_POOL the cJSON hooks are redirected to the static pools, otherwise nothing is done.
+ */
+void k_devjson_protocol_alloc_init(void);
+
+/**
+ * @brief Get the number of allocations that failed on the calling thread
+ *
+ * Only allocations going through the library allocator (arena or static pool) are counted.
+ * @return Number of failed allocations, compare two readings to detect a failure
+ */
+size_t k_devjson_protocol_alloc_failures(void);
+
+/**
+ * @brief Append the items added with the cJSON API to the object handed to the callback, then delete them
+ *
+ * @param writer Pointer to the writer
+ */
+void k_devjson_protocol_writer_flush_items(k_devjson_protocol_writer_t *writer);
+
+/**
+ * @brief Append a cJSON item printed without formatting, the same way as cJSON_PrintPreallocated
+ *
+ * @param writer Pointer to the writer
+ * @param item Item to print
+ */
+void k_devjson_protocol_writer_json(k_devjson_protocol_writer_t *writer, const cJSON *item);
+
+/**
+ * @brief Append a value without a key, the same way as \ref k_devjson_protocol_writer_add
+ *
+ * A NULL string is written as null.
+ * @param writer Pointer to the writer
+ * @param value The value to append
+ * @param value_type The type of the value
+ */
+void k_devjson_protocol_writer_value(k_devjson_protocol_writer_t *writer, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type);
+
+/**
+ * @brief Append the separator and the key of a member whose value is written later
+ *
+ * @param writer Pointer to the writer
+ * @param key Key of the member
+ * @return Position of the value in the response
+ */
+size_t k_devjson_protocol_writer_placeholder(k_devjson_protocol_writer_t *writer, const char *key);
+
+/**
+ * @brief Append members already serialized, separated by commas, to the current object
+ * @param writer Pointer to the writer
+ * @param members Serialized members, without a leading or trailing comma
+ * @param length Length of the members, 0 to append nothing
+ */
+void k_devjson_protocol_writer_members(k_devjson_protocol_writer_t *writer, const char *members, size_t length);
+
+/**
+ * @brief Start a request whose handlers can defer keys
+ *
+ * @param deferred Pointer to the request
+ * @param output Pointer to the destination of the response
+ */
+void k_devjson_protocol_deferred_begin(k_devjson_protocol_deferred_t *deferred, k_devjson_protocol_output_t *output);
+
+/**
+ * @brief Drop a reference to a request whose keys were deferred: the parse ended or a key was completed
+ *
+ * The last reference inserts the values in the response and fires the completion of the request.
+ * @param deferred Pointer to the request
+ */
+void k_devjson_protocol_deferred_release(k_devjson_protocol_deferred_t *deferred);
+
+/**
+ * @brief Add already serialized JSON to a cJSON object, or write it with the writer embedding the object
+ * @param output_json Pointer to the object
+ * @param key Key of the value
+ * @param json Serialized value, not NUL-terminated
+ * @param length Length of the value
+ * @param const_key 1 to reference the key instead of copying it, the key must then outlive the object
+ */
+void k_devjson_protocol_add_raw_item(cJSON *output_json, const char *key, const char *json, size_t length, int const_key);
+
+/**
+ * @brief Find the end of a run of string characters: the first quote or backslash
+ *
+ * Scans 16 or 32 bytes at a time with the kernels selected for the CPU on the first call.
+ * @param cursor Start of the span
+ * @param end End of the span
+ * @return Pointer to the byte found, end if none
+ */
+const char *k_devjson_protocol_scan_string(const char *cursor, const char *end);
+
+/**
+ * @brief Find the first byte escaped when writing a JSON string: quote, backslash or control character
+ * @param cursor Start of the span
+ * @param end End of the span
+ * @return Pointer to the byte found, end if none
+ */
+const char *k_devjson_protocol_scan_escape(const char *cursor, const char *end);
+
+/**
+ * @brief Find the end of a run of whitespace: the first byte above the space character
+ *
+ * Control characters count as whitespace, the same way as in the tokenizer, which rejects them as tokens.
+ * @param cursor Start of the span
+ * @param end End of the span
+ * @return Pointer to the byte found, end if none
+ */
+const char *k_devjson_protocol_scan_space(const char *cursor, const char *end);
+
+/**
+ * @brief Classify the bytes of a block with the kernels selected for the CPU
+ * @param block Start of the block, K_DEVJSON_PROTOCOL_SCAN_BLOCK bytes
+ * @param classes Destination of the classes
+ */
+void k_devjson_protocol_scan_classify(const char *block, k_devjson_protocol_scan_classes_t *classes);
+
+/**
+ * @brief Get the scanning kernels that run on this CPU
+ * @param index 0 for the kernels in use, then slower ones down to the scalar loop
+ * @return Pointer to the kernels, NULL past the scalar loop
+ */
+const k_devjson_protocol_scan_t *k_devjson_protocol_scan_kernel(size_t index);
+
+/**
+ * @brief Skip a container with the structural index of its bytes, without checking it
+ *
+ * The bytes are classified K_DEVJSON_PROTOCOL_SCAN_BLOCK at a time: the quotes that are not escaped delimit the strings,
+ * and only the braces and brackets outside them are counted, the same way as \ref k_devjson_protocol_peek_value.
+ * @param cursor Opening brace or bracket
+ * @param end End of the buffer
+ * @return Byte after the closing brace or bracket, NULL if the container is not closed before the end of the buffer
+ */
+const char *k_devjson_protocol_index_skip(const char *cursor, const char *end);
+
+/**
+ * @brief Format a float with the fewest digits that read back as the same float
+ *
+ * Plain notation up to 21 integer digits or 6 leading zeros after the decimal point, exponent notation otherwise,
+ * the same way as JavaScript. The decimal point does not depend on the locale.
+ * @param value Value to format
+ * @param buffer Destination, K_DEVJSON_PROTOCOL_FLOAT_SIZE bytes, NUL-terminated
+ * @return Length of the number, "null" for NaN and infinities
+ */
+size_t k_devjson_protocol_float_format(float value, char *buffer);
+
+/**
+ * @brief Format a float with a fixed number of decimals
+ * @param value Value to format
+ * @param decimals Digits after the decimal point, at most K_DEVJSON_PROTOCOL_FLOAT_DECIMALS_MAX
+ * @param buffer Destination, K_DEVJSON_PROTOCOL_FLOAT_SIZE bytes, NUL-terminated
+ * @return Length of the number. Values too large for the decimals are formatted by \ref k_devjson_protocol_float_format
+ */
+size_t k_devjson_protocol_float_fixed(float value, unsigned int decimals, char *buffer);
+
+/* Inline Function Definition ------------------------------------------------*/
+/* GNU builtins when the compiler has them, plain C for the other toolchains */
+
+/**
+ * @brief Count the bits set in a mask
+ * @param mask Mask
+ * @return Number of bits set
+ */
+static inline unsigned int k_devjson_protocol_popcount64(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_popcountll(mask);
+#else
+	mask = mask - ((mask >> 1) & UINT64_C(0x5555555555555555));
+	mask = (mask & UINT64_C(0x3333333333333333)) + ((mask >> 2) & UINT64_C(0x3333333333333333));
+	mask = (mask + (mask >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+	return (unsigned int)((mask * UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
+/**
+ * @brief Count the trailing zero bits of a mask
+ * @param mask Mask, not 0
+ * @return Position of the lowest bit set
+ */
+static inline unsigned int k_devjson_protocol_ctz64(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctzll(mask);
+#else
+	unsigned int count = 0;
+	for (unsigned int width = 32; width; width /= 2)
+	{
+		if (!(mask & ((UINT64_C(1) << width) - 1)))
+		{
+			count += width;
+			mask >>= width;
+		}
+	}
+	return count;
+#endif
+}
+
+/**
+ * @brief Add two masks and tell whether the sum carried out of 64 bits
+ * @param a First mask
+ * @param b Second mask
+ * @param sum Destination of the sum, modulo 2^64
+ * @return 1 on a carry out, 0 otherwise
+ */
+static inline int k_devjson_protocol_add_overflow64(uint64_t a, uint64_t b, uint64_t *sum)
+{
+#if defined(__GNUC__)
+	return __builtin_add_overflow(a, b, sum) ? 1 : 0;
+#else
+	*sum = a + b;
+	return *sum < a;
+#endif
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,147 @@
+/**
+ * @file k_devjson_protocol_registry.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_REGISTRY_FNV_OFFSET 2166136261u	//!< FNV-1a offset basis
+#define K_DEVJSON_PROTOCOL_REGISTRY_FNV_PRIME  16777619u	//!< FNV-1a prime
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Find the handler bound to a key of a group
+ * @param registry Pointer to the registry, may be NULL
+ * @param group_type Group of the key
+ * @param key Key to look up, may be NULL
+ * @return Pointer to the handler, NULL if the key is not registered
+ */
+static const k_devjson_protocol_handler_t *k_devjson_protocol_registry_find(const k_devjson_protocol_registry_t *registry,
+																			 k_devjson_protocol_group_type_t group_type, const char *key);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_devjson_protocol_registry_init(k_devjson_protocol_registry_t *registry, k_devjson_protocol_handler_t *slots, const size_t capacity)
+{
+	if (registry)
+	{
+		size_t usable = 0;
+		if (slots && capacity)
+		{
+			usable = 1;
+			while (usable <= capacity / 2)
+			{
+				usable *= 2;  //!< Largest power of two that fits, so a probe wraps with a mask
+			}
+			memset(slots, 0, usable * sizeof(*slots));
+		}
+		registry->slots	   = slots;
+		registry->capacity = usable;
+		registry->count	   = 0;
+	}
+}
+
+int k_devjson_protocol_registry_add(k_devjson_protocol_registry_t *registry, const k_devjson_protocol_group_type_t group_type, const char *key,
+									const k_devjson_protocol_callback_t handler, void *user_data)
+{
+	int result = -1;
+	if (registry && registry->capacity && key && handler &&
+		((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == group_type) || (K_DEVJSON_PROTOCOL_GROUP_TYPE_SET == group_type) ||
+		 (K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD == group_type)))
+	{
+		const uint32_t				  hash	= k_devjson_protocol_hash((uint32_t)group_type, key);
+		const size_t				  mask	= registry->capacity - 1;
+		size_t						  index = hash & mask;
+		k_devjson_protocol_handler_t *slot	= &registry->slots[index];
+		while (slot->key && !((slot->hash == hash) && (slot->group_type == group_type) && (0 == strcmp(slot->key, key))))
+		{
+			index = (index + 1) & mask;	 //!< Linear probing
+			slot  = &registry->slots[index];
+		}
+		if (slot->key)
+		{
+			slot->handler	= handler;	//!< Key registered again
+			slot->user_data = user_data;
+			result			= 0;
+		}
+		else if ((registry->count + 1) * 4 <= registry->capacity * 3)
+		{
+			/* At most three quarters of the slots are used, so a lookup always meets a free slot */
+			slot->key		 = key;
+			slot->group_type = group_type;
+			slot->handler	 = handler;
+			slot->user_data	 = user_data;
+			slot->hash		 = hash;
+			registry->count++;
+			result = 0;
+		}
+	}
+	return result;
+}
+
+void k_devjson_protocol_ctx_set_registry(k_devjson_protocol_ctx_t *ctx, const k_devjson_protocol_registry_t *registry)
+{
+	ctx->registry = registry;
+}
+
+void k_devjson_protocol_registry_dispatch(const k_devjson_protocol_store_t *store, k_devjson_protocol_store_cache_t *store_cache,
+										  const k_devjson_protocol_registry_t *registry, const k_devjson_protocol_callback_t callback, void *user_data,
+										  k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (!k_devjson_protocol_store_serve(store, store_cache, cb_arg))
+	{
+		const k_devjson_protocol_handler_t *handler		= k_devjson_protocol_registry_find(registry, cb_arg->group_type, cb_arg->key);
+		const size_t						arena_level = k_devjson_protocol_arena_suspend();  //!< The handler may keep what it allocates
+		if (handler)
+		{
+			cb_arg->user_data = handler->user_data;
+			handler->handler(cb_arg);
+		}
+		else
+		{
+			cb_arg->user_data = user_data;
+			callback(cb_arg);
+		}
+		k_devjson_protocol_arena_resume(arena_level);
+	}
+}
+
+uint32_t k_devjson_protocol_hash(const uint32_t seed, const char *key)
+{
+	uint32_t hash = (K_DEVJSON_PROTOCOL_REGISTRY_FNV_OFFSET ^ seed) * K_DEVJSON_PROTOCOL_REGISTRY_FNV_PRIME;
+	while (*key)
+	{
+		hash = (hash ^ (unsigned char)*key++) * K_DEVJSON_PROTOCOL_REGISTRY_FNV_PRIME;
+	}
+	return hash;
+}
+
+static const k_devjson_protocol_handler_t *k_devjson_protocol_registry_find(const k_devjson_protocol_registry_t *registry,
+																			 const k_devjson_protocol_group_type_t group_type, const char *key)
+{
+	const k_devjson_protocol_handler_t *handler = NULL;
+	if (registry && registry->count && key)
+	{
+		const uint32_t						hash  = k_devjson_protocol_hash((uint32_t)group_type, key);
+		const size_t						mask  = registry->capacity - 1;
+		size_t								index = hash & mask;
+		const k_devjson_protocol_handler_t *slot  = &registry->slots[index];
+		while (slot->key && !handler)
+		{
+			if ((slot->hash == hash) && (slot->group_type == group_type) && (0 == strcmp(slot->key, key)))
+			{
+				handler = slot;
+			}
+			index = (index + 1) & mask;
+			slot  = &registry->slots[index];
+		}
+	}
+	return handler;
+}
@@ -0,0 +1,432 @@
+/**
+ * @file k_devjson_protocol_scan.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+#if !defined(K_DEVJSON_PROTOCOL_NO_SIMD) && defined(__SSE2__)
+#include <immintrin.h>
+#elif !defined(K_DEVJSON_PROTOCOL_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Macro ---------------------------------------------------------------------*/
+#if !defined(K_DEVJSON_PROTOCOL_NO_SIMD) && defined(__SSE2__)
+#define K_DEVJSON_PROTOCOL_SCAN_SSE2 1	//!< Part of x86-64: always available
+#if defined(__GNUC__)
+#define K_DEVJSON_PROTOCOL_SCAN_AVX2 1	//!< Compiled with a target attribute, selected if the CPU supports it
+#else
+#define K_DEVJSON_PROTOCOL_SCAN_AVX2 0	//!< The target attribute and the CPU check are GNU extensions
+#endif
+#define K_DEVJSON_PROTOCOL_SCAN_NEON 0
+#elif !defined(K_DEVJSON_PROTOCOL_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define K_DEVJSON_PROTOCOL_SCAN_SSE2 0
+#define K_DEVJSON_PROTOCOL_SCAN_AVX2 0
+#define K_DEVJSON_PROTOCOL_SCAN_NEON 1	//!< Part of AArch64: always available
+#else
+#define K_DEVJSON_PROTOCOL_SCAN_SSE2 0
+#define K_DEVJSON_PROTOCOL_SCAN_AVX2 0
+#define K_DEVJSON_PROTOCOL_SCAN_NEON 0
+#endif
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Find the first quote or backslash, one byte at a time
+ * @param cursor Start of the span
+ * @param end End of the span
+ * @return Pointer to the byte found, end if none
+ */
+static const char *k_devjson_protocol_scan_string_scalar(const char *cursor, const char *end);
+
+/**
+ * @brief Find the first byte escaped in a JSON string: quote, backslash or control character, one byte at a time
+ * @param cursor Start of the span
+ * @param end End of the span
+ * @return Pointer to the byte found, end if none
+ */
+static const char *k_devjson_protocol_scan_escape_scalar(const char *cursor, const char *end);
+
+/**
+ * @brief Find the first byte above the space character, one byte at a time
+ * @param cursor Start of the span
+ * @param end End of the span
+ * @return Pointer to the byte found, end if none
+ */
+static const char *k_devjson_protocol_scan_space_scalar(const char *cursor, const char *end);
+
+/**
+ * @brief Classify the bytes of a block, one byte at a time
+ * @param block Start of the block, K_DEVJSON_PROTOCOL_SCAN_BLOCK bytes
+ * @param classes Destination of the classes
+ */
+static void k_devjson_protocol_scan_classify_scalar(const char *block, k_devjson_protocol_scan_classes_t *classes);
+
+#if K_DEVJSON_PROTOCOL_SCAN_SSE2
+static const char *k_devjson_protocol_scan_string_sse2(const char *cursor, const char *end);
+static const char *k_devjson_protocol_scan_escape_sse2(const char *cursor, const char *end);
+static const char *k_devjson_protocol_scan_space_sse2(const char *cursor, const char *end);
+static void k_devjson_protocol_scan_classify_sse2(const char *block, k_devjson_protocol_scan_classes_t *classes);
+#endif
+
+#if K_DEVJSON_PROTOCOL_SCAN_AVX2
+static const char *k_devjson_protocol_scan_string_avx2(const char *cursor, const char *end);
+static const char *k_devjson_protocol_scan_escape_avx2(const char *cursor, const char *end);
+static const char *k_devjson_protocol_scan_space_avx2(const char *cursor, const char *end);
+static void k_devjson_protocol_scan_classify_avx2(const char *block, k_devjson_protocol_scan_classes_t *classes);
+
+/**
+ * @brief Check whether the CPU runs AVX2 instructions
+ * @return 1 if it does, 0 if not
+ */
+static int k_devjson_protocol_scan_avx2_supported(void);
+#endif
+
+#if K_DEVJSON_PROTOCOL_SCAN_NEON
+static const char *k_devjson_protocol_scan_string_neon(const char *cursor, const char *end);
+static const char *k_devjson_protocol_scan_escape_neon(const char *cursor, const char *end);
+static const char *k_devjson_protocol_scan_space_neon(const char *cursor, const char *end);
+static void k_devjson_protocol_scan_classify_neon(const char *block, k_devjson_protocol_scan_classes_t *classes);
+
+/**
+ * @brief Gather the comparison results of 16 bytes
+ * @param match Comparison result, 0x00 or 0xff in every byte
+ * @return Mask, bit i for byte i
+ */
+static uint64_t k_devjson_protocol_scan_mask_neon(uint8x16_t match);
+#endif
+
+/**
+ * @brief Get the kernels selected for the CPU, on the first call
+ * @return Pointer to the kernels
+ */
+static const k_devjson_protocol_scan_t *k_devjson_protocol_scan_selected(void);
+
+/* Constant ------------------------------------------------------------------*/
+/**
+ * @brief Kernels compiled in, the fastest first
+ */
+static const k_devjson_protocol_scan_t k_devjson_protocol_scan_kernels[] = {
+#if K_DEVJSON_PROTOCOL_SCAN_AVX2
+	{"avx2", k_devjson_protocol_scan_string_avx2, k_devjson_protocol_scan_escape_avx2, k_devjson_protocol_scan_space_avx2,
+	 k_devjson_protocol_scan_classify_avx2, k_devjson_protocol_scan_avx2_supported},
+#endif
+#if K_DEVJSON_PROTOCOL_SCAN_SSE2
+	{"sse2", k_devjson_protocol_scan_string_sse2, k_devjson_protocol_scan_escape_sse2, k_devjson_protocol_scan_space_sse2,
+	 k_devjson_protocol_scan_classify_sse2, NULL},
+#endif
+#if K_DEVJSON_PROTOCOL_SCAN_NEON
+	{"neon", k_devjson_protocol_scan_string_neon, k_devjson_protocol_scan_escape_neon, k_devjson_protocol_scan_space_neon,
+	 k_devjson_protocol_scan_classify_neon, NULL},
+#endif
+	{"scalar", k_devjson_protocol_scan_string_scalar, k_devjson_protocol_scan_escape_scalar, k_devjson_protocol_scan_space_scalar,
+	 k_devjson_protocol_scan_classify_scalar, NULL},
+};
+
+/* Variable ------------------------------------------------------------------*/
+static K_DEVJSON_PROTOCOL_ATOMIC(const k_devjson_protocol_scan_t *) k_devjson_protocol_scan_current = NULL;	 //!< Kernels in use, NULL until the first scan
+
+/* Function Definition -------------------------------------------------------*/
+const char *k_devjson_protocol_scan_string(const char *cursor, const char *end)
+{
+	return k_devjson_protocol_scan_selected()->string(cursor, end);
+}
+
+const char *k_devjson_protocol_scan_escape(const char *cursor, const char *end)
+{
+	return k_devjson_protocol_scan_selected()->escape(cursor, end);
+}
+
+const char *k_devjson_protocol_scan_space(const char *cursor, const char *end)
+{
+	return k_devjson_protocol_scan_selected()->space(cursor, end);
+}
+
+void k_devjson_protocol_scan_classify(const char *block, k_devjson_protocol_scan_classes_t *classes)
+{
+	k_devjson_protocol_scan_selected()->classify(block, classes);
+}
+
+const k_devjson_protocol_scan_t *k_devjson_protocol_scan_kernel(size_t index)
+{
+	const k_devjson_protocol_scan_t *kernel = NULL;
+	for (size_t i = 0; (i < sizeof(k_devjson_protocol_scan_kernels) / sizeof(k_devjson_protocol_scan_kernels[0])) && !kernel; i++)
+	{
+		if (!k_devjson_protocol_scan_kernels[i].supported || k_devjson_protocol_scan_kernels[i].supported())
+		{
+			kernel = 0 == index ? &k_devjson_protocol_scan_kernels[i] : NULL;
+			index--;
+		}
+	}
+	return kernel;
+}
+
+static const k_devjson_protocol_scan_t *k_devjson_protocol_scan_selected(void)
+{
+	/* Every thread selects the same kernels from a constant table: a relaxed race is harmless */
+	const k_devjson_protocol_scan_t *kernel = K_DEVJSON_PROTOCOL_ATOMIC_LOAD(&k_devjson_protocol_scan_current);
+	if (!kernel)
+	{
+		kernel = k_devjson_protocol_scan_kernel(0);
+		K_DEVJSON_PROTOCOL_ATOMIC_STORE(&k_devjson_protocol_scan_current, kernel);
+	}
+	return kernel;
+}
+
+static const char *k_devjson_protocol_scan_string_scalar(const char *cursor, const char *end)
+{
+	while ((cursor < end) && ('"' != *cursor) && ('\\' != *cursor))
+	{
+		cursor++;
+	}
+	return cursor;
+}
+
+static const char *k_devjson_protocol_scan_escape_scalar(const char *cursor, const char *end)
+{
+	while ((cursor < end) && ((unsigned char)*cursor >= 0x20) && ('"' != *cursor) && ('\\' != *cursor))
+	{
+		cursor++;
+	}
+	return cursor;
+}
+
+static const char *k_devjson_protocol_scan_space_scalar(const char *cursor, const char *end)
+{
+	while ((cursor < end) && ((unsigned char)*cursor <= ' '))
+	{
+		cursor++;
+	}
+	return cursor;
+}
+
+static void k_devjson_protocol_scan_classify_scalar(const char *block, k_devjson_protocol_scan_classes_t *classes)
+{
+	memset(classes, 0, sizeof(*classes));
+	for (unsigned int i = 0; i < K_DEVJSON_PROTOCOL_SCAN_BLOCK; i++)
+	{
+		const char	   folded = (char)(block[i] | 0x20);
+		const uint64_t bit	  = UINT64_C(1) << i;
+		classes->quote |= '"' == block[i] ? bit : 0;
+		classes->backslash |= '\\' == block[i] ? bit : 0;
+		classes->open |= '{' == folded ? bit : 0;
+		classes->close |= '}' == folded ? bit : 0;
+	}
+}
+
+#if K_DEVJSON_PROTOCOL_SCAN_SSE2
+static const char *k_devjson_protocol_scan_string_sse2(const char *cursor, const char *end)
+{
+	const __m128i quote		= _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	int			  mask		= 0;
+	while ((end - cursor >= 16) && !mask)
+	{
+		const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)cursor);
+		mask				= _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)));
+		cursor += mask ? k_devjson_protocol_ctz64((unsigned int)mask) : 16;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_string_scalar(cursor, end);	//!< Tail shorter than a block
+}
+
+static const char *k_devjson_protocol_scan_escape_sse2(const char *cursor, const char *end)
+{
+	const __m128i quote		= _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control	= _mm_set1_epi8(0x1f);
+	int			  mask		= 0;
+	while ((end - cursor >= 16) && !mask)
+	{
+		/* No unsigned comparison in SSE2: a byte is a control character when the minimum with 0x1f leaves it unchanged */
+		const __m128i block	  = _mm_loadu_si128((const __m128i *)(const void *)cursor);
+		const __m128i special = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+		mask				  = _mm_movemask_epi8(_mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(block, control), block)));
+		cursor += mask ? k_devjson_protocol_ctz64((unsigned int)mask) : 16;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_escape_scalar(cursor, end);
+}
+
+static const char *k_devjson_protocol_scan_space_sse2(const char *cursor, const char *end)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	int			  mask	= 0;
+	while ((end - cursor >= 16) && !mask)
+	{
+		/* Bytes above the space character are the ones the minimum with it changes */
+		const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)cursor);
+		mask				= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(block, space), block)) ^ 0xffff;
+		cursor += mask ? k_devjson_protocol_ctz64((unsigned int)mask) : 16;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_space_scalar(cursor, end);
+}
+
+static void k_devjson_protocol_scan_classify_sse2(const char *block, k_devjson_protocol_scan_classes_t *classes)
+{
+	const __m128i quote		= _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i fold		= _mm_set1_epi8(0x20);
+	const __m128i open		= _mm_set1_epi8('{');
+	const __m128i close		= _mm_set1_epi8('}');
+	memset(classes, 0, sizeof(*classes));
+	for (unsigned int i = 0; i < K_DEVJSON_PROTOCOL_SCAN_BLOCK; i += 16)
+	{
+		const __m128i bytes	 = _mm_loadu_si128((const __m128i *)(const void *)&block[i]);
+		const __m128i folded = _mm_or_si128(bytes, fold);
+		classes->quote |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)) << i;
+		classes->backslash |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, backslash)) << i;
+		classes->open |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, open)) << i;
+		classes->close |= (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, close)) << i;
+	}
+}
+#endif
+
+#if K_DEVJSON_PROTOCOL_SCAN_AVX2
+__attribute__((target("avx2"))) static const char *k_devjson_protocol_scan_string_avx2(const char *cursor, const char *end)
+{
+	const __m256i quote		= _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	unsigned int  mask		= 0;
+	while ((end - cursor >= 32) && !mask)
+	{
+		const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)cursor);
+		mask				= (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)));
+		cursor += mask ? k_devjson_protocol_ctz64(mask) : 32;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_string_sse2(cursor, end);	 //!< Tail shorter than a block, in one more 16-byte block at most
+}
+
+__attribute__((target("avx2"))) static const char *k_devjson_protocol_scan_escape_avx2(const char *cursor, const char *end)
+{
+	const __m256i quote		= _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i control	= _mm256_set1_epi8(0x1f);
+	unsigned int  mask		= 0;
+	while ((end - cursor >= 32) && !mask)
+	{
+		const __m256i block	  = _mm256_loadu_si256((const __m256i *)(const void *)cursor);
+		const __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash));
+		mask				  = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(special, _mm256_cmpeq_epi8(_mm256_min_epu8(block, control), block)));
+		cursor += mask ? k_devjson_protocol_ctz64(mask) : 32;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_escape_sse2(cursor, end);
+}
+
+__attribute__((target("avx2"))) static const char *k_devjson_protocol_scan_space_avx2(const char *cursor, const char *end)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	unsigned int  mask	= 0;
+	while ((end - cursor >= 32) && !mask)
+	{
+		const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)cursor);
+		mask				= ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(block, space), block));
+		cursor += mask ? k_devjson_protocol_ctz64(mask) : 32;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_space_sse2(cursor, end);
+}
+
+__attribute__((target("avx2"))) static void k_devjson_protocol_scan_classify_avx2(const char *block, k_devjson_protocol_scan_classes_t *classes)
+{
+	const __m256i quote		= _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i fold		= _mm256_set1_epi8(0x20);
+	const __m256i open		= _mm256_set1_epi8('{');
+	const __m256i close		= _mm256_set1_epi8('}');
+	memset(classes, 0, sizeof(*classes));
+	for (unsigned int i = 0; i < K_DEVJSON_PROTOCOL_SCAN_BLOCK; i += 32)
+	{
+		const __m256i bytes	 = _mm256_loadu_si256((const __m256i *)(const void *)&block[i]);
+		const __m256i folded = _mm256_or_si256(bytes, fold);
+		classes->quote |= (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote)) << i;
+		classes->backslash |= (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, backslash)) << i;
+		classes->open |= (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, open)) << i;
+		classes->close |= (uint64_t)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, close)) << i;
+	}
+}
+
+static int k_devjson_protocol_scan_avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? 1 : 0;
+}
+#endif
+
+#if K_DEVJSON_PROTOCOL_SCAN_NEON
+static const char *k_devjson_protocol_scan_string_neon(const char *cursor, const char *end)
+{
+	const uint8x16_t quote	   = vdupq_n_u8('"');
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	uint64_t		 mask	   = 0;
+	while ((end - cursor >= 16) && !mask)
+	{
+		/* No movemask on NEON: narrowing each 16-bit lane by 4 bits leaves one nibble per byte in 64 bits */
+		const uint8x16_t block = vld1q_u8((const uint8_t *)cursor);
+		const uint8x16_t match = vorrq_u8(vceqq_u8(block, quote), vceqq_u8(block, backslash));
+		mask				   = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+		cursor += mask ? k_devjson_protocol_ctz64(mask) / 4 : 16;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_string_scalar(cursor, end);
+}
+
+static const char *k_devjson_protocol_scan_escape_neon(const char *cursor, const char *end)
+{
+	const uint8x16_t quote	   = vdupq_n_u8('"');
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	const uint8x16_t control   = vdupq_n_u8(0x20);
+	uint64_t		 mask	   = 0;
+	while ((end - cursor >= 16) && !mask)
+	{
+		const uint8x16_t block	 = vld1q_u8((const uint8_t *)cursor);
+		const uint8x16_t special = vorrq_u8(vceqq_u8(block, quote), vceqq_u8(block, backslash));
+		const uint8x16_t match	 = vorrq_u8(special, vcltq_u8(block, control));
+		mask					 = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+		cursor += mask ? k_devjson_protocol_ctz64(mask) / 4 : 16;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_escape_scalar(cursor, end);
+}
+
+static const char *k_devjson_protocol_scan_space_neon(const char *cursor, const char *end)
+{
+	const uint8x16_t space = vdupq_n_u8(' ');
+	uint64_t		 mask  = 0;
+	while ((end - cursor >= 16) && !mask)
+	{
+		const uint8x16_t block = vld1q_u8((const uint8_t *)cursor);
+		mask				   = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(vcgtq_u8(block, space)), 4)), 0);
+		cursor += mask ? k_devjson_protocol_ctz64(mask) / 4 : 16;
+	}
+	return mask ? cursor : k_devjson_protocol_scan_space_scalar(cursor, end);
+}
+
+static void k_devjson_protocol_scan_classify_neon(const char *block, k_devjson_protocol_scan_classes_t *classes)
+{
+	const uint8x16_t quote	   = vdupq_n_u8('"');
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	const uint8x16_t fold	   = vdupq_n_u8(0x20);
+	const uint8x16_t open	   = vdupq_n_u8('{');
+	const uint8x16_t close	   = vdupq_n_u8('}');
+	memset(classes, 0, sizeof(*classes));
+	for (unsigned int i = 0; i < K_DEVJSON_PROTOCOL_SCAN_BLOCK; i += 16)
+	{
+		const uint8x16_t bytes	= vld1q_u8((const uint8_t *)&block[i]);
+		const uint8x16_t folded = vorrq_u8(bytes, fold);
+		classes->quote |= k_devjson_protocol_scan_mask_neon(vceqq_u8(bytes, quote)) << i;
+		classes->backslash |= k_devjson_protocol_scan_mask_neon(vceqq_u8(bytes, backslash)) << i;
+		classes->open |= k_devjson_protocol_scan_mask_neon(vceqq_u8(folded, open)) << i;
+		classes->close |= k_devjson_protocol_scan_mask_neon(vceqq_u8(folded, close)) << i;
+	}
+}
+
+static uint64_t k_devjson_protocol_scan_mask_neon(const uint8x16_t match)
+{
+	/* Keep the bit of weight 1 << (i % 8) in byte i, then add up each half */
+	static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	const uint8x16_t	 bits		 = vandq_u8(match, vld1q_u8(weights));
+	return (uint64_t)vaddv_u8(vget_low_u8(bits)) | ((uint64_t)vaddv_u8(vget_high_u8(bits)) << 8);
+}
+#endif
@@ -0,0 +1,299 @@
+/**
+ * @file k_devjson_protocol_store.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_PROPERTY_HASH_SEED 0u  //!< Seed of the key hashes
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Find a property by key
+ * @param store Pointer to the store
+ * @param key Key to look up
+ * @return Pointer to the property, NULL if the key is not a property
+ */
+static k_devjson_protocol_property_t *k_devjson_protocol_property_find(const k_devjson_protocol_store_t *store, const char *key);
+
+/**
+ * @brief Store a SET value in the slot of a property
+ * @param property Pointer to the property
+ * @param value Value of the SET entry
+ * @param value_type Type of the value
+ * @return 0 if the value was stored, -1 if the property is read-only or the value does not fit it
+ */
+static int k_devjson_protocol_property_store(k_devjson_protocol_property_t *property, k_devjson_protocol_value_t value,
+											 k_devjson_protocol_value_type_t value_type);
+
+/**
+ * @brief Read the value held in the slot of a property
+ * @param property Pointer to the property
+ * @return Value of the slot, of the type of the property
+ */
+static k_devjson_protocol_value_t k_devjson_protocol_property_value(const k_devjson_protocol_property_t *property);
+
+/**
+ * @brief Answer the value held in the slot of a property
+ * @param property Pointer to the property
+ * @param output_json Response the value is added to
+ */
+static void k_devjson_protocol_property_answer(const k_devjson_protocol_property_t *property, cJSON *output_json);
+
+/**
+ * @brief Serialize again the members of the properties changed since they were cached
+ *
+ * The members from the first changed property on are moved to the end of the buffer, then brought back one by one
+ * behind the ones already rewritten: a changed member is serialized in the gap left between them.
+ *
+ * @param store Pointer to the store
+ * @param cache Pointer to the cache
+ * @return 1 if the cache holds every member, 0 if it cannot be used
+ */
+static int k_devjson_protocol_store_cache_refresh(const k_devjson_protocol_store_t *store, k_devjson_protocol_store_cache_t *cache);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_devjson_protocol_store_init(k_devjson_protocol_store_t *store, k_devjson_protocol_property_t *properties, const size_t count)
+{
+	if (store)
+	{
+		store->properties = properties;
+		store->count	  = properties ? count : 0;
+		for (size_t i = 0; i < store->count; i++)
+		{
+			properties[i].hash = k_devjson_protocol_hash(K_DEVJSON_PROTOCOL_PROPERTY_HASH_SEED, properties[i].key);
+		}
+	}
+}
+
+void k_devjson_protocol_ctx_set_store(k_devjson_protocol_ctx_t *ctx, const k_devjson_protocol_store_t *store)
+{
+	ctx->store = store;
+}
+
+void k_devjson_protocol_property_changed(k_devjson_protocol_property_t *property)
+{
+	property->version++;
+}
+
+void k_devjson_protocol_store_cache_init(k_devjson_protocol_store_cache_t *cache, k_devjson_protocol_fragment_t *fragments, const size_t count, char *buffer,
+										 const size_t size)
+{
+	if (cache)
+	{
+		cache->fragments = fragments;
+		cache->count	 = fragments ? count : 0;
+		cache->buffer	 = buffer;
+		cache->size		 = buffer ? size : 0;
+		cache->length	 = 0;
+		cache->valid	 = 0;
+	}
+}
+
+void k_devjson_protocol_ctx_set_store_cache(k_devjson_protocol_ctx_t *ctx, k_devjson_protocol_store_cache_t *cache)
+{
+	ctx->store_cache = cache;
+}
+
+int k_devjson_protocol_store_serve(const k_devjson_protocol_store_t *store, k_devjson_protocol_store_cache_t *store_cache,
+								   const k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	int served = 0;
+	if (store && store->count && cb_arg->key)
+	{
+		if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type) && (0 == strcmp(cb_arg->key, "all")))
+		{
+			if (store_cache && cb_arg->output_json && (cb_arg->output_json->type & K_DEVJSON_PROTOCOL_WRITER_ITEMS) &&
+				k_devjson_protocol_store_cache_refresh(store, store_cache))
+			{
+				/* Response written by the streaming engine: the cached members are copied as they are */
+				k_devjson_protocol_writer_members((k_devjson_protocol_writer_t *)cb_arg->output_json, store_cache->buffer, store_cache->length);
+			}
+			else
+			{
+				for (size_t i = 0; i < store->count; i++)
+				{
+					k_devjson_protocol_property_answer(&store->properties[i], cb_arg->output_json);
+				}
+			}
+		}
+		else if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type) || (K_DEVJSON_PROTOCOL_GROUP_TYPE_SET == cb_arg->group_type))
+		{
+			k_devjson_protocol_property_t *property = k_devjson_protocol_property_find(store, cb_arg->key);
+			if (property)
+			{
+				if (K_DEVJSON_PROTOCOL_GROUP_TYPE_SET == cb_arg->group_type)
+				{
+					/* A refused value answers the current one */
+					(void)k_devjson_protocol_property_store(property, cb_arg->input_value, cb_arg->input_value_type);
+				}
+				k_devjson_protocol_property_answer(property, cb_arg->output_json);
+				served = 1;
+			}
+		}
+	}
+	return served;
+}
+
+static k_devjson_protocol_property_t *k_devjson_protocol_property_find(const k_devjson_protocol_store_t *store, const char *key)
+{
+	k_devjson_protocol_property_t *property = NULL;
+	const uint32_t				   hash		= k_devjson_protocol_hash(K_DEVJSON_PROTOCOL_PROPERTY_HASH_SEED, key);
+	for (size_t i = 0; (i < store->count) && !property; i++)
+	{
+		if ((store->properties[i].hash == hash) && (0 == strcmp(store->properties[i].key, key)))
+		{
+			property = &store->properties[i];
+		}
+	}
+	return property;
+}
+
+static int k_devjson_protocol_property_store(k_devjson_protocol_property_t *property, const k_devjson_protocol_value_t value,
+											 const k_devjson_protocol_value_type_t value_type)
+{
+	int			result = -1;
+	const int	ranged = property->flags & K_DEVJSON_PROTOCOL_PROPERTY_RANGE;
+	const float number = K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER == value_type ? (float)value.int_value : value.float_value;
+	if (property->flags & K_DEVJSON_PROTOCOL_PROPERTY_READ_ONLY)
+	{
+		/* Not written by a SET */
+	}
+	else if (K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER == property->type)
+	{
+		int integral = K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER == value_type;
+		int integer	 = value.int_value;
+		if ((K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT == value_type) && (number >= -2147483648.0f) && (number < 2147483648.0f) && ((float)(int)number == number))
+		{
+			integral = 1;  //!< Such as 2.0 or 1e2: an integral float in the range of int is stored
+			integer	 = (int)number;
+		}
+		if (integral && (!ranged || ((integer >= property->min.int_value) && (integer <= property->max.int_value))))
+		{
+			*(int *)property->storage = integer;
+			result					  = 0;
+		}
+	}
+	else if (K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT == property->type)
+	{
+		if (((K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT == value_type) || (K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER == value_type)) &&
+			(!ranged || ((number >= property->min.float_value) && (number <= property->max.float_value))))
+		{
+			*(float *)property->storage = number;
+			result						= 0;
+		}
+	}
+	else if (K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL == property->type)
+	{
+		if (K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL == value_type)
+		{
+			*(int *)property->storage = value.bool_value ? 1 : 0;
+			result					  = 0;
+		}
+	}
+	else if (K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING == property->type)
+	{
+		const size_t length = K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING == value_type ? strlen(value.string_value) : property->size;
+		if (length < property->size)
+		{
+			memcpy(property->storage, value.string_value, length + 1);
+			result = 0;
+		}
+	}
+	if (0 == result)
+	{
+		property->version++;
+	}
+	return result;
+}
+
+static k_devjson_protocol_value_t k_devjson_protocol_property_value(const k_devjson_protocol_property_t *property)
+{
+	k_devjson_protocol_value_t value = {0};
+	switch (property->type)
+	{
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER:
+			value.int_value = *(const int *)property->storage;
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT:
+			value.float_value = *(const float *)property->storage;
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL:
+			value.bool_value = *(const int *)property->storage;
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING:
+			value.string_value = property->storage;
+			break;
+		default:
+			break;
+	}
+	return value;
+}
+
+static void k_devjson_protocol_property_answer(const k_devjson_protocol_property_t *property, cJSON *output_json)
+{
+	if ((K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT == property->type) && (property->flags & K_DEVJSON_PROTOCOL_PROPERTY_FIXED))
+	{
+		char number[K_DEVJSON_PROTOCOL_FLOAT_SIZE];
+		k_devjson_protocol_add_raw_item(output_json, property->key, number,
+										k_devjson_protocol_float_fixed(*(const float *)property->storage, (unsigned int)property->size, number), 1);
+	}
+	else
+	{
+		/* The key outlives the store, and so the response: the DOM engine references it instead of copying it */
+		k_devjson_protocol_add_const_response(output_json, property->key, k_devjson_protocol_property_value(property), property->type);
+	}
+}
+
+static int k_devjson_protocol_store_cache_refresh(const k_devjson_protocol_store_t *store, k_devjson_protocol_store_cache_t *cache)
+{
+	size_t first = 0;
+	int	   valid = cache->count >= store->count;
+	while (valid && cache->valid && (first < store->count) && (cache->fragments[first].version == store->properties[first].version))
+	{
+		first++;
+	}
+	if (valid && (first < store->count))
+	{
+		const size_t start	  = cache->valid ? cache->fragments[first].offset : 0;
+		const size_t moved	  = cache->valid ? cache->length - start : 0;
+		const char	*tail	  = cache->buffer + cache->size - moved;
+		size_t		 position = start;
+		memmove(cache->buffer + cache->size - moved, cache->buffer + start, moved);
+		for (size_t i = first; valid && (i < store->count); i++)
+		{
+			const k_devjson_protocol_property_t *property = &store->properties[i];
+			k_devjson_protocol_fragment_t		*fragment = &cache->fragments[i];
+			if (cache->valid && (fragment->version == property->version))
+			{
+				memmove(cache->buffer + position, tail + (fragment->offset - start), fragment->length);	//!< Unchanged: moved back
+			}
+			else
+			{
+				/* Serialized up to the member of the next property, still waiting in the tail */
+				const int					next  = cache->valid && (i + 1 < store->count);
+				const char				   *limit = next ? tail + (cache->fragments[i + 1].offset - start) : cache->buffer + cache->size;
+				k_devjson_protocol_writer_t writer;
+				k_devjson_protocol_writer_init(&writer, cache->buffer + position, (size_t)(limit - (cache->buffer + position)));
+				writer.empty = 0 == i;	//!< Every member but the first carries its comma
+				k_devjson_protocol_property_answer(property, &writer.items);
+				valid			  = !writer.overflow;
+				fragment->length  = writer.length;
+				fragment->version = property->version;
+			}
+			fragment->offset = position;
+			position += fragment->length;
+		}
+		cache->length = valid ? position : 0;
+		cache->valid  = valid;
+	}
+	return valid;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file k_devjson_protocol_stream.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Start the request of the current line
+ * @param stream Pointer to the processor
+ * @param request Pointer to the first byte of the request
+ * @param line_end Pointer to the newline ending the request, NULL if the line continues in the next call
+ */
+static void k_devjson_protocol_stream_begin(k_devjson_protocol_stream_t *stream, const char *request, const char *line_end);
+
+/**
+ * @brief Terminate the response of the completed request with a newline
+ * @param stream Pointer to the processor
+ */
+static void k_devjson_protocol_stream_respond(k_devjson_protocol_stream_t *stream);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_devjson_protocol_stream_init(k_devjson_protocol_stream_t *stream, const k_devjson_protocol_ctx_t *ctx, const k_devjson_protocol_output_t *output)
+{
+	stream->ctx		   = ctx;
+	stream->output	   = *output;
+	stream->in_request = 0;
+	stream->skip_line  = 0;
+	stream->status	   = K_DEVJSON_PROTOCOL_PARSE_SUCCESS;
+	stream->responses  = 0;
+	stream->failures   = 0;
+}
+
+size_t k_devjson_protocol_stream_feed(k_devjson_protocol_stream_t *stream, const char *data, const size_t length)
+{
+	const size_t responses = stream->responses;
+	const char	*cursor	   = data;
+	const char	*end	   = data ? data + length : data;
+	while (cursor < end)
+	{
+		const char *line_end = memchr(cursor, '\n', (size_t)(end - cursor));
+		const char *stop	 = line_end ? line_end : end;
+		if (!stream->in_request && !stream->skip_line)
+		{
+			cursor = k_devjson_protocol_peek_space(cursor, stop);  //!< Blank lines and indentation
+			if (cursor < stop)
+			{
+				k_devjson_protocol_stream_begin(stream, cursor, line_end);
+			}
+		}
+		if (stream->in_request)
+		{
+			(void)k_devjson_protocol_parser_feed(&stream->parser, cursor, (size_t)(stop - cursor), NULL);
+			if (line_end && stream->parser.active)
+			{
+				(void)k_devjson_protocol_parser_finish(&stream->parser);  //!< The newline ends the request, even if it is truncated
+			}
+			if (!stream->parser.active)
+			{
+				k_devjson_protocol_stream_respond(stream);
+			}
+		}
+		stream->skip_line = line_end ? 0 : stream->skip_line;
+		cursor			  = line_end ? line_end + 1 : end;
+	}
+	return stream->responses - responses;
+}
+
+size_t k_devjson_protocol_stream_finish(k_devjson_protocol_stream_t *stream)
+{
+	const size_t responses = stream->responses;
+	if (stream->in_request)
+	{
+		(void)k_devjson_protocol_parser_finish(&stream->parser);
+		k_devjson_protocol_stream_respond(stream);
+	}
+	stream->skip_line = 0;
+	return stream->responses - responses;
+}
+
+static void k_devjson_protocol_stream_begin(k_devjson_protocol_stream_t *stream, const char *request, const char *line_end)
+{
+	k_devjson_protocol_ctx_parser_init(stream->ctx, &stream->parser, &stream->output);
+	if (line_end && stream->parser.active)
+	{
+		/* The whole line is in this call: parsed as k_devjson_protocol_ctx_parse would */
+		k_devjson_protocol_parser_contiguous(&stream->parser, request, (size_t)(line_end - request));
+	}
+	stream->in_request = 1;
+}
+
+static void k_devjson_protocol_stream_respond(k_devjson_protocol_stream_t *stream)
+{
+	stream->status = stream->parser.status;
+	if (!stream->output.sink || (0 != stream->output.sink(stream->output.sink_arg, "\n", 1)))
+	{
+		stream->status = K_DEVJSON_PROTOCOL_PARSE_ERROR;
+	}
+	stream->failures += K_DEVJSON_PROTOCOL_PARSE_SUCCESS == stream->status ? 0 : 1;
+	stream->responses++;
+	stream->in_request = 0;
+	stream->skip_line  = 1;
+}
@@ -0,0 +1,385 @@
+/**
+ * @file k_devjson_protocol_writer.c
+ * @ingroup k_devjson_protocol
+ * @{
+ */
+
+/* Include -------------------------------------------------------------------*/
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "k_devjson_protocol_priv.h"
+
+/* Macro ---------------------------------------------------------------------*/
+#define K_DEVJSON_PROTOCOL_WRITER_INTEGER_SIZE (sizeof(int) * 3 + 1)  //!< Longest integer printed: sign and at most three digits per byte
+
+/* Typedef -------------------------------------------------------------------*/
+/* Function Declaration ------------------------------------------------------*/
+/**
+ * @brief Append raw bytes, or only account for them once the buffer is full
+ * @param writer Pointer to the writer
+ * @param data Bytes to append
+ * @param length Number of bytes
+ */
+static void k_devjson_protocol_writer_put(k_devjson_protocol_writer_t *writer, const char *data, size_t length);
+
+/**
+ * @brief Hand bytes to the sink and account for them as flushed
+ * @param writer Pointer to the writer
+ * @param data Bytes to hand over
+ * @param length Number of bytes
+ */
+static void k_devjson_protocol_writer_send(k_devjson_protocol_writer_t *writer, const char *data, size_t length);
+
+/**
+ * @brief Hand the bytes held in the buffer to the sink
+ * @param writer Pointer to the writer
+ */
+static void k_devjson_protocol_writer_flush(k_devjson_protocol_writer_t *writer);
+
+/**
+ * @brief Print a cJSON item in place, in the free part of the buffer
+ * @param writer Pointer to the writer
+ * @param item Item to print
+ * @return 1 if the item was printed, 0 if it does not fit
+ */
+static int k_devjson_protocol_writer_print(k_devjson_protocol_writer_t *writer, const cJSON *item);
+
+/**
+ * @brief Append the separator and the key of a new member of the current object
+ * @param writer Pointer to the writer
+ * @param key Key of the member, NULL for the root object
+ */
+static void k_devjson_protocol_writer_member(k_devjson_protocol_writer_t *writer, const char *key);
+
+/**
+ * @brief Append a string literal escaped the same way as cJSON
+ * @param writer Pointer to the writer
+ * @param string NUL-terminated string
+ */
+static void k_devjson_protocol_writer_string(k_devjson_protocol_writer_t *writer, const char *string);
+
+/**
+ * @brief Append an integer formatted the same way as cJSON
+ * @param writer Pointer to the writer
+ * @param number Integer to append
+ */
+static void k_devjson_protocol_writer_integer(k_devjson_protocol_writer_t *writer, int number);
+
+/* Constant ------------------------------------------------------------------*/
+/* Variable ------------------------------------------------------------------*/
+/* Function Definition -------------------------------------------------------*/
+void k_devjson_protocol_writer_init(k_devjson_protocol_writer_t *writer, char *buffer, const size_t size)
+{
+	memset(&writer->items, 0, sizeof(writer->items));
+	writer->items.type = cJSON_Object | K_DEVJSON_PROTOCOL_WRITER_ITEMS;
+	writer->buffer	   = buffer;
+	writer->size	   = buffer ? size : 0;
+	writer->length	   = 0;
+	writer->flushed	   = 0;
+	writer->depth	   = 0;
+	writer->empty	   = 1;
+	writer->overflow   = 0;
+	writer->sink_error = 0;
+	writer->sink	   = NULL;
+	writer->sink_arg   = NULL;
+}
+
+void k_devjson_protocol_writer_set_sink(k_devjson_protocol_writer_t *writer, k_devjson_protocol_sink_t sink, void *sink_arg)
+{
+	writer->sink	 = sink;
+	writer->sink_arg = sink_arg;
+}
+
+void k_devjson_protocol_writer_begin_object(k_devjson_protocol_writer_t *writer, const char *key)
+{
+	k_devjson_protocol_writer_member(writer, key);
+	k_devjson_protocol_writer_put(writer, "{", 1);
+	writer->depth++;
+	writer->empty = 1;
+}
+
+void k_devjson_protocol_writer_end_object(k_devjson_protocol_writer_t *writer)
+{
+	if (writer->depth)
+	{
+		k_devjson_protocol_writer_put(writer, "}", 1);
+		writer->depth--;
+		writer->empty = 0;
+	}
+}
+
+void k_devjson_protocol_writer_add(k_devjson_protocol_writer_t *writer, const char *key, k_devjson_protocol_value_t value,
+								   k_devjson_protocol_value_type_t value_type)
+{
+	/* Same members as k_devjson_protocol_add_response on a cJSON object: a NULL string is not added */
+	if (key && ((K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING != value_type) || value.string_value))
+	{
+		k_devjson_protocol_writer_member(writer, key);
+		k_devjson_protocol_writer_value(writer, value, value_type);
+	}
+}
+
+void k_devjson_protocol_writer_add_json(k_devjson_protocol_writer_t *writer, const char *key, const cJSON *item)
+{
+	if (key && item)
+	{
+		k_devjson_protocol_writer_member(writer, key);
+		k_devjson_protocol_writer_json(writer, item);
+	}
+}
+
+void k_devjson_protocol_writer_add_raw(k_devjson_protocol_writer_t *writer, const char *key, const char *json, const size_t length)
+{
+	if (key && json && length)
+	{
+		k_devjson_protocol_writer_member(writer, key);
+		k_devjson_protocol_writer_put(writer, json, length);  //!< Already serialized: copied as is
+	}
+}
+
+size_t k_devjson_protocol_writer_placeholder(k_devjson_protocol_writer_t *writer, const char *key)
+{
+	k_devjson_protocol_writer_flush_items(writer);	//!< Members added before the key keep their place
+	k_devjson_protocol_writer_member(writer, key);
+	return writer->length;
+}
+
+void k_devjson_protocol_writer_members(k_devjson_protocol_writer_t *writer, const char *members, const size_t length)
+{
+	if (length)
+	{
+		k_devjson_protocol_writer_member(writer, NULL);	 //!< Separator only: the members carry their keys
+		k_devjson_protocol_writer_put(writer, members, length);
+	}
+}
+
+size_t k_devjson_protocol_writer_finish(k_devjson_protocol_writer_t *writer)
+{
+	while (writer->depth)
+	{
+		k_devjson_protocol_writer_end_object(writer);
+	}
+	if (writer->sink)
+	{
+		k_devjson_protocol_writer_flush(writer);
+	}
+	else if (writer->size)
+	{
+		writer->buffer[writer->overflow ? 0 : writer->length] = '\0';
+	}
+	return writer->length;
+}
+
+void k_devjson_protocol_writer_flush_items(k_devjson_protocol_writer_t *writer)
+{
+	if (writer->items.child)
+	{
+		for (const cJSON *item = writer->items.child; item; item = item->next)
+		{
+			k_devjson_protocol_writer_add_json(writer, item->string, item);
+		}
+		cJSON_Delete(writer->items.child);
+		writer->items.child = NULL;
+	}
+}
+
+void k_devjson_protocol_writer_json(k_devjson_protocol_writer_t *writer, const cJSON *item)
+{
+	int printed = k_devjson_protocol_writer_print(writer, item);
+	if (!printed && writer->sink && (writer->length != writer->flushed))
+	{
+		k_devjson_protocol_writer_flush(writer);
+		printed = k_devjson_protocol_writer_print(writer, item);  //!< Retry in the emptied buffer
+	}
+	if (!printed)
+	{
+		/* Does not fit (cJSON wants some slack): print it on its own to copy it or to know its size */
+		char *printed_json = cJSON_PrintUnformatted(item);
+		if (printed_json)
+		{
+			k_devjson_protocol_writer_put(writer, printed_json, strlen(printed_json));
+			cJSON_free(printed_json);
+		}
+		else
+		{
+			k_devjson_protocol_writer_put(writer, "null", 4);
+		}
+	}
+}
+
+void k_devjson_protocol_writer_value(k_devjson_protocol_writer_t *writer, k_devjson_protocol_value_t value, k_devjson_protocol_value_type_t value_type)
+{
+	char number[K_DEVJSON_PROTOCOL_FLOAT_SIZE];
+	switch (value_type)
+	{
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER:
+			k_devjson_protocol_writer_integer(writer, value.int_value);
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT:
+			k_devjson_protocol_writer_put(writer, number, k_devjson_protocol_float_format(value.float_value, number));
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING:
+			if (value.string_value)
+			{
+				k_devjson_protocol_writer_string(writer, value.string_value);
+			}
+			else
+			{
+				k_devjson_protocol_writer_put(writer, "null", 4);
+			}
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL:
+			k_devjson_protocol_writer_put(writer, value.bool_value ? "true" : "false", value.bool_value ? 4 : 5);
+			break;
+		case K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON:
+			if (value.lazy_value && value.lazy_value->json)
+			{
+				k_devjson_protocol_writer_put(writer, value.lazy_value->json, value.lazy_value->length);  //!< Forwarded as received
+			}
+			else if (value.lazy_value && value.lazy_value->item)
+			{
+				k_devjson_protocol_writer_json(writer, value.lazy_value->item);
+			}
+			else
+			{
+				k_devjson_protocol_writer_put(writer, "null", 4);
+			}
+			break;
+		default:
+			k_devjson_protocol_writer_put(writer, "null", 4);  //!< Add null if the output value type is unknown
+			break;
+	}
+}
+
+static void k_devjson_protocol_writer_put(k_devjson_protocol_writer_t *writer, const char *data, const size_t length)
+{
+	if (writer->sink)
+	{
+		if (length > writer->size - (writer->length - writer->flushed))
+		{
+			k_devjson_protocol_writer_flush(writer);  //!< Buffer full: hand it to the transport
+		}
+		if (length > writer->size)
+		{
+			k_devjson_protocol_writer_send(writer, data, length);  //!< Larger than the buffer: no need to copy it
+		}
+		else if (length)
+		{
+			memcpy(writer->buffer + (writer->length - writer->flushed), data, length);
+		}
+	}
+	else if (!writer->overflow && (length < writer->size - writer->length))
+	{
+		memcpy(writer->buffer + writer->length, data, length);
+	}
+	else
+	{
+		writer->overflow = 1;  //!< Keep counting to report the required size
+	}
+	writer->length += length;
+}
+
+static void k_devjson_protocol_writer_send(k_devjson_protocol_writer_t *writer, const char *data, const size_t length)
+{
+	if (length && !writer->sink_error && (0 != writer->sink(writer->sink_arg, data, length)))
+	{
+		writer->sink_error = 1;
+	}
+	writer->flushed += length;
+}
+
+static void k_devjson_protocol_writer_flush(k_devjson_protocol_writer_t *writer)
+{
+	k_devjson_protocol_writer_send(writer, writer->buffer, writer->length - writer->flushed);
+}
+
+static int k_devjson_protocol_writer_print(k_devjson_protocol_writer_t *writer, const cJSON *item)
+{
+	const size_t used	   = writer->length - writer->flushed;
+	const size_t available = writer->size - used;
+	int			 printed   = 0;
+	if (!writer->overflow && available && (available <= INT_MAX) && cJSON_PrintPreallocated((cJSON *)item, writer->buffer + used, (int)available, 0))
+	{
+		writer->length += strlen(writer->buffer + used);
+		printed = 1;
+	}
+	return printed;
+}
+
+static void k_devjson_protocol_writer_member(k_devjson_protocol_writer_t *writer, const char *key)
+{
+	if (!writer->empty)
+	{
+		k_devjson_protocol_writer_put(writer, ",", 1);
+	}
+	if (key)
+	{
+		k_devjson_protocol_writer_string(writer, key);
+		k_devjson_protocol_writer_put(writer, ":", 1);
+	}
+	writer->empty = 0;
+}
+
+static void k_devjson_protocol_writer_string(k_devjson_protocol_writer_t *writer, const char *string)
+{
+	const char *end	   = string + strlen(string);
+	const char *cursor = string;
+	k_devjson_protocol_writer_put(writer, "\"", 1);
+	while (cursor < end)
+	{
+		const char *run = cursor;
+		cursor			= k_devjson_protocol_scan_escape(cursor, end);
+		k_devjson_protocol_writer_put(writer, run, (size_t)(cursor - run));
+		if (cursor < end)
+		{
+			const unsigned char character = (unsigned char)*cursor++;
+			char				escape[7] = {'\\', 0};
+			switch (character)
+			{
+				case '"':
+				case '\\':
+					escape[1] = (char)character;
+					break;
+				case '\b':
+					escape[1] = 'b';
+					break;
+				case '\f':
+					escape[1] = 'f';
+					break;
+				case '\n':
+					escape[1] = 'n';
+					break;
+				case '\r':
+					escape[1] = 'r';
+					break;
+				case '\t':
+					escape[1] = 't';
+					break;
+				default:
+					snprintf(escape, sizeof(escape), "\\u%04x", character);
+					break;
+			}
+			k_devjson_protocol_writer_put(writer, escape, escape[1] == 'u' ? 6 : 2);
+		}
+	}
+	k_devjson_protocol_writer_put(writer, "\"", 1);
+}
+
+static void k_devjson_protocol_writer_integer(k_devjson_protocol_writer_t *writer, const int number)
+{
+	char		 buffer[K_DEVJSON_PROTOCOL_WRITER_INTEGER_SIZE];
+	char		*digits	   = buffer + sizeof(buffer);
+	unsigned int magnitude = number < 0 ? 0U - (unsigned int)number : (unsigned int)number;	 //!< INT_MIN has no positive int
+	do
+	{
+		*--digits = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	if (number < 0)
+	{
+		*--digits = '-';
+	}
+	k_devjson_protocol_writer_put(writer, digits, (size_t)(buffer + sizeof(buffer) - digits));
+}
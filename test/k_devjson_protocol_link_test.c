@@ -0,0 +1,39 @@
+/**
+ * @file k_devjson_protocol_link_test.c
+ * @brief Plain C program linked against the library
+ *
+ * The gtest targets link the C++ runtime, which pulls in system libraries the library may need without naming them.
+ * This program is linked by the C driver only, so a missing link dependency fails the build.
+ */
+
+#include "k_devjson_protocol.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void k_devjson_protocol_link_test_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type)
+	{
+		k_devjson_protocol_add_fixed_response(cb_arg->output_json, cb_arg->key, 21.5f, 2);
+	}
+}
+
+int main(void)
+{
+	const char				   *request	 = "{\"req\":{\"get\": [\"setpoint\"]}}";
+	const char				   *response = "{\"res\":{\"get\":{\"setpoint\":21.50}}}";
+	char						output_string[128];
+	k_devjson_protocol_output_t output	 = {output_string, sizeof(output_string), NULL, NULL, 0, NULL};
+	k_devjson_protocol_ctx_t	ctx;
+	int							result	 = 0;
+
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_link_test_callback, NULL);
+	if ((K_DEVJSON_PROTOCOL_PARSE_SUCCESS != k_devjson_protocol_ctx_parse(&ctx, request, strlen(request), &output)) ||
+		(0 != strcmp(output_string, response)))
+	{
+		fprintf(stderr, "Unexpected response: %s\n", output_string);
+		result = 1;
+	}
+	return result;
+}
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include "cJSON.h"
+#include "k_devjson_protocol.h"
+#include "k_devjson_protocol_executor.h"
+#include "k_devjson_protocol_priv.h"
+
+static size_t k_devjson_protocol_test_malloc_count = 0;
+
+extern "C"
+{
+	void *__real_malloc(size_t size);
+	void *__real_calloc(size_t count, size_t size);
+	void *__real_realloc(void *pointer, size_t size);
+
+	void *__wrap_malloc(size_t size)
+	{
+		k_devjson_protocol_test_malloc_count++;
+		return __real_malloc(size);
+	}
+
+	void *__wrap_calloc(size_t count, size_t size)
+	{
+		k_devjson_protocol_test_malloc_count++;
+		return __real_calloc(count, size);
+	}
+
+	void *__wrap_realloc(void *pointer, size_t size)
+	{
+		k_devjson_protocol_test_malloc_count++;
+		return __real_realloc(pointer, size);
+	}
+}
+
+static void k_devjson_protocol_test_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	switch (cb_arg->group_type)
+	{
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_GET:
+			k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.int_value = 42},
+											K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+			break;
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_SET:
+			k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, cb_arg->input_value, cb_arg->input_value_type);
+			break;
+		case K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD:
+			k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key,
+											(k_devjson_protocol_value_t){.bool_value = K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON == cb_arg->input_value_type},
+											K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL);
+			break;
+		default:
+			break;
+	}
+}
+
+TEST(KDevJsonProtocolStaticPool, ParseWithoutHeap)
+{
+	const char *json_string = R"({"id": 123, "req":{"get": ["key1", "key2"], "set": {"key1": "value1"}, "cmd": {"c5":{"key1":2}}}})";
+	char		output_string[256];
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_callback);
+	k_devjson_protocol_test_malloc_count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_EQ(k_devjson_protocol_parse(json_string, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":42,"key2":42},"set":{"key1":"value1"},"cmd":{"c5":true}}})");
+	}
+	EXPECT_EQ(k_devjson_protocol_test_malloc_count, 0u);
+}
+
+TEST(KDevJsonProtocolStaticPool, DomParseWithoutHeap)
+{
+	const char				   *json_string	= R"({"req":{"get": ["key1"], "cmd": {"c5":{"key1":2}}}})";
+	char						output_string[256];
+	k_devjson_protocol_output_t	output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_callback);
+	k_devjson_protocol_alloc_init();
+	k_devjson_protocol_test_malloc_count = 0;
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"key1":42},"cmd":{"c5":true}}})");
+	EXPECT_EQ(k_devjson_protocol_test_malloc_count, 0u);
+}
+
+TEST(KDevJsonProtocolStaticPool, ParserFedInChunksWithoutHeap)
+{
+	const char					json_string[] = R"({"id": 123, "req":{"set": {"key1": "value1"}, "cmd": {"c5":{"key1":2}}}})";
+	char						output_string[256];
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_callback);
+	k_devjson_protocol_test_malloc_count = 0;
+	k_devjson_protocol_parser_init(&parser, output_string, sizeof(output_string));
+	k_devjson_protocol_parse_status_t status = K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE;
+	for (size_t offset = 0; offset < sizeof(json_string) - 1 && K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE == status; offset += 5)
+	{
+		size_t length = sizeof(json_string) - 1 - offset < 5 ? sizeof(json_string) - 1 - offset : 5;
+		status		  = k_devjson_protocol_parser_feed(&parser, json_string + offset, length, NULL);
+	}
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"set":{"key1":"value1"},"cmd":{"c5":true}}})");
+	EXPECT_EQ(k_devjson_protocol_test_malloc_count, 0u);
+}
+
+TEST(KDevJsonProtocolStaticPool, StringTooLarge)
+{
+	const std::string json_string = R"({"req":{"set": {"key1": ")" + std::string(K_DEVJSON_PROTOCOL_PARSER_VALUE_SIZE, 'a') + R"("}}})";
+	char			  output_string[256];
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_callback);
+	k_devjson_protocol_test_malloc_count = 0;
+	EXPECT_EQ(k_devjson_protocol_parse(json_string.c_str(), output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_TOO_LARGE);
+	EXPECT_STREQ(output_string, "{}");
+
+	/* A cmd JSON value split across chunks that does not fit in the capture buffer */
+	const std::string			cmd_string = R"({"req":{"cmd": {"c1": {"k": ")" + std::string(K_DEVJSON_PROTOCOL_PARSER_CAPTURE_SIZE, 'a') + R"("}}}})";
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_parser_init(&parser, output_string, sizeof(output_string));
+	k_devjson_protocol_parse_status_t status = K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE;
+	for (size_t offset = 0; offset < cmd_string.size() && K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE == status; offset += 64)
+	{
+		status = k_devjson_protocol_parser_feed(&parser, cmd_string.data() + offset, std::min<size_t>(64, cmd_string.size() - offset), NULL);
+	}
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_TOO_LARGE);
+	EXPECT_EQ(k_devjson_protocol_test_malloc_count, 0u);
+}
+
+TEST(KDevJsonProtocolStaticPool, PoolExhausted)
+{
+	const char *json_string =
+		R"({"req":{"cmd": {"c1": {"k1": "v1", "k2": "v2", "k3": "v3", "k4": "v4", "k5": "v5", "k6": "v6", "k7": "v7", "k8": "v8", "k9": "v9", "k10": "v10"}}}})";
+	char						output_string[256];
+	k_devjson_protocol_output_t	output = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_callback);
+	k_devjson_protocol_test_malloc_count = 0;
+	EXPECT_EQ(k_devjson_protocol_parse(json_string, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_OUT_OF_MEMORY);
+	EXPECT_STREQ(output_string, "{}");
+	k_devjson_protocol_alloc_init();
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string, strlen(json_string), &output),
+			  K_DEVJSON_PROTOCOL_PARSE_OUT_OF_MEMORY);
+	EXPECT_STREQ(output_string, "{}");
+	EXPECT_EQ(k_devjson_protocol_test_malloc_count, 0u);
+
+	/* Every block is given back: the next request is served */
+	EXPECT_EQ(k_devjson_protocol_parse(R"({"req":{"set": {"k1": "v1"}}})", output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"set":{"k1":"v1"}}})");
+}
+
+TEST(KDevJsonProtocolStaticPool, ExecutorUnavailable)
+{
+	k_devjson_protocol_ctx_t	  ctx;
+	k_devjson_protocol_worker_t	  workers[2];
+	k_devjson_protocol_executor_t executor;
+	k_devjson_protocol_job_t	  job = {0};
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_callback, NULL);
+	ASSERT_EQ(k_devjson_protocol_executor_init(&executor, &ctx, workers, NULL, 2), 0);
+	EXPECT_EQ(k_devjson_protocol_executor_start(&executor), -1);
+	EXPECT_EQ(k_devjson_protocol_executor_submit(&executor, &job), -1);
+	k_devjson_protocol_executor_stop(&executor);
+}
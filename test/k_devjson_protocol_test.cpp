@@ -2,7 +2,13 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "cJSON.h"
+#include "k_devjson_protocol_executor.h"
 #include "k_devjson_protocol_priv.h"
 
 const char *k_devjson_protocol_test_key1_value		 = "test1";
@@ -300,4 +306,1878 @@ TEST(KDevJsonProtocol, ParseSuccessWithNoID)
 	k_devjson_protocol_parse_status_t status = k_devjson_protocol_parse(json_string.c_str(), output_string, sizeof(output_string));
 	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
 	EXPECT_STREQ(output_string, R"({"res":{"get":{"key1":"test1","key2":"test2"},"set":{"key1":"value1"},"cmd":{"c1":true,"c5":false}}})");
-}
\ No newline at end of file
+}
+TEST(KDevJsonProtocol, SaxMatchesDom)
+{
+	const char *requests[] = {
+		R"({"id": 123, "req":{"get": ["key1", "key2"], "set": {"key1": "value1"}, "cmd": {"c1": true, "c5":{"key1":2}}}})",
+		R"({"req":{"get": "all"}})",
+		R"({"req":{"get": ["key3", "key4"], "set": {"key1": "v\"a\\lè\u00e8\ud83d\ude00", "key3": 100, "key4": 2.5, "key5": null, "key6": [1]}}})",
+		R"({"id": 123, "extra": {"req": [1, 2, {"get": "all"}]}, "req": {"cmd": {"c2": {"ssid": "a}b", "password": "{["}, "c3": [true]}}})",
+		R"({"id": 12, "req":{"get": ["key1"]}})",
+		R"({"id": 123})",
+		R"({"id": 123, "req": 5})",
+		R"({"ID": 12, "Req": {"get": ["key1"]}, "req": {"GET": ["key2"], "set": {"key1": "value1"}}})",
+		R"({"id": 123, "req":{"get": ["key1"]})",
+		R"({"id": 123, "req":{"get": ["key1",]}})",
+		R"({"id": 123, "req":{"set": {"key1": tru}}})",
+		R"("req")",
+		R"(   )",
+	};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	for (const char *request : requests)
+	{
+		char						sax_output[1024];
+		char						dom_output[1024];
+		k_devjson_protocol_output_t sax = {sax_output, sizeof(sax_output), NULL, NULL, 0};
+		k_devjson_protocol_output_t dom = {dom_output, sizeof(dom_output), NULL, NULL, 0};
+		EXPECT_EQ(k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, request, strlen(request), &sax),
+				  k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, request, strlen(request), &dom))
+			<< request;
+		EXPECT_STREQ(sax_output, dom_output) << request;
+	}
+}
+
+TEST(KDevJsonProtocol, SaxIDAfterRequest)
+{
+	std::string						  json_string = R"({"req":{"get": ["key1"], "set": {"key2": "value2"}}, "id": 123})";
+	char							  output_string[1024];
+	k_devjson_protocol_output_t		  output	  = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_parse_status_t status;
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	status = k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, json_string.c_str(), json_string.size(), &output);
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1"},"set":{"key2":"value2"}}})");
+}
+
+static int k_devjson_protocol_test_dispatch_count = 0;
+
+static void k_devjson_protocol_test_counting_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (K_DEVJSON_PROTOCOL_GROUP_TYPE_ID != cb_arg->group_type)
+	{
+		k_devjson_protocol_test_dispatch_count++;
+	}
+	k_devjson_protocol_callback(cb_arg);
+}
+
+TEST(KDevJsonProtocol, SaxWrongIDAfterRequestDispatchesNothing)
+{
+	std::string					json_string = R"({"req":{"set": {"key1": "value1"}, "cmd": {"c1": true}}, "id": 12})";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_counting_callback, NULL);
+	k_devjson_protocol_test_dispatch_count = 0;
+	k_devjson_protocol_parse_status_t status = k_devjson_protocol_parse_sax(&ctx, json_string.c_str(), json_string.size(), &output);
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 0);
+	EXPECT_STREQ(output_string, "{}");
+}
+
+static std::string k_devjson_protocol_test_order;
+
+static void k_devjson_protocol_test_order_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (K_DEVJSON_PROTOCOL_GROUP_TYPE_ID != cb_arg->group_type)
+	{
+		k_devjson_protocol_test_order += std::to_string(cb_arg->group_type) + ":" + (cb_arg->key ? cb_arg->key : "") + " ";
+	}
+	k_devjson_protocol_callback(cb_arg);
+}
+
+TEST(KDevJsonProtocol, GroupOrder)
+{
+	const char *requests[] = {
+		R"({"id": 123, "req":{"set": {"key1": "value1"}, "get": ["key1"]}})",
+		R"({"req":{"cmd": {"c1": true}, "set": {"key1": "value1"}, "get": ["key1", "key3"]}})",
+		R"({"req":{"cmd": {"c5": {"key1": 2}}, "x": [1, {"get": 2}], "get": "all", "set": {"key2": "v", "key3": 7}}, "id": 123})",
+		R"({"req":{"get": ["key1"], "cmd": {"c1": true}, "set": {"key1": "value1"}}})",
+		R"({"req":{"set": {"key1": "value1"}, "cmd": {"c1": true}}})",
+		R"({"req":{"cmd": {"c1": true}, "get": ["key1"], "cmd": {"c5": {"key1": 2}}}})",
+	};
+	const k_devjson_protocol_engine_t engines[] = {K_DEVJSON_PROTOCOL_ENGINE_DOM, K_DEVJSON_PROTOCOL_ENGINE_STREAMING};
+	k_devjson_protocol_ctx_t		  ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_order_callback, NULL);
+
+	/* Both engines run the handlers and write the response in the get, set, cmd order, whatever the order of the request */
+	for (const char *request : requests)
+	{
+		std::string orders[2];
+		std::string responses[2];
+		for (size_t i = 0; i < 2; i++)
+		{
+			char						output_string[1024];
+			k_devjson_protocol_output_t output = {output_string, sizeof(output_string), NULL, NULL, 0};
+			ctx.config.engine				   = engines[i];
+			k_devjson_protocol_test_order.clear();
+			EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, request, strlen(request), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS) << request;
+			orders[i]	 = k_devjson_protocol_test_order;
+			responses[i] = output_string;
+		}
+		EXPECT_EQ(orders[1], orders[0]) << request;
+		EXPECT_EQ(responses[1], responses[0]) << request;
+	}
+}
+
+TEST(KDevJsonProtocol, PeekId)
+{
+	int id = 0;
+	EXPECT_EQ(k_devjson_protocol_peek_id(R"({"id": 123, "req":{}})", 21, &id), K_DEVJSON_PROTOCOL_PEEK_FOUND);
+	EXPECT_EQ(id, 123);
+	std::string json_string = R"( {"req":{"set": {"k": "a}\"b", "l": [1, {"id": 5}]}}, "x": true, "id": -7})";
+	EXPECT_EQ(k_devjson_protocol_peek_id(json_string.c_str(), json_string.size(), &id), K_DEVJSON_PROTOCOL_PEEK_FOUND);
+	EXPECT_EQ(id, -7);
+	json_string = R"({"id": 1e3})";
+	EXPECT_EQ(k_devjson_protocol_peek_id(json_string.c_str(), json_string.size(), &id), K_DEVJSON_PROTOCOL_PEEK_FOUND);
+	EXPECT_EQ(id, 1000);
+
+	/* Known to have no ID: the request is dispatched as it is read */
+	const char *absent[] = {R"({"req":{"get": ["key1"], "id": 5}})", R"( { } )", R"({"x": [{"id": 1}], "req": {}} trailing)"};
+	for (const char *request : absent)
+	{
+		id = -1;
+		EXPECT_EQ(k_devjson_protocol_peek_id(request, strlen(request), &id), K_DEVJSON_PROTOCOL_PEEK_ABSENT) << request;
+		EXPECT_EQ(id, -1) << request;
+	}
+
+	/* Left to the engine */
+	const char *requests[] = {R"({"id": "123"})", R"({"id": 12)", R"([{"id": 12}])", R"({"req": {"get": ["a"])", R"({"id": 1x})", R"({"i\u0064": 12})"};
+	for (const char *request : requests)
+	{
+		EXPECT_EQ(k_devjson_protocol_peek_id(request, strlen(request), &id), K_DEVJSON_PROTOCOL_PEEK_UNKNOWN) << request;
+	}
+}
+
+TEST(KDevJsonProtocol, SaxEscapedIDKey)
+{
+	std::string					json_string = R"({"req":{"set": {"key1": "value1"}}, "i\u0064": 12})";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_counting_callback, NULL);
+	k_devjson_protocol_test_dispatch_count = 0;
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 0);
+}
+
+TEST(KDevJsonProtocol, SaxNoIDDispatchedWhileRead)
+{
+	std::string					json_string = R"({"req":{"set": {"key1": "value1"}, "cmd": {"c1": true}}, "x": 1})";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_counting_callback, NULL);
+	k_devjson_protocol_test_dispatch_count = 0;
+	k_devjson_protocol_ctx_parser_init(&ctx, &parser, &output);
+	k_devjson_protocol_parser_contiguous(&parser, json_string.c_str(), json_string.size());
+	EXPECT_EQ(k_devjson_protocol_parser_scan(&parser, json_string.c_str(), json_string.size()), json_string.size());
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 2);  //!< Not skipped to be replayed at the end
+	EXPECT_EQ(k_devjson_protocol_parser_finish(&parser), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 2);
+	EXPECT_STREQ(output_string, R"({"res":{"set":{"key1":"value1"},"cmd":{"c1":true}}})");
+}
+
+TEST(KDevJsonProtocol, WrongIDRejectedBeforeBody)
+{
+	std::string					json_string = R"({"id": 12, "req":{"set": {"key1": "value1"}, "cmd": {"c1": tru)";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_counting_callback, NULL);
+	k_devjson_protocol_test_dispatch_count = 0;
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_STREQ(output_string, "{}");
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_STREQ(output_string, "{}");
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 0);
+
+	/* The body of a request for this device is still checked */
+	json_string = R"({"id": 123, "req":{"set": {"key1": "value1"}, "cmd": {"c1": tru)";
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+}
+
+TEST(KDevJsonProtocol, ParseLengthDelimitedBuffer)
+{
+	/* Receive buffer holding a request followed by the start of the next frame, without terminator */
+	std::string					frame	  = R"({"id": 123, "req":{"get": ["key1"]}})";
+	std::string					rx_buffer = frame + R"({"id": 123, "req":{"get": ["key2"]}})";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output	  = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	k_devjson_protocol_parse_status_t status = k_devjson_protocol_parse_n(rx_buffer.data(), frame.size(), output_string, sizeof(output_string));
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1"}}})");
+	status = k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, rx_buffer.data(), frame.size(), &output);
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1"}}})");
+}
+
+TEST(KDevJsonProtocol, ParseLengthDelimitedTruncated)
+{
+	std::string					frame  = R"({"id": 123, "req":{"get": ["key1"]}})";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	EXPECT_EQ(k_devjson_protocol_parse_n(frame.data(), frame.size() - 1, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, frame.data(), frame.size() - 1, &output), K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+	EXPECT_EQ(k_devjson_protocol_parse_n(frame.data(), 0, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+}
+
+static k_devjson_protocol_parse_status_t k_devjson_protocol_test_feed_in_chunks(const std::string &request, size_t chunk_size, char *output_string,
+																				size_t output_string_size)
+{
+	k_devjson_protocol_parser_t		  parser;
+	k_devjson_protocol_parse_status_t status = K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE;
+	k_devjson_protocol_parser_init(&parser, output_string, output_string_size);
+	for (size_t offset = 0; (offset < request.size()) && (K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE == status); offset += chunk_size)
+	{
+		status = k_devjson_protocol_parser_feed(&parser, request.data() + offset, std::min(chunk_size, request.size() - offset), NULL);
+	}
+	if (K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE == status)
+	{
+		status = k_devjson_protocol_parser_finish(&parser);
+	}
+	return status;
+}
+
+TEST(KDevJsonProtocol, ParserFedInChunks)
+{
+	std::string json_string =
+		R"({"id": 123, "req":{"get": ["key1", "key4"], "set": {"key2": "v\"aèl"}, "cmd": {"c1": true, "c2": {"ssid":"a}", "password": "\"{"}, "c3": 1.5}}})";
+	char one_shot_output[1024];
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	ASSERT_EQ(k_devjson_protocol_parse(json_string.c_str(), one_shot_output, sizeof(one_shot_output)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(one_shot_output, R"({"id":123,"res":{"get":{"key1":"test1","key4":2.5},"set":{"key2":"v\"aèl"},"cmd":{"c1":true,"c2":true,"c3":false}}})");
+	for (size_t chunk_size = 1; chunk_size <= json_string.size(); chunk_size++)
+	{
+		char output_string[1024];
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(json_string, chunk_size, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS)
+			<< chunk_size;
+		EXPECT_STREQ(output_string, one_shot_output) << chunk_size;
+	}
+}
+
+TEST(KDevJsonProtocol, ParserDispatchesBeforeRequestIsComplete)
+{
+	std::string					first_chunk	 = R"({"id": 123, "req":{"set": {"key1": "value1", "key2": "val)";
+	std::string					second_chunk = R"(ue2"}}}{"id": 123)";
+	char						output_string[1024];
+	size_t						consumed	 = 0;
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_counting_callback);
+	k_devjson_protocol_test_dispatch_count = 0;
+	k_devjson_protocol_parser_init(&parser, output_string, sizeof(output_string));
+	EXPECT_EQ(k_devjson_protocol_parser_feed(&parser, first_chunk.data(), first_chunk.size(), &consumed), K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE);
+	EXPECT_EQ(consumed, first_chunk.size());
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 1);
+	EXPECT_EQ(k_devjson_protocol_parser_feed(&parser, second_chunk.data(), second_chunk.size(), &consumed), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(consumed, second_chunk.find('{'));  //!< The next request is not consumed
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 2);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"set":{"key1":"value1","key2":"value2"}}})");
+}
+
+TEST(KDevJsonProtocol, ParserHoldsRequestUntilID)
+{
+	const std::string			request	   = R"({"req":{"set": {"key1": "value1"}, "cmd": {"c1": true, "c5": {"key1": 2}}}, "id": 123})";
+	const std::string			wrong_id   = R"({"req":{"set": {"key1": "value1"}, "cmd": {"c1": true, "c5": {"key1": 2}}}, "id": 12})";
+	const std::string			without_id = R"({"req":{"set": {"key1": "value1"}}})";
+	char						output_string[1024];
+	char						expected[1024];
+	k_devjson_protocol_output_t output	   = {expected, sizeof(expected), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_counting_callback);
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, request.c_str(), request.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+
+	/* Nothing is dispatched before the ID is known, wherever the chunks are cut */
+	for (size_t chunk_size : {(size_t)1, (size_t)7, (size_t)64})
+	{
+		k_devjson_protocol_test_dispatch_count = 0;
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(wrong_id, chunk_size, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+		EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 0);
+		EXPECT_STREQ(output_string, "{}");
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(request, chunk_size, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 3);
+		EXPECT_STREQ(output_string, expected);
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(without_id, chunk_size, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"set":{"key1":"value1"}}})");
+	}
+}
+
+TEST(KDevJsonProtocol, RepeatedMembers)
+{
+	const char *requests[] = {
+		R"({"req":{"get": ["key1"]}, "req":{"get": ["key2"]}})",
+		R"({"req":{"get": ["key1"], "get": ["key2"], "set": {"key1": "value1"}, "set": {"key1": "value2"}, "cmd": {"c1": true}, "cmd": {"c1": false}}})",
+		R"({"req":{"get": ["key1"]}, "id": 123, "id": 12})",
+		R"({"id": 123, "id": 12, "req":{"get": ["key1"]}, "req": 1})",
+		R"({"req": 1, "req":{"get": ["key1"]}})",
+	};
+	const size_t chunk_sizes[] = {1, 7};
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_order_callback);
+
+	/* Only the first member of each key is used, as cJSON_GetObjectItem does: the handlers run once per entry */
+	for (const char *request : requests)
+	{
+		char						dom_output[1024];
+		k_devjson_protocol_output_t output = {dom_output, sizeof(dom_output), NULL, NULL, 0};
+		k_devjson_protocol_test_order.clear();
+		const k_devjson_protocol_parse_status_t status = k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, request, strlen(request), &output);
+		const std::string						order  = k_devjson_protocol_test_order;
+
+		char output_string[1024];
+		k_devjson_protocol_test_order.clear();
+		EXPECT_EQ(k_devjson_protocol_parse(request, output_string, sizeof(output_string)), status) << request;
+		EXPECT_EQ(k_devjson_protocol_test_order, order) << request;
+		EXPECT_STREQ(output_string, dom_output) << request;
+		for (const size_t chunk_size : chunk_sizes)
+		{
+			k_devjson_protocol_test_order.clear();
+			EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(request, chunk_size, output_string, sizeof(output_string)), status) << request;
+			EXPECT_EQ(k_devjson_protocol_test_order, order) << request << " in chunks of " << chunk_size;
+			EXPECT_STREQ(output_string, dom_output) << request << " in chunks of " << chunk_size;
+		}
+	}
+}
+
+TEST(KDevJsonProtocol, ParserTruncatedRequest)
+{
+	std::string json_string = R"({"id": 123, "req":{"cmd": {"c2": {"ssid":"test_ssid")";
+	char		output_string[1024];
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(json_string, 7, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+	EXPECT_STREQ(output_string, "{}");
+}
+
+TEST(KDevJsonProtocol, SaxLongStrings)
+{
+	const std::string value		 = std::string(4 * K_DEVJSON_PROTOCOL_PARSER_VALUE_SIZE, 'a') + "\\u00e8" + std::string(300, 'b');
+	const std::string key		 = std::string(2 * K_DEVJSON_PROTOCOL_PARSER_KEY_SIZE, 'k');
+	const std::string requests[] = {
+		R"({"id": 123, "req":{"set": {"key1": ")" + value + R"("}}})",
+		R"({"id": 123, "req":{"get": [")" + key + R"(", "key1"], "set": {")" + key + R"(": "v", "key1": ")" + value + R"("}}})",
+	};
+	std::vector<char> sax_output(8192);
+	std::vector<char> dom_output(8192);
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	for (const std::string &request : requests)
+	{
+		k_devjson_protocol_output_t sax = {sax_output.data(), sax_output.size(), NULL, NULL, 0};
+		k_devjson_protocol_output_t dom = {dom_output.data(), dom_output.size(), NULL, NULL, 0};
+		EXPECT_EQ(k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, request.c_str(), request.size(), &sax), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, request.c_str(), request.size(), &dom), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(sax_output.data(), dom_output.data());
+		EXPECT_NE(strstr(sax_output.data(), "aaaaè"), nullptr);
+
+		/* Strings that outgrow the parser buffers over several chunks */
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(request, 7, sax_output.data(), sax_output.size()), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(sax_output.data(), dom_output.data());
+	}
+}
+
+TEST(KDevJsonProtocol, ParserLongCmdInChunks)
+{
+	/* A cmd JSON value larger than the capture buffer, split across many chunks */
+	std::string json_string = R"({"id": 123, "req":{"cmd": {"c1": {"ssid": "a", "list": [)";
+	for (size_t i = 0; i < K_DEVJSON_PROTOCOL_PARSER_CAPTURE_SIZE / 4; i++)
+	{
+		json_string += i ? ", \"item\"" : "\"item\"";
+	}
+	json_string += R"(]}, "c2": {"key1": 2}}}})";
+	char						output_string[1024];
+	char						expected[1024];
+	k_devjson_protocol_output_t output = {expected, sizeof(expected), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	ASSERT_GT(json_string.size(), 2 * (size_t)K_DEVJSON_PROTOCOL_PARSER_CAPTURE_SIZE);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(json_string, 64, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, expected);
+}
+
+TEST(KDevJsonProtocol, SaxDeepNesting)
+{
+	/* The envelope, req and cmd objects open 3 levels: the deepest value still accepted by cJSON, and one level more */
+	const size_t depths[] = {40, K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH - 3, K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH - 2};
+	std::vector<char> sax_output(1024);
+	std::vector<char> dom_output(1024);
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	for (size_t depth : depths)
+	{
+		std::string request = R"({"id": 123, "req":{"cmd": {"c1": )";
+		for (size_t i = 0; i < depth; i++)
+		{
+			request += i % 2 ? "[" : R"({"a":)";
+		}
+		request += "1";
+		for (size_t i = depth; i > 0; i--)
+		{
+			request += (i - 1) % 2 ? "]" : "}";
+		}
+		request += "}}}";
+		k_devjson_protocol_output_t		  sax	 = {sax_output.data(), sax_output.size(), NULL, NULL, 0};
+		k_devjson_protocol_output_t		  dom	 = {dom_output.data(), dom_output.size(), NULL, NULL, 0};
+		k_devjson_protocol_parse_status_t status = k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, request.c_str(), request.size(), &sax);
+		EXPECT_EQ(status, depth + 3 <= K_DEVJSON_PROTOCOL_PARSER_MAX_DEPTH ? K_DEVJSON_PROTOCOL_PARSE_SUCCESS : K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON) << depth;
+		EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, request.c_str(), request.size(), &dom), status) << depth;
+		EXPECT_STREQ(sax_output.data(), dom_output.data()) << depth;
+	}
+}
+
+TEST(KDevJsonProtocol, ParseWithArena)
+{
+	std::string						json_string = R"({"id": 123, "req":{"get": ["key1", "key2"], "set": {"key1": "value1"}, "cmd": {"c1": true, "c5":{"key1":2}}}})";
+	alignas(8) static unsigned char arena_buffer[8192];
+	k_devjson_protocol_arena_t		arena;
+	char							output_string[1024];
+	k_devjson_protocol_output_t		output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	k_devjson_protocol_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+	k_devjson_protocol_set_arena(&arena);
+	EXPECT_EQ(k_devjson_protocol_parse(json_string.c_str(), output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1","key2":"test2"},"set":{"key1":"value1"},"cmd":{"c1":true,"c5":false}}})");
+	EXPECT_GT(arena.peak, 0u);
+	EXPECT_EQ(arena.used, 0u);	//!< Rewound when the parse returns
+	EXPECT_EQ(arena.fallbacks, 0u);
+
+	size_t arena_mark = k_devjson_protocol_arena_enter();
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string.c_str(), json_string.size(), &output),
+			  K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	k_devjson_protocol_arena_leave(arena_mark);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1","key2":"test2"},"set":{"key1":"value1"},"cmd":{"c1":true,"c5":false}}})");
+	EXPECT_EQ(arena.used, 0u);
+	EXPECT_EQ(arena.fallbacks, 0u);
+	k_devjson_protocol_set_arena(NULL);
+}
+
+TEST(KDevJsonProtocol, ParseWithArenaTooSmall)
+{
+	std::string				   json_string = R"({"id": 123, "req":{"cmd": {"c2": {"ssid": "test_ssid", "password": "test_password", "channel": 6}}}})";
+	unsigned char			   arena_buffer[128];
+	k_devjson_protocol_arena_t arena;
+	char					   output_string[1024];
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	k_devjson_protocol_arena_init(&arena, arena_buffer + 1, sizeof(arena_buffer) - 1);	//!< Misaligned on purpose
+	k_devjson_protocol_set_arena(&arena);
+	EXPECT_EQ(k_devjson_protocol_parse(json_string.c_str(), output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"cmd":{"c2":true}}})");
+	EXPECT_GT(arena.fallbacks, 0u);	 //!< Served by the heap once the region is full
+	EXPECT_EQ(arena.used, 0u);
+	k_devjson_protocol_set_arena(NULL);
+}
+
+static cJSON *k_devjson_protocol_test_kept_json = NULL;
+
+static void k_devjson_protocol_test_keeping_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD == cb_arg->group_type) && (K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON == cb_arg->input_value_type))
+	{
+		/* Kept after the parse, e.g. handed to another task */
+		k_devjson_protocol_test_kept_json = cJSON_Duplicate(cb_arg->input_value.json_value, 1);
+		cJSON_AddStringToObject(cb_arg->output_json, cb_arg->key, "queued");
+	}
+	else
+	{
+		k_devjson_protocol_callback(cb_arg);
+	}
+}
+
+TEST(KDevJsonProtocol, ParseWithArenaHandlerAllocations)
+{
+	std::string						json_string = R"({"id": 123, "req":{"cmd": {"c2": {"ssid": "test_ssid", "password": "test_password"}}}})";
+	alignas(8) static unsigned char arena_buffer[8192];
+	k_devjson_protocol_arena_t		arena;
+	k_devjson_protocol_ctx_t		ctx;
+	char							output_string[1024];
+	k_devjson_protocol_output_t		output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_keeping_callback, NULL);
+	k_devjson_protocol_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+	k_devjson_protocol_ctx_set_arena(&ctx, &arena);
+	for (k_devjson_protocol_engine_t engine : {K_DEVJSON_PROTOCOL_ENGINE_STREAMING, K_DEVJSON_PROTOCOL_ENGINE_DOM})
+	{
+		ctx.config.engine = engine;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"id":123,"res":{"cmd":{"c2":"queued"}}})");
+		EXPECT_GT(arena.peak, 0u);
+		EXPECT_EQ(arena.used, 0u);
+
+		/* What the handler allocated comes from the heap: the next parse reuses the arena without touching it */
+		ASSERT_NE(k_devjson_protocol_test_kept_json, nullptr);
+		EXPECT_FALSE(((unsigned char *)k_devjson_protocol_test_kept_json >= arena_buffer) &&
+					 ((unsigned char *)k_devjson_protocol_test_kept_json < arena_buffer + sizeof(arena_buffer)));
+		memset(arena_buffer, 0xA5, sizeof(arena_buffer));
+		EXPECT_STREQ(cJSON_GetStringValue(cJSON_GetObjectItem(k_devjson_protocol_test_kept_json, "ssid")), "test_ssid");
+		cJSON_Delete(k_devjson_protocol_test_kept_json);
+		k_devjson_protocol_test_kept_json = NULL;
+	}
+}
+
+TEST(KDevJsonProtocol, WriterMatchesCJSON)
+{
+	const char				   *strings[]	= {"plain", "quote \" backslash \\ slash /", "control \b\f\n\r\t\x01\x1f", "utf-8 \xc3\xa9\xe2\x82\xac", ""};
+	const float					floats[]	= {2.5f, 0.1f, -3.0f, 1e30f, 3e9f, 1.17549435e-38f};
+	char						expected[1024];
+	char						output_string[1024];
+	cJSON					   *output_json = cJSON_CreateObject();
+	k_devjson_protocol_writer_t writer;
+	k_devjson_protocol_writer_init(&writer, output_string, sizeof(output_string));
+	k_devjson_protocol_writer_begin_object(&writer, NULL);
+	for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+	{
+		std::string key = "s" + std::to_string(i);
+		k_devjson_protocol_add_response(output_json, key.c_str(), (k_devjson_protocol_value_t){.string_value = (char *)strings[i]},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+		k_devjson_protocol_add_response(&writer.items, key.c_str(), (k_devjson_protocol_value_t){.string_value = (char *)strings[i]},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+	}
+	for (size_t i = 0; i < sizeof(floats) / sizeof(floats[0]); i++)
+	{
+		std::string key = "f" + std::to_string(i);
+		k_devjson_protocol_add_response(output_json, key.c_str(), (k_devjson_protocol_value_t){.float_value = floats[i]},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT);
+		k_devjson_protocol_add_response(&writer.items, key.c_str(), (k_devjson_protocol_value_t){.float_value = floats[i]},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT);
+	}
+	const int integers[] = {0, -1, 42, 2147483647, -2147483647 - 1};
+	for (size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); i++)
+	{
+		std::string key = "i" + std::to_string(i);
+		k_devjson_protocol_add_response(output_json, key.c_str(), (k_devjson_protocol_value_t){.int_value = integers[i]},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+		k_devjson_protocol_add_response(&writer.items, key.c_str(), (k_devjson_protocol_value_t){.int_value = integers[i]},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+	}
+	k_devjson_protocol_add_response(output_json, "b", (k_devjson_protocol_value_t){.bool_value = 1}, K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL);
+	k_devjson_protocol_add_response(&writer.items, "b", (k_devjson_protocol_value_t){.bool_value = 1}, K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL);
+	k_devjson_protocol_add_response(output_json, "n", (k_devjson_protocol_value_t){0}, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN);
+	k_devjson_protocol_add_response(&writer.items, "n", (k_devjson_protocol_value_t){0}, K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN);
+	k_devjson_protocol_add_response(output_json, "null string", (k_devjson_protocol_value_t){0}, K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+	k_devjson_protocol_add_response(&writer.items, "null string", (k_devjson_protocol_value_t){0}, K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+	cJSON *nested = cJSON_AddObjectToObject(output_json, "nested");
+	cJSON_AddNumberToObject(nested, "x", 1.5);
+	k_devjson_protocol_writer_add_json(&writer, "nested", nested);
+
+	EXPECT_TRUE(cJSON_PrintPreallocated(output_json, expected, sizeof(expected), 0));
+	EXPECT_LT(k_devjson_protocol_writer_finish(&writer), sizeof(output_string));
+	EXPECT_STREQ(output_string, expected);
+	cJSON_Delete(output_json);
+}
+
+static void k_devjson_protocol_test_cjson_api_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type)
+	{
+		/* Mix of cJSON items, appended after the callback, and members written straight away */
+		cJSON *info = cJSON_AddObjectToObject(cb_arg->output_json, cb_arg->key);
+		cJSON_AddStringToObject(info, "fw", "1.0");
+		k_devjson_protocol_writer_begin_object(cb_arg->writer, "direct");
+		k_devjson_protocol_writer_add(cb_arg->writer, "v", (k_devjson_protocol_value_t){.int_value = 7}, K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+		k_devjson_protocol_writer_end_object(cb_arg->writer);
+	}
+}
+
+TEST(KDevJsonProtocol, CallbackUsingCJSONApi)
+{
+	char output_string[256];
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_cjson_api_callback);
+	EXPECT_EQ(k_devjson_protocol_parse(R"({"req":{"get":["info"]}})", output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"direct":{"v":7},"info":{"fw":"1.0"}}}})");
+}
+
+TEST(KDevJsonProtocol, WriterOverflow)
+{
+	char						output_string[16];
+	k_devjson_protocol_writer_t writer;
+	k_devjson_protocol_writer_init(&writer, output_string, sizeof(output_string));
+	k_devjson_protocol_writer_begin_object(&writer, NULL);
+	k_devjson_protocol_writer_add(&writer, "key", (k_devjson_protocol_value_t){.string_value = (char *)"a long string value"},
+								  K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+	EXPECT_EQ(k_devjson_protocol_writer_finish(&writer), strlen(R"({"key":"a long string value"})"));
+	EXPECT_TRUE(writer.overflow);
+	EXPECT_STREQ(output_string, "");
+}
+
+TEST(KDevJsonProtocol, OutputOverflow)
+{
+	const char				   *json_string = R"({"id": 123, "req":{"get": ["all"]}})";
+	const char				   *response	= R"({"id":123,"res":{"get":{"key1":"test1","key2":"test2","key3":42,"key4":2.5}}})";
+	char						output_string[128];
+	k_devjson_protocol_output_t output		= {output_string, 32, NULL, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	EXPECT_EQ(k_devjson_protocol_parse_output(json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW);
+	EXPECT_STREQ(output_string, "");
+	EXPECT_EQ(output.length, strlen(response));
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string, strlen(json_string), &output),
+			  K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW);
+	EXPECT_STREQ(output_string, "");
+	EXPECT_EQ(output.length, strlen(response));
+
+	/* The reported length is enough to retry */
+	output.size = output.length + 1;
+	EXPECT_EQ(k_devjson_protocol_parse_output(json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, response);
+	EXPECT_EQ(k_devjson_protocol_parse_n(json_string, strlen(json_string), output_string, output.length), K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW);
+}
+
+static int k_devjson_protocol_test_sink(void *sink_arg, const char *data, size_t length)
+{
+	static_cast<std::string *>(sink_arg)->append(data, length);
+	return 0;
+}
+
+static int k_devjson_protocol_test_failing_sink(void *sink_arg, const char *data, size_t length)
+{
+	(void)sink_arg;
+	(void)data;
+	(void)length;
+	return -1;
+}
+
+TEST(KDevJsonProtocol, OutputSink)
+{
+	std::string					json_string = R"({"id": 123, "req":{"get": ["all"], "set": {"key1": "value1"}, "cmd": {"c1": true, "c5":{"key1":2}}}})";
+	const char				   *response	= R"({"id":123,"res":{"get":{"key1":"test1","key2":"test2","key3":42,"key4":2.5},"set":{"key1":"value1"},"cmd":{"c1":true,"c5":false}}})";
+	char						staging[8];
+	std::string					sent;
+	k_devjson_protocol_output_t output		= {staging, sizeof(staging), k_devjson_protocol_test_sink, &sent, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	EXPECT_EQ(k_devjson_protocol_parse_output(json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(sent, response);
+	EXPECT_EQ(output.length, strlen(response));
+
+	sent.clear();
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string.c_str(), json_string.size(), &output),
+			  K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(sent, response);
+	EXPECT_EQ(output.length, strlen(response));
+
+	sent.clear();
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_parser_init_output(&parser, &output);
+	k_devjson_protocol_parse_status_t status = K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE;
+	for (size_t offset = 0; offset < json_string.size() && K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE == status; offset += 7)
+	{
+		status = k_devjson_protocol_parser_feed(&parser, json_string.c_str() + offset, std::min<size_t>(7, json_string.size() - offset), NULL);
+	}
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(sent, response);
+	EXPECT_EQ(output.length, strlen(response));
+
+	/* A request failing before the first flush sends the same empty object as the buffer mode */
+	sent.clear();
+	EXPECT_EQ(k_devjson_protocol_parse_output(R"({"id": 12, "req":{"get": ["all"]}})", strlen(R"({"id": 12, "req":{"get": ["all"]}})"), &output),
+			  K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(sent, "{}");
+	EXPECT_EQ(output.length, 2u);
+}
+
+TEST(KDevJsonProtocol, OutputSinkFailure)
+{
+	const char				   *json_string = R"({"id": 123, "req":{"get": ["all"]}})";
+	char						staging[8];
+	k_devjson_protocol_output_t output		= {staging, sizeof(staging), k_devjson_protocol_test_failing_sink, NULL, 0};
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	EXPECT_EQ(k_devjson_protocol_parse_output(json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_ERROR);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&k_devjson_protocol_default_ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_ERROR);
+}
+
+typedef struct
+{
+	const char *model;
+	int			requests;
+} k_devjson_protocol_test_device_t;
+
+static void k_devjson_protocol_test_device_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	k_devjson_protocol_test_device_t *device = static_cast<k_devjson_protocol_test_device_t *>(cb_arg->user_data);
+	if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type) && (0 == strcmp(cb_arg->key, "model")))
+	{
+		device->requests++;
+		k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.string_value = (char *)device->model},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+	}
+	else if (K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD == cb_arg->group_type)
+	{
+		k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key,
+										(k_devjson_protocol_value_t){.bool_value = K_DEVJSON_PROTOCOL_VALUE_TYPE_JSON == cb_arg->input_value_type},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL);
+	}
+}
+
+TEST(KDevJsonProtocol, CtxUserData)
+{
+	const char						*json_string = R"({"req":{"get": ["model"]}})";
+	char							 output_string[128];
+	k_devjson_protocol_output_t		 output		 = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_test_device_t sensor		 = {"sensor", 0};
+	k_devjson_protocol_test_device_t relay		 = {"relay", 0};
+	k_devjson_protocol_ctx_t		 sensor_ctx;
+	k_devjson_protocol_ctx_t		 relay_ctx;
+	k_devjson_protocol_ctx_init(&sensor_ctx, k_devjson_protocol_test_device_callback, &sensor);
+	k_devjson_protocol_ctx_init(&relay_ctx, k_devjson_protocol_test_device_callback, &relay);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&sensor_ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"sensor"}}})");
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&relay_ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"relay"}}})");
+
+	relay_ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_DOM;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&relay_ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"relay"}}})");
+
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_ctx_parser_init(&sensor_ctx, &parser, &output);
+	EXPECT_EQ(k_devjson_protocol_parser_feed(&parser, json_string, strlen(json_string), NULL), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"sensor"}}})");
+	EXPECT_EQ(sensor.requests, 2);
+	EXPECT_EQ(relay.requests, 2);
+
+	/* The default context is left untouched */
+	k_devjson_protocol_register_callback(NULL);
+	EXPECT_EQ(k_devjson_protocol_parse(json_string, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_ERROR);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&sensor_ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+}
+
+TEST(KDevJsonProtocol, CtxParallelParse)
+{
+	const char *json_string = R"({"req":{"get": ["model"], "cmd": {"c5": {"key1": 2, "key2": [1, 2, 3]}}}})";
+	struct
+	{
+		alignas(8) unsigned char		 arena_buffer[4096];
+		k_devjson_protocol_arena_t		 arena;
+		k_devjson_protocol_test_device_t device;
+		k_devjson_protocol_ctx_t		 ctx;
+	} workers[4];
+	const char				*models[] = {"sensor", "relay", "gateway", "meter"};
+	std::vector<std::thread> threads;
+
+	/* One context per worker with its own callback data and arena, set up before the workers start */
+	for (size_t i = 0; i < 4; i++)
+	{
+		workers[i].device = {models[i], 0};
+		k_devjson_protocol_arena_init(&workers[i].arena, workers[i].arena_buffer, sizeof(workers[i].arena_buffer));
+		k_devjson_protocol_ctx_init(&workers[i].ctx, k_devjson_protocol_test_device_callback, &workers[i].device);
+		k_devjson_protocol_ctx_set_arena(&workers[i].ctx, &workers[i].arena);
+	}
+	for (auto &worker : workers)
+	{
+		threads.emplace_back(
+			[json_string, &worker]()
+			{
+				char						output_string[128];
+				k_devjson_protocol_output_t output	 = {output_string, sizeof(output_string), NULL, NULL, 0};
+				std::string					response = std::string(R"({"res":{"get":{"model":")") + worker.device.model + R"("},"cmd":{"c5":true}}})";
+				for (int i = 0; i < 500; i++)
+				{
+					EXPECT_EQ(k_devjson_protocol_ctx_parse(&worker.ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+					EXPECT_EQ(output_string, response);
+				}
+			});
+	}
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	for (auto &worker : workers)
+	{
+		EXPECT_EQ(worker.device.requests, 500);
+		EXPECT_GT(worker.arena.peak, 0u);
+		EXPECT_EQ(worker.arena.used, 0u);
+		EXPECT_EQ(worker.arena.fallbacks, 0u);
+	}
+}
+
+static void k_devjson_protocol_test_value_handler(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.int_value = *static_cast<int *>(cb_arg->user_data)},
+									K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+}
+
+static void k_devjson_protocol_test_store_handler(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	*static_cast<int *>(cb_arg->user_data) = cb_arg->input_value.int_value;
+	k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, cb_arg->input_value, cb_arg->input_value_type);
+}
+
+TEST(KDevJsonProtocol, RegistryDispatch)
+{
+	const char						*json_string = R"({"req":{"get": ["model", "temperature", "mode"], "set": {"mode": 3}, "cmd": {"c5": {"key1": 2}}}})";
+	char							 output_string[256];
+	k_devjson_protocol_output_t		 output		 = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_test_device_t device		 = {"sensor", 0};
+	int								 temperature = 21;
+	int								 mode		 = 1;
+	k_devjson_protocol_handler_t	 slots[8];
+	k_devjson_protocol_registry_t	 registry;
+	k_devjson_protocol_ctx_t		 ctx;
+	k_devjson_protocol_registry_init(&registry, slots, 8);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, "temperature", k_devjson_protocol_test_value_handler, &temperature),
+			  0);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, "mode", k_devjson_protocol_test_value_handler, &mode), 0);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_SET, "mode", k_devjson_protocol_test_store_handler, &mode), 0);
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_device_callback, &device);
+	k_devjson_protocol_ctx_set_registry(&ctx, &registry);
+
+	/* Registered keys go to their handler, the others to the context callback with the context user data */
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"sensor","temperature":21,"mode":1},"set":{"mode":3},"cmd":{"c5":true}}})");
+	EXPECT_EQ(mode, 3);
+	EXPECT_EQ(device.requests, 1);
+
+	ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_DOM;
+	temperature		  = 22;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"sensor","temperature":22,"mode":3},"set":{"mode":3},"cmd":{"c5":true}}})");
+	EXPECT_EQ(device.requests, 2);
+
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_ctx_parser_init(&ctx, &parser, &output);
+	EXPECT_EQ(k_devjson_protocol_parser_feed(&parser, json_string, strlen(json_string), NULL), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"model":"sensor","temperature":22,"mode":3},"set":{"mode":3},"cmd":{"c5":true}}})");
+	EXPECT_EQ(device.requests, 3);
+}
+
+TEST(KDevJsonProtocol, RegistryFull)
+{
+	int							  value = 0;
+	k_devjson_protocol_handler_t  slots[6];
+	k_devjson_protocol_registry_t registry;
+	k_devjson_protocol_registry_init(&registry, slots, 6);
+	EXPECT_EQ(registry.capacity, 4u);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, "a", k_devjson_protocol_test_value_handler, &value), 0);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_SET, "a", k_devjson_protocol_test_value_handler, &value), 0);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD, "a", k_devjson_protocol_test_value_handler, &value), 0);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, "b", k_devjson_protocol_test_value_handler, &value), -1);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, "a", k_devjson_protocol_test_store_handler, &value), 0);
+	EXPECT_EQ(registry.count, 3u);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_ID, "a", k_devjson_protocol_test_value_handler, &value), -1);
+	EXPECT_EQ(k_devjson_protocol_registry_add(&registry, K_DEVJSON_PROTOCOL_GROUP_TYPE_GET, NULL, k_devjson_protocol_test_value_handler, &value), -1);
+}
+
+static void k_devjson_protocol_test_lazy_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_CMD == cb_arg->group_type) && (K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON == cb_arg->input_value_type))
+	{
+		k_devjson_protocol_lazy_t	   *lazy   = cb_arg->input_value.lazy_value;
+		const char					   *keys[] = {"enabled", "ssid", "channel", "missing"};
+		k_devjson_protocol_lazy_t		member;
+		k_devjson_protocol_lazy_t		dhcp;
+		k_devjson_protocol_value_t		value;
+		k_devjson_protocol_value_type_t value_type;
+		for (const char *key : keys)
+		{
+			if (k_devjson_protocol_lazy_member(lazy, key, &member))
+			{
+				value_type = k_devjson_protocol_lazy_value(&member, &value);
+				k_devjson_protocol_add_response(cb_arg->output_json, key, value, value_type);
+				k_devjson_protocol_lazy_release(&member);
+			}
+		}
+		if (k_devjson_protocol_lazy_member(lazy, "ip", &member) &&
+			(K_DEVJSON_PROTOCOL_VALUE_TYPE_LAZY_JSON == k_devjson_protocol_lazy_value(&member, &value)) &&
+			k_devjson_protocol_lazy_member(value.lazy_value, "dhcp", &dhcp))
+		{
+			value_type = k_devjson_protocol_lazy_value(&dhcp, &value);
+			k_devjson_protocol_add_response(cb_arg->output_json, "dhcp", value, value_type);
+		}
+		value.int_value = cJSON_GetArraySize(k_devjson_protocol_lazy_json(lazy));	//!< Whole object parsed on request
+		k_devjson_protocol_add_response(cb_arg->output_json, "members", value, K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+	}
+	else
+	{
+		k_devjson_protocol_callback(cb_arg);
+	}
+}
+
+TEST(KDevJsonProtocol, LazyCmdJson)
+{
+	const char json_string[] =
+		R"({"id": 123, "req":{"cmd": {"wifi": {"ssid": "home \"net\"", "ip": {"address": [192, 168, 1, 10], "dhcp": false}, "channel": 6, "enabled": true, "note": "}"}}}})";
+	const char				   *expected = R"({"id":123,"res":{"cmd":{"enabled":true,"ssid":"home \"net\"","channel":6,"dhcp":false,"members":5}}})";
+	char						output_string[256];
+	k_devjson_protocol_output_t output	 = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_lazy_callback, NULL);
+	ctx.config.lazy_json = 1;
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&ctx, json_string, sizeof(json_string) - 1, &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, expected);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&ctx, json_string, sizeof(json_string) - 1, &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, expected);
+
+	/* Value split across chunks: read from the capture buffer */
+	k_devjson_protocol_parser_t		  parser;
+	k_devjson_protocol_parse_status_t status = K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE;
+	k_devjson_protocol_ctx_parser_init(&ctx, &parser, &output);
+	for (size_t offset = 0; (offset < sizeof(json_string) - 1) && (K_DEVJSON_PROTOCOL_PARSE_INCOMPLETE == status); offset += 7)
+	{
+		status = k_devjson_protocol_parser_feed(&parser, json_string + offset, std::min<size_t>(7, sizeof(json_string) - 1 - offset), NULL);
+	}
+	EXPECT_EQ(status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, expected);
+}
+
+static void k_devjson_protocol_test_forward_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (cb_arg->raw)
+	{
+		k_devjson_protocol_add_raw_response(cb_arg->output_json, cb_arg->key, cb_arg->raw, cb_arg->raw_length);
+	}
+	else
+	{
+		k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, cb_arg->input_value, cb_arg->input_value_type);
+	}
+}
+
+TEST(KDevJsonProtocol, RawValueForwarding)
+{
+	const char json_string[] =
+		R"({"req":{"set": {"name": "a\"b", "level": 1.50, "flag": true, "none": null, "list": [1, {"a": 2}]}, "cmd": {"fw": {"url": "fw.bin", "size": 1e3}}}})";
+	char						output_string[256];
+	k_devjson_protocol_output_t output = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_forward_callback, NULL);
+	ctx.config.lazy_json = 1;
+
+	/* Every value is copied to the response as it was received */
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&ctx, json_string, sizeof(json_string) - 1, &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string,
+				 R"({"res":{"set":{"name":"a\"b","level":1.50,"flag":true,"none":null,"list":[1, {"a": 2}]},"cmd":{"fw":{"url": "fw.bin", "size": 1e3}}}})");
+
+	/* Split across chunks: the cmd object is still forwarded from the capture buffer */
+	const char					cmd_string[] = R"({"req":{"cmd": {"fw": {"url": "fw.bin", "size": 1e3}}}})";
+	k_devjson_protocol_parser_t parser;
+	k_devjson_protocol_ctx_parser_init(&ctx, &parser, &output);
+	for (size_t offset = 0; offset < sizeof(cmd_string) - 1; offset += 4)
+	{
+		(void)k_devjson_protocol_parser_feed(&parser, cmd_string + offset, std::min<size_t>(4, sizeof(cmd_string) - 1 - offset), NULL);
+	}
+	EXPECT_STREQ(output_string, R"({"res":{"cmd":{"fw":{"url": "fw.bin", "size": 1e3}}}})");
+
+	/* The DOM engine has no raw bytes: the lazy value is forwarded from its tree */
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&ctx, cmd_string, sizeof(cmd_string) - 1, &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"cmd":{"fw":{"url":"fw.bin","size":1000}}}})");
+
+	cJSON *json = cJSON_CreateObject();
+	k_devjson_protocol_add_raw_response(json, "k", "[1,2]xyz", 5);
+	char *printed = cJSON_PrintUnformatted(json);
+	EXPECT_STREQ(printed, R"({"k":[1,2]})");
+	cJSON_free(printed);
+	cJSON_Delete(json);
+}
+
+TEST(KDevJsonProtocol, ParseBatch)
+{
+	const char *json_strings[] = {R"({"id": 123, "req":{"get": ["key1"]}})", R"({"id": 13, "req":{"get": ["key1"]}})", R"({"id": 123, "req":{"get": [)",
+								  R"({"id": 123, "req":{"get": ["key3"], "set": {"key1": "value1"}}})"};
+	const char *responses[]	   = {R"({"id":123,"res":{"get":{"key1":"test1"}}})", R"({"id":123,"res":{"get":{"key3":42},"set":{"key1":"value1"}}})"};
+	char							output_strings[4][128];
+	k_devjson_protocol_batch_item_t items[4];
+	alignas(8) unsigned char		arena_buffer[4096];
+	k_devjson_protocol_arena_t		arena;
+	k_devjson_protocol_ctx_t		ctx;
+	for (size_t i = 0; i < 4; i++)
+	{
+		items[i] = {json_strings[i], strlen(json_strings[i]), {output_strings[i], sizeof(output_strings[i]), NULL, NULL, 0}, K_DEVJSON_PROTOCOL_PARSE_ERROR};
+	}
+
+	/* Every request gets its own status and response, a failed one does not stop the batch */
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	EXPECT_EQ(k_devjson_protocol_parse_batch(items, 4), 2u);
+	EXPECT_EQ(items[0].status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(items[1].status, K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(items[2].status, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+	EXPECT_EQ(items[3].status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_strings[0], responses[0]);
+	EXPECT_STREQ(output_strings[3], responses[1]);
+	EXPECT_EQ(items[3].output.length, strlen(responses[1]));
+
+	/* The requests of a batch share the arena memory and leave it empty */
+	k_devjson_protocol_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_callback, NULL);
+	k_devjson_protocol_ctx_set_arena(&ctx, &arena);
+	ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_DOM;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse_batch(&ctx, items, 4), 2u);
+	EXPECT_EQ(items[1].status, K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_STREQ(output_strings[3], responses[1]);
+	EXPECT_GT(arena.peak, 0u);
+	EXPECT_EQ(arena.used, 0u);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse_batch(&ctx, NULL, 4), 0u);
+}
+
+TEST(KDevJsonProtocol, StreamNdjson)
+{
+	const std::string json_stream = R"({"id": 123, "req":{"get": ["key1"]}})"
+									"\n\n"
+									R"({"id": 13, "req":{"get": ["key1"]}})"
+									"\n"
+									R"({"id": 123, "req":{"get": [)"
+									"\n"
+									R"(  {"id": 123, "req":{"set": {"key1": "value1"}}} trailing)"
+									"\r\n"
+									R"({"req":{"get": ["key3"]}})";
+	const char *responses = R"({"id":123,"res":{"get":{"key1":"test1"}}})"
+							"\n{}\n{}\n"
+							R"({"id":123,"res":{"set":{"key1":"value1"}}})"
+							"\n"
+							R"({"res":{"get":{"key3":42}}})"
+							"\n";
+	char						staging[64];
+	std::string					sent;
+	k_devjson_protocol_output_t output = {staging, sizeof(staging), k_devjson_protocol_test_sink, &sent, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_stream_t stream;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_callback, NULL);
+
+	/* One response line per request line, in order, whole or cut anywhere */
+	for (size_t chunk_size : {json_stream.size(), (size_t)1, (size_t)7})
+	{
+		size_t responses_written = 0;
+		sent.clear();
+		k_devjson_protocol_stream_init(&stream, &ctx, &output);
+		for (size_t offset = 0; offset < json_stream.size(); offset += chunk_size)
+		{
+			responses_written += k_devjson_protocol_stream_feed(&stream, json_stream.c_str() + offset, std::min(chunk_size, json_stream.size() - offset));
+		}
+		EXPECT_EQ(responses_written, 5u);
+		EXPECT_EQ(k_devjson_protocol_stream_finish(&stream), 0u);
+		EXPECT_EQ(sent, responses);
+		EXPECT_EQ(stream.responses, 5u);
+		EXPECT_EQ(stream.failures, 2u);
+		EXPECT_EQ(stream.status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	}
+
+	/* A last line cut by the end of the stream is completed by finish */
+	sent.clear();
+	EXPECT_EQ(k_devjson_protocol_stream_feed(&stream, R"({"req":{"get": [)", strlen(R"({"req":{"get": [)")), 0u);
+	EXPECT_EQ(k_devjson_protocol_stream_finish(&stream), 1u);
+	EXPECT_EQ(sent, "{}\n");
+	EXPECT_EQ(stream.status, K_DEVJSON_PROTOCOL_PARSE_INVALID_JSON);
+}
+
+TEST(KDevJsonProtocol, StreamLineWithIDAfterRequest)
+{
+	/* Lines whose ID is not known before the request is read, whole or cut anywhere: the request is replayed once the line is read */
+	const std::string json_stream = R"({"req":{"get": ["key1"]}})"
+									"\n"
+									R"({"req":{"get": ["key1"]}, "id": "x"})"
+									"\n"
+									R"({"req":{"get": ["key1"]}, "id": 123})"
+									"\n"
+									R"({"req":{"set": {"key1": "value1"}}, "id": 13})"
+									"\n";
+	const char *responses = R"({"res":{"get":{"key1":"test1"}}})"
+							"\n"
+							R"({"res":{"get":{"key1":"test1"}}})"
+							"\n"
+							R"({"id":123,"res":{"get":{"key1":"test1"}}})"
+							"\n{}\n";
+	char						staging[64];
+	std::string					sent;
+	k_devjson_protocol_output_t output = {staging, sizeof(staging), k_devjson_protocol_test_sink, &sent, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	k_devjson_protocol_stream_t stream;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_counting_callback, NULL);
+	for (size_t chunk_size : {json_stream.size(), (size_t)1, (size_t)7})
+	{
+		size_t responses_written = 0;
+		sent.clear();
+		k_devjson_protocol_stream_init(&stream, &ctx, &output);
+		k_devjson_protocol_test_dispatch_count = 0;
+		for (size_t offset = 0; offset < json_stream.size(); offset += chunk_size)
+		{
+			responses_written += k_devjson_protocol_stream_feed(&stream, json_stream.c_str() + offset, std::min(chunk_size, json_stream.size() - offset));
+		}
+		EXPECT_EQ(responses_written, 4u);
+		EXPECT_EQ(sent, responses);
+		EXPECT_EQ(stream.failures, 1u);
+		EXPECT_EQ(stream.status, K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+		EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 3);  //!< Nothing dispatched for the other device
+	}
+}
+
+typedef struct
+{
+	std::mutex			lock;
+	std::vector<size_t> completed;
+} k_devjson_protocol_test_completions_t;
+
+static void k_devjson_protocol_test_completion(k_devjson_protocol_job_t *job)
+{
+	k_devjson_protocol_test_completions_t *completions = static_cast<k_devjson_protocol_test_completions_t *>(job->user_data);
+	std::lock_guard<std::mutex>			   guard(completions->lock);
+	completions->completed.push_back(job->sequence);
+}
+
+TEST(KDevJsonProtocol, ExecutorParallelParse)
+{
+	const char *json_string = R"({"id": 123, "req":{"get": ["key1"], "cmd": {"c5": {"key1": 2, "key2": [1, 2, 3]}}}})";
+	const char *response	= R"({"id":123,"res":{"get":{"key1":"test1"},"cmd":{"c5":false}}})";
+	alignas(8) unsigned char			  arena_buffers[4][4096];
+	alignas(8) unsigned char			  shared_buffer[4096];
+	k_devjson_protocol_arena_t			  arenas[4];
+	k_devjson_protocol_arena_t			  shared_arena;
+	k_devjson_protocol_store_cache_t	  shared_cache = {0};
+	k_devjson_protocol_worker_t			  workers[4];
+	k_devjson_protocol_executor_t		  executor;
+	k_devjson_protocol_ctx_t			  ctx;
+	k_devjson_protocol_channel_t		  channel;
+	k_devjson_protocol_test_completions_t unordered;
+	k_devjson_protocol_test_completions_t ordered;
+	std::vector<k_devjson_protocol_job_t> jobs(800);
+	std::vector<std::string>			  outputs(jobs.size(), std::string(128, '\0'));
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_callback, NULL);
+	k_devjson_protocol_channel_init(&channel);
+	k_devjson_protocol_arena_init(&shared_arena, shared_buffer, sizeof(shared_buffer));
+	k_devjson_protocol_ctx_set_arena(&ctx, &shared_arena);
+	k_devjson_protocol_ctx_set_store_cache(&ctx, &shared_cache);
+
+	/* Every worker parses with its own arena: the arena and the cache of the context are not copied */
+	for (size_t i = 0; i < 4; i++)
+	{
+		k_devjson_protocol_arena_init(&arenas[i], arena_buffers[i], sizeof(arena_buffers[i]));
+	}
+	ASSERT_EQ(k_devjson_protocol_executor_init(&executor, &ctx, workers, arenas, 4), 0);
+	for (size_t i = 0; i < 4; i++)
+	{
+		EXPECT_EQ(workers[i].ctx.arena, &arenas[i]);
+		EXPECT_EQ(workers[i].ctx.store_cache, nullptr);
+	}
+	ASSERT_EQ(k_devjson_protocol_executor_start(&executor), 0);
+
+	/* Half of the jobs are completed in any order, the other half in the order of their channel */
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		jobs[i] = {json_string, strlen(json_string), {&outputs[i][0], outputs[i].size(), NULL, NULL, 0}, K_DEVJSON_PROTOCOL_PARSE_ERROR,
+				   k_devjson_protocol_test_completion, i % 2 ? &ordered : &unordered, i % 2 ? &channel : NULL, NULL, 0};
+		EXPECT_EQ(k_devjson_protocol_executor_submit(&executor, &jobs[i]), 0);
+	}
+	k_devjson_protocol_job_t orphan = {json_string, strlen(json_string), {NULL, 0, NULL, NULL, 0}, K_DEVJSON_PROTOCOL_PARSE_ERROR, NULL, NULL, NULL, NULL, 0};
+	EXPECT_EQ(k_devjson_protocol_executor_submit(&executor, &orphan), -1);	//!< Nobody would know when it is complete
+	k_devjson_protocol_executor_stop(&executor);
+
+	size_t processed = 0;
+	for (size_t i = 0; i < 4; i++)
+	{
+		processed += workers[i].processed;
+		EXPECT_EQ(arenas[i].used, 0u);
+		EXPECT_EQ(arenas[i].fallbacks, 0u);
+	}
+	EXPECT_EQ(shared_arena.peak, 0u);  //!< Never used by the workers
+	EXPECT_EQ(processed, jobs.size());
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		EXPECT_EQ(jobs[i].status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(outputs[i].c_str(), response);
+	}
+	EXPECT_EQ(unordered.completed.size(), jobs.size() / 2);
+	ASSERT_EQ(ordered.completed.size(), jobs.size() / 2);
+	for (size_t i = 0; i < ordered.completed.size(); i++)
+	{
+		EXPECT_EQ(ordered.completed[i], i);
+	}
+}
+
+typedef struct
+{
+	k_devjson_protocol_pending_t pending[2];   //!< Keys deferred by the handler
+	size_t						 deferred;	   //!< Number of keys deferred
+	int							 immediate;	   //!< Complete the keys before the handler returns
+} k_devjson_protocol_test_slow_t;
+
+static void k_devjson_protocol_test_slow_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	k_devjson_protocol_test_slow_t *slow = static_cast<k_devjson_protocol_test_slow_t *>(cb_arg->user_data);
+	if (cb_arg->key && (0 == strncmp(cb_arg->key, "slow", 4)) && (0 == k_devjson_protocol_defer(cb_arg, &slow->pending[slow->deferred])))
+	{
+		if (slow->immediate)
+		{
+			const std::string		   too_long(K_DEVJSON_PROTOCOL_PENDING_VALUE_SIZE, 'x');
+			k_devjson_protocol_value_t value = {.string_value = (char *)too_long.c_str()};
+			EXPECT_EQ(k_devjson_protocol_pending_complete(&slow->pending[slow->deferred], value, K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING), -1);  //!< Answered with null
+		}
+		slow->deferred++;
+	}
+	else
+	{
+		k_devjson_protocol_callback(cb_arg);
+	}
+}
+
+static void k_devjson_protocol_test_deferred_completion(k_devjson_protocol_deferred_t *deferred)
+{
+	(*static_cast<size_t *>(deferred->user_data))++;
+}
+
+TEST(KDevJsonProtocol, DeferredKeys)
+{
+	const char					  *json_string = R"({"id": 123, "req":{"get": ["key1", "slow1"], "cmd": {"slow2": {"mode": 1}, "c1": true}}})";
+	const char					  *response	   = R"({"id":123,"res":{"get":{"key1":"test1","slow1":42},"cmd":{"slow2":true,"c1":true}}})";
+	char						   output_string[128];
+	size_t						   completions = 0;
+	k_devjson_protocol_deferred_t  deferred	   = {k_devjson_protocol_test_deferred_completion, &completions};
+	k_devjson_protocol_output_t	   output	   = {output_string, sizeof(output_string), NULL, NULL, 0, &deferred};
+	k_devjson_protocol_test_slow_t slow		   = {};
+	k_devjson_protocol_ctx_t	   ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_slow_callback, &slow);
+
+	/* The parse returns with the slow keys pending, they are completed in any order and from any thread */
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_PENDING);
+	ASSERT_EQ(slow.deferred, 2u);
+	std::thread worker([&slow]() {
+		EXPECT_EQ(k_devjson_protocol_pending_complete(&slow.pending[1], (k_devjson_protocol_value_t){.bool_value = 1}, K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL), 0);
+	});
+	worker.join();
+	EXPECT_EQ(completions, 0u);
+	EXPECT_EQ(k_devjson_protocol_pending_complete(&slow.pending[0], (k_devjson_protocol_value_t){.int_value = 42}, K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER), 0);
+	EXPECT_EQ(completions, 1u);
+	EXPECT_EQ(deferred.status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, response);
+	EXPECT_EQ(output.length, strlen(response));
+
+	/* The values do not fit: same result as an overflow of the parse */
+	slow.deferred = 0;
+	output.size	  = strlen(response);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_PENDING);
+	EXPECT_EQ(k_devjson_protocol_pending_complete(&slow.pending[0], (k_devjson_protocol_value_t){.int_value = 42}, K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER), 0);
+	EXPECT_EQ(k_devjson_protocol_pending_complete(&slow.pending[1], (k_devjson_protocol_value_t){.bool_value = 1}, K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL), 0);
+	EXPECT_EQ(completions, 2u);
+	EXPECT_EQ(deferred.status, K_DEVJSON_PROTOCOL_PARSE_OUTPUT_OVERFLOW);
+	EXPECT_STREQ(output_string, "");
+	EXPECT_EQ(output.length, strlen(response));
+
+	/* Keys completed before the parse ends: the completion is fired before it returns */
+	slow.deferred  = 0;
+	slow.immediate = 1;
+	output.size	   = sizeof(output_string);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_PENDING);
+	EXPECT_EQ(completions, 3u);
+	EXPECT_EQ(deferred.status, K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1","slow1":null},"cmd":{"slow2":null,"c1":true}}})");
+
+	/* Without a deferred request, with a sink or with the DOM engine the handlers must answer before returning */
+	std::string sent;
+	slow.deferred	= 0;
+	output.deferred = NULL;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	output.deferred = &deferred;
+	output.sink		= k_devjson_protocol_test_sink;
+	output.sink_arg = &sent;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(sent, R"({"id":123,"res":{"get":{"key1":"test1"},"cmd":{"slow2":false,"c1":true}}})");
+	output.sink		  = NULL;
+	ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_DOM;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"id":123,"res":{"get":{"key1":"test1"},"cmd":{"slow2":false,"c1":true}}})");
+	EXPECT_EQ(slow.deferred, 0u);
+	EXPECT_EQ(completions, 3u);
+}
+
+static void k_devjson_protocol_test_property_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	k_devjson_protocol_test_device_t *device = static_cast<k_devjson_protocol_test_device_t *>(cb_arg->user_data);
+	device->requests++;
+	if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type) && ((0 == strcmp(cb_arg->key, "all")) || (0 == strcmp(cb_arg->key, "model"))))
+	{
+		k_devjson_protocol_add_response(cb_arg->output_json, "model", (k_devjson_protocol_value_t){.string_value = (char *)device->model},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+	}
+}
+
+TEST(KDevJsonProtocol, PropertyTable)
+{
+	const char						 *json_string  = R"({"req":{"get": ["mode", "model"], "set": {"mode": 3, "level": 7.5, "enabled": false, "name": "hall", "serial": "X2"}}})";
+	const char						 *refused	   = R"({"req":{"set": {"mode": 2.5, "level": 11, "enabled": 1, "name": "corridor"}}})";
+	const char						 *get_all	   = R"({"req":{"get": "all"}})";
+	const k_devjson_protocol_engine_t engines[]	   = {K_DEVJSON_PROTOCOL_ENGINE_STREAMING, K_DEVJSON_PROTOCOL_ENGINE_DOM};
+	char							  output_string[256];
+	k_devjson_protocol_output_t		  output	   = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_test_device_t  device	   = {"sensor", 0};
+	int								  mode;
+	float							  level;
+	int								  enabled;
+	char							  name[8];
+	char							  serial[8];
+	k_devjson_protocol_store_t		  store;
+	k_devjson_protocol_ctx_t		  ctx;
+	k_devjson_protocol_property_t	  properties[] = {
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER, K_DEVJSON_PROTOCOL_PROPERTY_RANGE, "mode", &mode, 0, {.int_value = 0}, {.int_value = 3}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT, K_DEVJSON_PROTOCOL_PROPERTY_RANGE, "level", &level, 0, {.float_value = 0.0f}, {.float_value = 10.0f}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL, 0, "enabled", &enabled, 0, {}, {}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING, 0, "name", name, sizeof(name), {}, {}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING, K_DEVJSON_PROTOCOL_PROPERTY_READ_ONLY, "serial", serial, sizeof(serial), {}, {}},
+	};
+	k_devjson_protocol_store_init(&store, properties, sizeof(properties) / sizeof(properties[0]));
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_property_callback, &device);
+	k_devjson_protocol_ctx_set_store(&ctx, &store);
+
+	for (const k_devjson_protocol_engine_t engine : engines)
+	{
+		mode			  = 1;
+		level			  = 21.5f;
+		enabled			  = 1;
+		device.requests	  = 0;
+		ctx.config.engine = engine;
+		strcpy(name, "room");
+		strcpy(serial, "X1");
+
+		/* Properties are answered and stored without firing the callback, a read-only one keeps its value */
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":1,"model":"sensor"},"set":{"mode":3,"level":7.5,"enabled":false,"name":"hall","serial":"X1"}}})");
+		EXPECT_EQ(device.requests, 1);
+		EXPECT_EQ(mode, 3);
+		EXPECT_EQ(enabled, 0);
+		EXPECT_STREQ(name, "hall");
+
+		/* A value of the wrong type, out of range or too long is refused and the current value answered */
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, refused, strlen(refused), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"set":{"mode":3,"level":7.5,"enabled":false,"name":"hall"}}})");
+		EXPECT_EQ(device.requests, 1);
+
+		/* "all" answers every property in store order, then the callback adds the other keys */
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":3,"level":7.5,"enabled":false,"name":"hall","serial":"X1","model":"sensor"}}})");
+		EXPECT_EQ(device.requests, 2);
+	}
+}
+
+TEST(KDevJsonProtocol, PropertyStoreCache)
+{
+	const char						*get_all	  = R"({"req":{"get": "all"}})";
+	const char						*set_name	  = R"({"req":{"set": {"name": "corridor"}}})";
+	char							 output_string[256];
+	k_devjson_protocol_output_t		 output		  = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_test_device_t device		  = {"sensor", 0};
+	int								 mode		  = 1;
+	float							 level		  = 21.5f;
+	char							 name[16];
+	char							 buffer[64];
+	k_devjson_protocol_fragment_t	 fragments[3];
+	k_devjson_protocol_store_cache_t cache;
+	k_devjson_protocol_store_t		 store;
+	k_devjson_protocol_ctx_t		 ctx;
+	k_devjson_protocol_property_t	 properties[] = {
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER, 0, "mode", &mode, 0, {}, {}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING, 0, "name", name, sizeof(name), {}, {}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT, 0, "level", &level, 0, {}, {}},
+	};
+	strcpy(name, "room");
+	k_devjson_protocol_store_init(&store, properties, 3);
+	k_devjson_protocol_store_cache_init(&cache, fragments, 3, buffer, sizeof(buffer));
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_property_callback, &device);
+	k_devjson_protocol_ctx_set_store(&ctx, &store);
+	k_devjson_protocol_ctx_set_store_cache(&ctx, &cache);
+	ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_STREAMING;
+
+	/* The first poll serializes every member, the next ones copy them */
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":1,"name":"room","level":21.5,"model":"sensor"}}})");
+	EXPECT_EQ(cache.length, strlen(R"("mode":1,"name":"room","level":21.5)"));
+
+	/* A slot written by the application is serialized again once the store is told */
+	mode = 2;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":1,"name":"room","level":21.5,"model":"sensor"}}})");
+	k_devjson_protocol_property_changed(&properties[0]);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":2,"name":"room","level":21.5,"model":"sensor"}}})");
+
+	/* A SET changes the version too: the longer member moves the ones after it */
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, set_name, strlen(set_name), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":2,"name":"corridor","level":21.5,"model":"sensor"}}})");
+	level = 3.0f;
+	k_devjson_protocol_property_changed(&properties[2]);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, R"({"res":{"get":{"mode":2,"name":"corridor","level":3,"model":"sensor"}}})");
+	EXPECT_EQ(cache.length, strlen(R"("mode":2,"name":"corridor","level":3)"));
+
+	/* Members that do not fit the buffer, or a response built by the DOM engine, are answered without the cache */
+	const char *response = R"({"res":{"get":{"mode":2,"name":"corridor","level":3,"model":"sensor"}}})";
+	k_devjson_protocol_store_cache_init(&cache, fragments, 3, buffer, 16);
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, response);
+	EXPECT_EQ(cache.valid, 0);
+	k_devjson_protocol_store_cache_init(&cache, fragments, 3, buffer, sizeof(buffer));
+	ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_DOM;
+	EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, response);
+	EXPECT_EQ(cache.valid, 0);
+	EXPECT_EQ(device.requests, 7);
+}
+
+static void k_devjson_protocol_test_float_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type) && (0 == strcmp(cb_arg->key, "temp")))
+	{
+		k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.float_value = 2.1f},
+										K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT);
+	}
+	else if ((K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type) && (0 == strcmp(cb_arg->key, "setpoint")))
+	{
+		k_devjson_protocol_add_fixed_response(cb_arg->output_json, cb_arg->key, 21.5f, 2);
+	}
+}
+
+TEST(KDevJsonProtocol, FloatFormat)
+{
+	const struct
+	{
+		float		value;
+		const char *shortest;
+	} shortest[] = {{2.1f, "2.1"},
+					{0.1f, "0.1"},
+					{-3.0f, "-3"},
+					{-0.0f, "0"},
+					{3e9f, "3000000000"},
+					{123456.79f, "123456.79"},
+					{0.000001f, "0.000001"},
+					{1e-7f, "1e-7"},
+					{1e30f, "1e+30"},
+					{3.4028235e38f, "3.4028235e+38"},
+					{1.17549435e-38f, "1.1754944e-38"},
+					{1.4e-45f, "1e-45"},
+					{NAN, "null"},
+					{-INFINITY, "null"}};
+	const struct
+	{
+		float		 value;
+		unsigned int decimals;
+		const char	*fixed;
+	} fixed[] = {{21.5f, 2, "21.50"}, {1234.5678f, 3, "1234.568"}, {-1.5f, 0, "-2"}, {-0.004f, 2, "0.00"}, {0.1f, 12, "0.100000001"}, {1e30f, 2, "1e+30"}};
+	char number[K_DEVJSON_PROTOCOL_FLOAT_SIZE];
+
+	for (const auto &test : shortest)
+	{
+		EXPECT_EQ(k_devjson_protocol_float_format(test.value, number), strlen(test.shortest));
+		EXPECT_STREQ(number, test.shortest);
+	}
+	for (const auto &test : fixed)
+	{
+		EXPECT_EQ(k_devjson_protocol_float_fixed(test.value, test.decimals, number), strlen(test.fixed));
+		EXPECT_STREQ(number, test.fixed);
+	}
+
+	/* Every float reads back the same: a sweep over the bit patterns of both signs */
+	for (uint32_t bits = 0; bits < 0x7f800000; bits += 9973)
+	{
+		for (const uint32_t pattern : {bits, bits | 0x80000000})
+		{
+			float value;
+			memcpy(&value, &pattern, sizeof(value));
+			k_devjson_protocol_float_format(value, number);
+			EXPECT_EQ(strtof(number, NULL), value) << number;
+		}
+	}
+}
+
+TEST(KDevJsonProtocol, FloatResponses)
+{
+	const char						 *json_string  = R"({"req":{"get": ["temp", "setpoint", "level", "gain"], "set": {"gain": 0.3}}})";
+	const char						 *get_all	   = R"({"req":{"get": "all"}})";
+	const k_devjson_protocol_engine_t engines[]	   = {K_DEVJSON_PROTOCOL_ENGINE_STREAMING, K_DEVJSON_PROTOCOL_ENGINE_DOM};
+	char							  output_string[256];
+	k_devjson_protocol_output_t		  output	   = {output_string, sizeof(output_string), NULL, NULL, 0};
+	float							  level		   = 7.25f;
+	float							  gain		   = 0.1f;
+	char							  buffer[64];
+	k_devjson_protocol_fragment_t	  fragments[2];
+	k_devjson_protocol_store_cache_t  cache;
+	k_devjson_protocol_store_t		  store;
+	k_devjson_protocol_ctx_t		  ctx;
+	k_devjson_protocol_property_t	  properties[] = {
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT, K_DEVJSON_PROTOCOL_PROPERTY_FIXED, "level", &level, 1, {}, {}},
+		{K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT, 0, "gain", &gain, 0, {}, {}},
+	};
+	k_devjson_protocol_store_init(&store, properties, sizeof(properties) / sizeof(properties[0]));
+	k_devjson_protocol_store_cache_init(&cache, fragments, 2, buffer, sizeof(buffer));
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_float_callback, NULL);
+	k_devjson_protocol_ctx_set_store(&ctx, &store);
+	k_devjson_protocol_ctx_set_store_cache(&ctx, &cache);
+
+	/* Both engines answer the shortest digits, or the decimals asked for the key */
+	for (const k_devjson_protocol_engine_t engine : engines)
+	{
+		gain			  = 0.1f;
+		ctx.config.engine = engine;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"get":{"temp":2.1,"setpoint":21.50,"level":7.3,"gain":0.1},"set":{"gain":0.3}}})");
+		EXPECT_EQ(gain, 0.3f);
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, get_all, strlen(get_all), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"get":{"level":7.3,"gain":0.3}}})");
+	}
+	EXPECT_EQ(cache.length, strlen(R"("level":7.3,"gain":0.3)"));
+}
+
+TEST(KDevJsonProtocol, NumberParse)
+{
+	const struct
+	{
+		const char *literal;
+		int			integer;
+	} integers[] = {{"0", 0}, {"-0", 0}, {"42", 42}, {"007", 7}, {"2147483647", 2147483647}, {"-2147483648", -2147483647 - 1},
+					{"1e2", 100}, {"3.0", 3}, {"1.", 1}, {"-0.5e1", -5}};
+	const char				  *floats[]	 = {"2.5", "0.1", "-3.25", "2147483648", "-2147483649", "1.5E-3", "123456789012345678901234", "1e300", "-.5"};
+	const char				  *invalid[] = {"", "-", "+1", "1e", "1.5e+", ".5", "inf", "nan", "0x10", " 1", "1-"};
+	k_devjson_protocol_value_t value;
+
+	for (const auto &test : integers)
+	{
+		EXPECT_EQ(k_devjson_protocol_number_parse(test.literal, strlen(test.literal), &value), K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER) << test.literal;
+		EXPECT_EQ(value.int_value, test.integer);
+	}
+	for (const char *literal : floats)
+	{
+		EXPECT_EQ(k_devjson_protocol_number_parse(literal, strlen(literal), &value), K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT) << literal;
+		EXPECT_EQ(value.float_value, (float)strtod(literal, NULL)) << literal;
+	}
+	for (const char *literal : invalid)
+	{
+		EXPECT_EQ(k_devjson_protocol_number_parse(literal, strlen(literal), &value), K_DEVJSON_PROTOCOL_VALUE_TYPE_UNKNOWN) << literal;
+	}
+
+	/* The fast path gives the double strtod returns, typed by its value, whatever the digits and the power of ten */
+	uint64_t state = 0x9e3779b97f4a7c15;
+	for (int i = 0; i < 100000; i++)
+	{
+		char literal[K_DEVJSON_PROTOCOL_PARSER_NUMBER_SIZE];
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		const int length = snprintf(literal, sizeof(literal), "%llu.%llue%d", (unsigned long long)(state % 100000000), (unsigned long long)(state >> 40),
+									(int)(state % 61) - 30);
+		k_devjson_protocol_value_t		expected;
+		k_devjson_protocol_value_type_t expected_type = k_devjson_protocol_number_value(strtod(literal, NULL), &expected);
+		ASSERT_EQ(k_devjson_protocol_number_parse(literal, (size_t)length, &value), expected_type) << literal;
+		if (K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER == expected_type)
+		{
+			EXPECT_EQ(value.int_value, expected.int_value) << literal;
+		}
+		else
+		{
+			EXPECT_EQ(value.float_value, expected.float_value) << literal;
+		}
+	}
+}
+
+static void k_devjson_protocol_test_number_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key,
+									(k_devjson_protocol_value_t){.int_value = (int)cb_arg->input_value_type},
+									K_DEVJSON_PROTOCOL_VALUE_TYPE_INTEGER);
+}
+
+TEST(KDevJsonProtocol, NumberInputs)
+{
+	const char *json_string =
+		R"({"req":{"set": {"a": 16777217, "b": -2147483648, "c": 2.5, "d": 3.0, "e": 4294967296, "g": 1e2, "h": -0.5e1, "i": 1e30}, "cmd": {"f": 7}}})";
+	const k_devjson_protocol_engine_t engines[] = {K_DEVJSON_PROTOCOL_ENGINE_STREAMING, K_DEVJSON_PROTOCOL_ENGINE_DOM};
+	char							  output_string[256];
+	k_devjson_protocol_output_t		  output	= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t		  ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_number_callback, NULL);
+
+	/* Integral values in the range of int are INTEGER (0) however they are written, the others FLOAT (1), with both engines */
+	for (const k_devjson_protocol_engine_t engine : engines)
+	{
+		ctx.config.engine = engine;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, R"({"res":{"set":{"a":0,"b":0,"c":1,"d":0,"e":1,"g":0,"h":0,"i":1},"cmd":{"f":0}}})");
+	}
+}
+
+static void k_devjson_protocol_test_bool_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (K_DEVJSON_PROTOCOL_VALUE_TYPE_BOOL == cb_arg->input_value_type)
+	{
+		k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, cb_arg->input_value, cb_arg->input_value_type);
+	}
+	else
+	{
+		k_devjson_protocol_test_number_callback(cb_arg);
+	}
+}
+
+TEST(KDevJsonProtocol, SetBooleans)
+{
+	const char						 *json_string = R"({"req":{"set": {"on": true, "off": false, "none": null}, "cmd": {"go": true}}})";
+	const char						 *expected	  = R"({"res":{"set":{"on":true,"off":false,"none":5},"cmd":{"go":true}}})";
+	const k_devjson_protocol_engine_t engines[]	  = {K_DEVJSON_PROTOCOL_ENGINE_STREAMING, K_DEVJSON_PROTOCOL_ENGINE_DOM};
+	char							  output_string[256];
+	k_devjson_protocol_output_t		  output	  = {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t		  ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_bool_callback, NULL);
+
+	/* SET booleans reach the callback as BOOL like cmd ones, and null stays UNKNOWN (5), with both engines */
+	for (const k_devjson_protocol_engine_t engine : engines)
+	{
+		ctx.config.engine = engine;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, expected);
+	}
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_bool_callback);
+	EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(json_string, 1, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	EXPECT_STREQ(output_string, expected);
+}
+
+static size_t k_devjson_protocol_test_const_keys = 0;
+
+static void k_devjson_protocol_test_const_key_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	/* user_data selects the function: both must give the same response */
+	void (*add)(cJSON *, const char *, k_devjson_protocol_value_t, k_devjson_protocol_value_type_t) =
+		cb_arg->user_data ? k_devjson_protocol_add_const_response : k_devjson_protocol_add_response;
+	if (K_DEVJSON_PROTOCOL_GROUP_TYPE_GET == cb_arg->group_type)
+	{
+		add(cb_arg->output_json, cb_arg->key, (k_devjson_protocol_value_t){.float_value = 21.5f}, K_DEVJSON_PROTOCOL_VALUE_TYPE_FLOAT);
+		add(cb_arg->output_json, "unit", (k_devjson_protocol_value_t){.string_value = (char *)"C"}, K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING);
+		for (const cJSON *item = cb_arg->writer ? NULL : cb_arg->output_json->child; item; item = item->next)
+		{
+			k_devjson_protocol_test_const_keys += (item->type & cJSON_StringIsConst) ? 1 : 0;
+		}
+	}
+}
+
+TEST(KDevJsonProtocol, ConstKeyResponses)
+{
+	const char				   *json_string = R"({"id": 5, "req":{"get": ["temperature"], "set": {"mode": 1}}})";
+	const char				   *expected	= R"({"id":5,"res":{"get":{"temperature":21.5,"unit":"C"},"set":{}}})";
+	char						output_string[256];
+	k_devjson_protocol_output_t output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	for (int const_key = 0; const_key < 2; const_key++)
+	{
+		k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_const_key_callback, const_key ? &ctx : NULL);
+		ctx.config.engine				   = K_DEVJSON_PROTOCOL_ENGINE_DOM;
+		k_devjson_protocol_test_const_keys = 0;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, expected);
+		EXPECT_EQ(k_devjson_protocol_test_const_keys, const_key ? 2u : 0u);	 //!< No copy of "temperature" and "unit" in the response tree
+		ctx.config.engine = K_DEVJSON_PROTOCOL_ENGINE_STREAMING;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, json_string, strlen(json_string), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, expected);
+	}
+}
+
+TEST(KDevJsonProtocol, ScanKernels)
+{
+	const char special[] = {'"', '\\', '\0', '\x1f', '\n', ' ', 'a', '\x7f', '\x80', '\xff'};
+	char	   buffer[80];
+	size_t	   index	 = 0;
+	srand(24);
+	for (; k_devjson_protocol_scan_kernel(index); index++)
+	{
+		const k_devjson_protocol_scan_t *kernel = k_devjson_protocol_scan_kernel(index);
+		/* One special byte at every position of every span, so that it falls in a block and in the tail */
+		for (size_t length = 0; length <= 70; length++)
+		{
+			for (size_t position = 0; position <= length; position++)
+			{
+				char	  *begin = buffer + 1 + (length % 7);  //!< Unaligned starts
+				const char byte	 = special[(length + position) % sizeof(special)];
+				for (size_t i = 0; i < length; i++)
+				{
+					begin[i] = (char)('#' + rand() % 60 + (i % 3 ? 0 : 32));  //!< Printable, without quote
+					begin[i] = '\\' == begin[i] ? 'x' : begin[i];
+				}
+				if (position < length)
+				{
+					begin[position] = byte;
+				}
+				const int string = (position < length) && (('"' == byte) || ('\\' == byte));
+				const int escape = string || ((position < length) && ((unsigned char)byte < 0x20));
+				EXPECT_EQ(kernel->string(begin, begin + length), begin + (string ? position : length)) << kernel->name << " " << length;
+				EXPECT_EQ(kernel->escape(begin, begin + length), begin + (escape ? position : length)) << kernel->name << " " << length;
+				/* Whitespace and control characters up to a byte above the space character */
+				for (size_t i = 0; i < length; i++)
+				{
+					begin[i] = " \t\r\n\x1f"[(i + position) % 5];
+				}
+				if (length)
+				{
+					begin[length / 2] = '\0';  //!< A NUL byte does not end the run
+				}
+				if (position < length)
+				{
+					begin[position] = "!a\x7f\x80\xff"[length % 5];
+				}
+				EXPECT_EQ(kernel->space(begin, begin + length), begin + position) << kernel->name << " " << length;
+			}
+		}
+		/* Classes of 64-byte blocks, with the bytes that only differ from a bracket by the bit setting lowercase */
+		for (size_t block = 0; block < 200; block++)
+		{
+			const char						  bytes[]  = {'"', '\\', '{', '}', '[', ']', ' ', 'a', ';', '\x1b', '\x5f', '\xdb', '\xfb', '\xfd'};
+			char							 *begin	   = buffer + 1 + (block % 7);
+			k_devjson_protocol_scan_classes_t classes;
+			k_devjson_protocol_scan_classes_t expected = {0, 0, 0, 0};
+			for (size_t i = 0; i < K_DEVJSON_PROTOCOL_SCAN_BLOCK; i++)
+			{
+				begin[i] = bytes[rand() % sizeof(bytes)];
+				expected.quote |= (uint64_t)('"' == begin[i]) << i;
+				expected.backslash |= (uint64_t)('\\' == begin[i]) << i;
+				expected.open |= (uint64_t)(('{' == begin[i]) || ('[' == begin[i])) << i;
+				expected.close |= (uint64_t)(('}' == begin[i]) || (']' == begin[i])) << i;
+			}
+			kernel->classify(begin, &classes);
+			EXPECT_EQ(classes.quote, expected.quote) << kernel->name;
+			EXPECT_EQ(classes.backslash, expected.backslash) << kernel->name;
+			EXPECT_EQ(classes.open, expected.open) << kernel->name;
+			EXPECT_EQ(classes.close, expected.close) << kernel->name;
+		}
+	}
+	ASSERT_GT(index, 0u);
+	EXPECT_STREQ(k_devjson_protocol_scan_kernel(index - 1)->name, "scalar");  //!< Always available, last
+	EXPECT_EQ(k_devjson_protocol_scan_string(buffer, buffer), buffer);
+	EXPECT_EQ(k_devjson_protocol_scan_escape(buffer, buffer), buffer);
+	EXPECT_EQ(k_devjson_protocol_scan_space(buffer, buffer), buffer);
+}
+
+static void k_devjson_protocol_test_echo_callback(k_devjson_protocol_cb_arg_t *cb_arg)
+{
+	if (K_DEVJSON_PROTOCOL_VALUE_TYPE_STRING == cb_arg->input_value_type)
+	{
+		k_devjson_protocol_add_response(cb_arg->output_json, cb_arg->key, cb_arg->input_value, cb_arg->input_value_type);
+	}
+}
+
+TEST(KDevJsonProtocol, LongStrings)
+{
+	std::string				 value;
+	std::vector<std::string> escapes = {"\\\"", "\\\\", "\\n", "\\t", "\\u0001", "\\u001f"};
+	char					 output_string[1024];
+	k_devjson_protocol_ctx_t ctx;
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_echo_callback, NULL);
+	/* Escapes on both sides of the 16 and 32-byte block boundaries, in a key and a value */
+	for (size_t i = 0; i < 10; i++)
+	{
+		value += std::string(i % 5 ? 13 + i : 31, (char)('a' + i)) + escapes[i % escapes.size()];
+	}
+	const std::string				  key		= "serial" + std::string(14, 'k') + "\\\"" + std::string(15, 's') + "\\\\/";
+	const std::string				  request	= R"({"req":{"set": {")" + key + R"(": ")" + value + R"(", "n": 1}}})";
+	const std::string				  expected	= R"({"res":{"set":{")" + key + R"(":")" + value + R"("}}})";
+	const k_devjson_protocol_engine_t engines[] = {K_DEVJSON_PROTOCOL_ENGINE_STREAMING, K_DEVJSON_PROTOCOL_ENGINE_DOM};
+	for (k_devjson_protocol_engine_t engine : engines)
+	{
+		k_devjson_protocol_output_t output = {output_string, sizeof(output_string), NULL, NULL, 0};
+		ctx.config.engine				   = engine;
+		EXPECT_EQ(k_devjson_protocol_ctx_parse(&ctx, request.c_str(), request.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_EQ(std::string(output_string), expected);
+	}
+	/* A string split across chunks resumes the scan where the previous chunk stopped */
+	k_devjson_protocol_register_callback(k_devjson_protocol_test_echo_callback);
+	for (size_t chunk_size = 1; chunk_size < 40; chunk_size += 3)
+	{
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(request, chunk_size, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_EQ(std::string(output_string), expected);
+	}
+}
+
+TEST(KDevJsonProtocol, IndentedRequests)
+{
+	const char *tokens[] = {"{", "\"req\"", ":", "{", "\"set\"", ":", "{", "\"a\"", ":", "\"x y\"", ",", "\"b\"", ":", "\"\\\"\"", ",", "\"c\"", ":", "1",
+							",", "\"d\"", ":", "[", "true", ",", "null", "]", "}", ",", "\"get\"", ":", "[", "\"key1\"", "]", "}", "}"};
+	char						output_string[1024];
+	char						expected[1024];
+	char						expected_chunked[1024];
+	k_devjson_protocol_output_t output = {expected, sizeof(expected), NULL, NULL, 0};
+	std::string					compact;
+	k_devjson_protocol_register_callback(k_devjson_protocol_callback);
+	for (const char *token : tokens)
+	{
+		compact += token;
+	}
+	ASSERT_EQ(k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, compact.c_str(), compact.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	ASSERT_EQ(k_devjson_protocol_test_feed_in_chunks(compact, 1, expected_chunked, sizeof(expected_chunked)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+	/* Runs of every length between the tokens, across the 16 and 32-byte blocks of the kernels */
+	for (size_t run = 0; run < 40; run++)
+	{
+		std::string request;
+		for (size_t i = 0; i < sizeof(tokens) / sizeof(tokens[0]); i++)
+		{
+			for (size_t j = 0; j < (run + i) % 40; j++)
+			{
+				request += " \t\r\n"[(i + j) % 4];
+			}
+			request += tokens[i];
+		}
+		request += std::string(run, '\n');
+		output = {output_string, sizeof(output_string), NULL, NULL, 0};
+		EXPECT_EQ(k_devjson_protocol_parse_sax(&k_devjson_protocol_default_ctx, request.c_str(), request.size(), &output), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, expected) << run;
+		EXPECT_EQ(k_devjson_protocol_test_feed_in_chunks(request, 7 + run, output_string, sizeof(output_string)), K_DEVJSON_PROTOCOL_PARSE_SUCCESS);
+		EXPECT_STREQ(output_string, expected_chunked) << run;  //!< Chunks keep the order of the groups in the request
+	}
+}
+
+static const char *k_devjson_protocol_test_skip_container(const char *cursor, const char *end)
+{
+	/* Reference: one byte at a time, brackets counted outside strings */
+	const char *container_end = NULL;
+	size_t		depth		  = 0;
+	int			in_string	  = 0;
+	while ((cursor < end) && !container_end)
+	{
+		const char character = *cursor++;
+		if (in_string)
+		{
+			cursor += ('\\' == character) && (cursor < end);
+			in_string = '"' != character;
+		}
+		else if ('"' == character)
+		{
+			in_string = 1;
+		}
+		else if (('{' == character) || ('[' == character))
+		{
+			depth++;
+		}
+		else if ((('}' == character) || (']' == character)) && (0 == --depth))
+		{
+			container_end = cursor;
+		}
+	}
+	return container_end;
+}
+
+TEST(KDevJsonProtocol, StructuralIndex)
+{
+	const char *pieces[] = {"{", "[", "}", "]", ",", ": ", "\"a\"", "\"}]\"", "\"\\\"{\"", "\"\\\\\"", "\"\\\\\\\"[\"", "\"x\\\\\\\\\"", "\"\\u005b\"", "1"};
+	srand(25);
+	/* Strings with escaped quotes and runs of backslashes, ending on both sides of the 64-byte blocks */
+	for (size_t round = 0; round < 3000; round++)
+	{
+		std::string json = "{";
+		while (json.size() < (size_t)(round % 300))
+		{
+			json += pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+			if (0 == rand() % 16)
+			{
+				json += "\"" + std::string(2 * (rand() % 40), '\\') + std::string(rand() % 70, '{') + "\"";
+			}
+		}
+		const char *begin = json.c_str();
+		const char *end	  = begin + json.size() - (round % 5 ? 0 : json.size() / 2);
+		EXPECT_EQ(k_devjson_protocol_index_skip(begin, end), k_devjson_protocol_test_skip_container(begin, end)) << json;
+	}
+
+	/* A large request for another device is rejected before its body is read, whatever the ID is after */
+	std::string body;
+	int			id = 0;
+	for (size_t i = 0; body.size() < 4 * K_DEVJSON_PROTOCOL_INDEX_THRESHOLD; i++)
+	{
+		body += R"("c)" + std::to_string(i) + R"(": {"s": "}]\"{[\\", "a": [1, {"b": "\\\\"}], "id": 5}, )";
+	}
+	std::string					json_string = R"({"req":{"cmd": {)" + body + R"("last": {}}}, "id": 12})";
+	char						output_string[1024];
+	k_devjson_protocol_output_t output		= {output_string, sizeof(output_string), NULL, NULL, 0};
+	k_devjson_protocol_ctx_t	ctx;
+	EXPECT_EQ(k_devjson_protocol_peek_id(json_string.c_str(), json_string.size(), &id), K_DEVJSON_PROTOCOL_PEEK_FOUND);
+	EXPECT_EQ(id, 12);
+	k_devjson_protocol_ctx_init(&ctx, k_devjson_protocol_test_counting_callback, NULL);
+	k_devjson_protocol_test_dispatch_count = 0;
+	EXPECT_EQ(k_devjson_protocol_parse_sax(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(k_devjson_protocol_parse_dom(&ctx, json_string.c_str(), json_string.size(), &output), K_DEVJSON_PROTOCOL_PARSE_WRONG_ID);
+	EXPECT_EQ(k_devjson_protocol_test_dispatch_count, 0);
+	EXPECT_STREQ(output_string, "{}");
+}